@@ -32,11 +32,23 @@ $(SOUND_BIN_DIR)/%.bin: sound/%.aif
 # Data following the colon in said file corresponds to arguments passed into mid2agb
 MID_CFG_PATH := $(MID_SUBDIR)/midi.cfg
 
+# Normally a single run of mid2agb converts every song in midi.cfg, only rewriting the .s files which changed,
+# and the stamp records when it last ran. A .s which has gone missing since then reruns the batch. The asset
+# cache works one file at a time, so with ASSET_CACHE each song gets a rule of its own instead.
+MID_STAMP := $(OBJ_DIR)/midi.stamp
+
 # $1: Source path no extension, $2 Options
+ifeq ($(ASSET_CACHE),)
+define MID_RULE
+MID_CFG_SRCS += $(MID_SUBDIR)/$1.mid
+MID_CFG_ASMS += $(MID_ASM_DIR)/$1.s
+endef
+else
 define MID_RULE
 $(MID_ASM_DIR)/$1.s: $(MID_SUBDIR)/$1.mid $(MID_CFG_PATH)
 	$(MID) $$< $$@ $2
 endef
+endif
 #                            source path,                             remaining text (options)
 define MID_EXPANSION
 	$(eval $(call MID_RULE,$(basename $(patsubst %:,%,$(word 1,$1))),$(wordlist 2,999,$1)))
@@ -44,6 +56,15 @@ endef
 
 $(foreach line,$(shell cat $(MID_CFG_PATH) | sed "s/ /__SPACE__/g"),$(call MID_EXPANSION,$(subst __SPACE__, ,$(line))))
 
+$(MID_STAMP): $(MID_CFG_PATH) $(MID_CFG_SRCS)
+	@mkdir -p $(@D)
+	$(MID) -batch $(MID_CFG_PATH) $(MID_ASM_DIR)
+	@touch $@
+
+ifeq ($(ASSET_CACHE),)
+$(eval $(call STAMPED_OUTPUTS,$(MID_CFG_ASMS),$(MID_STAMP)))
+endif
+
 # Warn users building without a .cfg - build will fail at link time
 $(MID_ASM_DIR)/%.s: $(MID_SUBDIR)/%.mid
 	$(warning $< does not have an associated entry in midi.cfg! It cannot be built)
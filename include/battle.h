@@ -349,12 +349,47 @@ struct SwitchinCandidate
     bool8 hypotheticalStatus;
 };
 
+// How one of the AI's party mons would do against an opposing battler if it switched in. Worked out the first time
+// one of the switching checks needs it each turn, in battle_ai_switch_items.c.
+struct AiSwitchinMatchup
+{
+    s32 damageDealt[MAX_MON_MOVES]; // by each of its moves, with damageRollType
+    s32 maxDamageTaken; // from the opposing battler's moves
+    u32 damageStatus; // the mon's status1 the damage was simulated with, without the Toxic counter
+    u8 effectiveness[MAX_MON_MOVES]; // of each of its moves
+    u8 strikesFirst; // bit per move
+    u8 damageRollType;
+    bool8 hasEffectiveness:1;
+    bool8 hasDamage:1;
+    u8 padding:6;
+};
+
 struct SimulatedDamage
 {
     s32 expected;
     s32 minimum;
 };
 
+// How far the AI has got choosing a battler's move, when it spreads the choice over several frames.
+struct AiThinkingProgress
+{
+    u32 flags; // The flags still to run against the target, shifted right by aiLogicId.
+    u32 startFrame;
+    u32 stepFrame;
+    u8 stepScanline;
+    u8 scanlines; // How long it may think for in each frame.
+    u8 maxFrames; // How many frames it may think for before it only runs AI_FLAGS_OUT_OF_TIME.
+    u8 battler;
+    u8 target;
+    bool8 inProgress:1;
+    bool8 targetStarted:1;
+    bool8 outOfTime:1;
+    bool8 overFrames:1;
+    u8 padding:4;
+    u8 actionOrMoveIndex[MAX_BATTLERS_COUNT];
+    s32 bestMovePointsForTarget[MAX_BATTLERS_COUNT];
+};
+
 // Ai Data used when deciding which move to use, computed only once before each turn's start.
 struct AiLogicData
 {
@@ -373,12 +408,29 @@ struct AiLogicData
     u8 monToSwitchInId[MAX_BATTLERS_COUNT]; // ID of the mon to switch in.
     u8 mostSuitableMonId[MAX_BATTLERS_COUNT]; // Stores result of GetMostSuitableMonToSwitchInto, which decides which generic mon the AI would switch into if they decide to switch. This can be overruled by specific mons found in ShouldSwitch; the final resulting mon is stored in AI_monToSwitchIntoId.
     struct SwitchinCandidate switchinCandidate; // Struct used for deciding which mon to switch to in battle_ai_switch_items.c
+    struct AiSwitchinMatchup switchinMatchups[MAX_BATTLERS_COUNT][PARTY_SIZE][MAX_BATTLERS_COUNT]; // battler, party index, opposing battler
     u8 weatherHasEffect:1; // The same as WEATHER_HAS_EFFECT. Stored here, so it's called only once.
     u8 ejectButtonSwitch:1; // Tracks whether current switch out was from Eject Button
     u8 ejectPackSwitch:1; // Tracks whether current switch out was from Eject Pack
     u8 padding:5;
     u8 shouldSwitch; // Stores result of ShouldSwitch, which decides whether a mon should be switched out
     u8 aiCalcInProgress:1;
+    struct AiThinkingProgress thinking;
+};
+
+// The AI's simulated damage, effectiveness and accuracy from the last time SetAiLogicDataForTurn ran, and hashes
+// of the battle state they were calculated from. Only the attacker/target pairs whose state has changed since are
+// calculated again. The keys are 32-bit hashes rather than copies of the state, which would take several KB of heap.
+// A collision (about 1 in 4 billion for each battler whose state changed) reuses stale results until the state
+// changes again; that is accepted. So is missing one of the inputs, which DEBUG_AI_CHECK_MOVES_CACHE is there to catch.
+struct AiMovesDataCache
+{
+    u32 fieldKey;
+    u32 battlerKeys[MAX_BATTLERS_COUNT];
+    u8 validTargets[MAX_BATTLERS_COUNT]; // bit per target, for each attacker
+    struct SimulatedDamage simulatedDmg[MAX_BATTLERS_COUNT][MAX_BATTLERS_COUNT][MAX_MON_MOVES]; // attacker, target, moveIndex
+    u8 effectiveness[MAX_BATTLERS_COUNT][MAX_BATTLERS_COUNT][MAX_MON_MOVES]; // attacker, target, moveIndex
+    u8 moveAccuracy[MAX_BATTLERS_COUNT][MAX_BATTLERS_COUNT][MAX_MON_MOVES]; // attacker, target, moveIndex
 };
 
 struct AI_ThinkingStruct
@@ -434,6 +486,7 @@ struct BattleResources
     struct StatsArray* beforeLvlUp;
     struct AI_ThinkingStruct *ai;
     struct AiLogicData *aiData;
+    struct AiMovesDataCache *aiMovesDataCache;
     struct AIPartyData *aiParty;
     struct BattleHistory *battleHistory;
     u8 bufferA[MAX_BATTLERS_COUNT][0x200];
@@ -443,6 +496,7 @@ struct BattleResources
 
 #define AI_THINKING_STRUCT ((struct AI_ThinkingStruct *)(gBattleResources->ai))
 #define AI_DATA ((struct AiLogicData *)(gBattleResources->aiData))
+#define AI_MOVES_DATA_CACHE ((struct AiMovesDataCache *)(gBattleResources->aiMovesDataCache))
 #define AI_PARTY ((struct AIPartyData *)(gBattleResources->aiParty))
 #define BATTLE_HISTORY ((struct BattleHistory *)(gBattleResources->battleHistory))
 
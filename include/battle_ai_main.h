@@ -99,6 +99,8 @@ void BattleAI_SetupItems(void);
 void BattleAI_SetupFlags(void);
 void BattleAI_SetupAIData(u8 defaultScoreMoves, u32 battler);
 u32 BattleAI_ChooseMoveOrAction(void);
+void BattleAI_StartChoosingMoveOrAction(bool32 overFrames);
+bool32 BattleAI_ContinueChoosingMoveOrAction(u32 *moveOrAction);
 void Ai_InitPartyStruct(void);
 void Ai_UpdateSwitchInData(u32 battler);
 void Ai_UpdateFaintData(u32 battler);
@@ -256,6 +256,10 @@
 #define B_TOXIC_REVERSAL                GEN_LATEST // In Gen5+, bad poison will change to regular poison at the end of battles.
 #define B_TRY_CATCH_TRAINER_BALL        GEN_LATEST // In Gen4+, trying to catch a Trainer's Pokémon does not consume the Poké Ball.
 
+// AI settings
+#define B_AI_THINK_SCANLINES            0          // If not 0, the AI chooses its moves over as many frames as it needs, thinking for about this many scanlines (out of 228) in each, so that music and animations don't stutter while an AI with many flags thinks. 100 is a reasonable value.
+#define B_AI_THINK_MAX_FRAMES           8          // If B_AI_THINK_SCANLINES is set, once the AI has been thinking for this many frames, it only runs AI_FLAG_CHECK_BAD_MOVE and AI_FLAG_TRY_TO_FAINT for the rest of its choice.
+
 // Animation Settings
 #define B_NEW_SWORD_PARTICLE            FALSE    // If set to TRUE, it updates Swords Dance's particle.
 #define B_NEW_LEECH_SEED_PARTICLE       FALSE    // If set to TRUE, it updates Leech Seed's animation particle.
@@ -10,6 +10,9 @@
 // Battle Debug Menu
 #define DEBUG_BATTLE_MENU               TRUE    // If set to TRUE, enables a debug menu to use in battles by pressing the Select button.
 #define DEBUG_AI_DELAY_TIMER            FALSE   // If set to TRUE, displays the number of frames it takes for the AI to choose a move. Replaces the "What will PKMN do" text. Useful for devs or anyone who modifies the AI code and wants to see if it doesn't take too long to run.
+#ifndef DEBUG_AI_CHECK_MOVES_CACHE
+#define DEBUG_AI_CHECK_MOVES_CACHE      FALSE   // If set to TRUE, the AI recalculates the damage of every move every turn and prints any that differ from what it kept from previous turns, or fails the test it is running in. Can also be set with make CPPFLAGS=-DDEBUG_AI_CHECK_MOVES_CACHE=TRUE. Useful for anyone who modifies the damage calculation and wants to check that the AI still notices everything it depends on.
+#endif
 
 // Pokémon Debug
 #define DEBUG_POKEMON_SPRITE_VISUALIZER TRUE    // Enables a debug menu for Pokémon sprites and icons, accessed by pressing Select in the summary screen.
@@ -312,6 +312,12 @@
  * The most common combination is  AI_FLAGS(AI_FLAG_CHECK_BAD_MOVE | AI_FLAG_CHECK_VIABILITY | AI_FLAG_TRY_TO_FAINT)
  * which is the general 'smart' AI.
  *
+ * AI_THINK_OVER_FRAMES(scanlines, maxFrames)
+ * Makes the AI choose its moves over several frames, thinking for about
+ * scanlines each frame and for at most maxFrames frames, as it does when
+ * B_AI_THINK_SCANLINES and B_AI_THINK_MAX_FRAMES are set. Otherwise the
+ * AI always chooses within the frame in tests. Has use only for AI tests.
+ *
  * WHEN
  * Contains the choices that battlers make during the battle.
  *
@@ -679,6 +685,8 @@ struct BattleTestData
     u8 moveBattlers;
     bool8 hasAI:1;
     bool8 logAI:1;
+    u8 aiThinkScanlines;
+    u8 aiThinkMaxFrames;
 
     struct RecordedBattleSave recordedBattle;
     u8 battleRecordTypes[MAX_BATTLERS_COUNT][BATTLER_RECORD_SIZE];
@@ -709,7 +717,6 @@ struct BattleTestRunnerState
     u16 parameters;
     u16 runParameter;
     u16 rngTag;
-    u16 rngTrialOffset;
     u16 trials;
     u16 runTrial;
     u16 expectedRatio;
@@ -807,6 +814,7 @@ struct RandomlyContext
 };
 
 void Randomly(u32 sourceLine, u32 passes, u32 trials, struct RandomlyContext);
+rng_value_t GetTrialRngSeed(u32 trial);
 
 /* Given */
 
@@ -820,6 +828,7 @@ struct moveWithPP {
 #define RNGSeed(seed) RNGSeed_(__LINE__, seed)
 #define AI_FLAGS(flags) AIFlags_(__LINE__, flags)
 #define AI_LOG AILogScores(__LINE__)
+#define AI_THINK_OVER_FRAMES(scanlines, maxFrames) AIThinkOverFrames_(__LINE__, scanlines, maxFrames)
 
 #define FLAG_SET(flagId) SetFlagForTest(__LINE__, flagId)
 
@@ -862,6 +871,7 @@ void ClosePokemon(u32 sourceLine);
 void RNGSeed_(u32 sourceLine, rng_value_t seed);
 void AIFlags_(u32 sourceLine, u32 flags);
 void AILogScores(u32 sourceLine);
+void AIThinkOverFrames_(u32 sourceLine, u32 scanlines, u32 maxFrames);
 void Gender_(u32 sourceLine, u32 gender);
 void Nature_(u32 sourceLine, u32 nature);
 void Ability_(u32 sourceLine, u32 ability);
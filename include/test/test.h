@@ -5,6 +5,11 @@
 
 #define MAX_PROCESSES 32 // See also tools/mgba-rom-test-hydra/main.c
 
+#define MAX_SCHEDULED_TESTS 8192
+#define TEST_RUNNER_UNSCHEDULED 0xFF
+#define TEST_RUNNER_SKIP 0xFE // Never matches gTestRunnerI.
+#define TEST_RUNNER_SHARDED 0xFD // Every runner runs its shard of the trials.
+
 enum TestResult
 {
     TEST_RESULT_FAIL,
@@ -44,18 +49,30 @@ struct TestRunnerState
     u32 failedAssumptionsBlockLine;
     const struct Test *test;
     u32 processCosts[MAX_PROCESSES];
+    u8 processHeap[MAX_PROCESSES];
 
     u8 result;
     u8 expectedResult;
     bool8 expectLeaks:1;
     bool8 inBenchmark:1;
     bool8 tearDown:1;
+    bool8 profiling:1;
+    u8 trialShard;
+    u8 trialShards;
     u32 timeoutSeconds;
+    u32 frames;
+    u32 vblankCounterStart;
+    u32 timer2Overflows;
+    u16 timer2Start;
 };
 
 extern const u8 gTestRunnerN;
 extern const u8 gTestRunnerI;
 extern const char gTestRunnerArgv[256];
+extern const u8 gTestRunnerSchedule[MAX_SCHEDULED_TESTS];
+extern const u8 gTestRunnerTrialShard;
+extern const u8 gTestRunnerTrialShards;
+extern const bool8 gTestRunnerTraceRng;
 
 extern const struct TestRunner gAssumptionsRunner;
 
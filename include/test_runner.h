@@ -25,6 +25,10 @@ void TestRunner_Battle_CheckBattleRecordActionType(u32 battlerId, u32 recordInde
 
 u32 TestRunner_Battle_GetForcedAbility(u32 side, u32 partyIndex);
 u32 TestRunner_Battle_GetChosenGimmick(u32 side, u32 partyIndex);
+u32 TestRunner_Battle_GetAiThinkScanlines(void);
+u32 TestRunner_Battle_GetAiThinkMaxFrames(void);
+
+void TestRunner_RecordFrame(void);
 
 #else
 
@@ -48,6 +52,11 @@ u32 TestRunner_Battle_GetChosenGimmick(u32 side, u32 partyIndex);
 
 #define TestRunner_Battle_GetChosenGimmick(...) (u32)0
 
+#define TestRunner_Battle_GetAiThinkScanlines(...) (u32)0
+#define TestRunner_Battle_GetAiThinkMaxFrames(...) (u32)0
+
+#define TestRunner_RecordFrame(...) (void)0
+
 #endif
 
 #endif
@@ -1,14 +1,20 @@
 # JSON files are run through jsonproc, which is a tool that converts JSON data to an output file
 # based on an Inja template. https://github.com/pantor/inja
 
-AUTO_GEN_TARGETS += $(DATA_SRC_SUBDIR)/wild_encounters.h
-$(DATA_SRC_SUBDIR)/wild_encounters.h: $(DATA_SRC_SUBDIR)/wild_encounters.json $(DATA_SRC_SUBDIR)/wild_encounters.json.txt
-	$(JSONPROC) $^ $@
+# jsonproc doesn't rewrite outputs whose contents haven't changed, so a stamp
+# next to each output records when it was last run.
+AUTO_GEN_TARGETS += $(DATA_SRC_SUBDIR)/wild_encounters.h $(DATA_SRC_SUBDIR)/wild_encounters.h.stamp
+$(DATA_SRC_SUBDIR)/wild_encounters.h.stamp: $(DATA_SRC_SUBDIR)/wild_encounters.json $(DATA_SRC_SUBDIR)/wild_encounters.json.txt
+	$(JSONPROC) $^ $(@:.stamp=)
+	@touch $@
+$(eval $(call STAMPED_OUTPUTS,$(DATA_SRC_SUBDIR)/wild_encounters.h,$(DATA_SRC_SUBDIR)/wild_encounters.h.stamp))
 
 $(C_BUILDDIR)/wild_encounter.o: c_dep += $(DATA_SRC_SUBDIR)/wild_encounters.h
 
-AUTO_GEN_TARGETS += $(DATA_SRC_SUBDIR)/region_map/region_map_entries.h
-$(DATA_SRC_SUBDIR)/region_map/region_map_entries.h: $(DATA_SRC_SUBDIR)/region_map/region_map_sections.json $(DATA_SRC_SUBDIR)/region_map/region_map_sections.json.txt
-	$(JSONPROC) $^ $@
+AUTO_GEN_TARGETS += $(DATA_SRC_SUBDIR)/region_map/region_map_entries.h $(DATA_SRC_SUBDIR)/region_map/region_map_entries.h.stamp
+$(DATA_SRC_SUBDIR)/region_map/region_map_entries.h.stamp: $(DATA_SRC_SUBDIR)/region_map/region_map_sections.json $(DATA_SRC_SUBDIR)/region_map/region_map_sections.json.txt
+	$(JSONPROC) $^ $(@:.stamp=)
+	@touch $@
+$(eval $(call STAMPED_OUTPUTS,$(DATA_SRC_SUBDIR)/region_map/region_map_entries.h,$(DATA_SRC_SUBDIR)/region_map/region_map_entries.h.stamp))
 
 $(C_BUILDDIR)/region_map.o: c_dep += $(DATA_SRC_SUBDIR)/region_map/region_map_entries.h
@@ -5,9 +5,14 @@ MAKEFLAGS += --no-print-directory
 
 # Inclusive list. If you don't want a tool to be built, don't add it here.
 TOOLS_DIR := tools
-TOOL_NAMES := aif2pcm bin2c gbafix gbagfx jsonproc mapjson mid2agb preproc ramscrgen rsfont scaninc trainerproc
+TOOL_NAMES := aif2pcm bin2c gbafix gbagfx jsonproc learnset_helpers mapjson mid2agb preproc ramscrgen rsfont scaninc trainerproc
 CHECK_TOOL_NAMES = patchelf mgba-rom-test-hydra
 
+# Only needed (and only builds on POSIX systems) when caching assets.
+ifneq ($(ASSET_CACHE),)
+TOOL_NAMES += assetcache
+endif
+
 TOOLDIRS := $(TOOL_NAMES:%=$(TOOLS_DIR)/%)
 CHECKTOOLDIRS := $(CHECK_TOOL_NAMES:%=$(TOOLS_DIR)/%)
 
@@ -22,8 +22,15 @@ $(DATA_ASM_BUILDDIR)/maps.o: $(DATA_ASM_SUBDIR)/maps.s $(LAYOUTS_DIR)/layouts.in
 $(DATA_ASM_BUILDDIR)/map_events.o: $(DATA_ASM_SUBDIR)/map_events.s $(MAPS_DIR)/events.inc $(MAP_EVENTS)
 	$(PREPROC) $< charmap.txt | $(CPP) -I include - | $(PREPROC) -ie $< charmap.txt | $(AS) $(ASFLAGS) -o $@
 
-$(MAPS_OUTDIR)/%/header.inc $(MAPS_OUTDIR)/%/events.inc $(MAPS_OUTDIR)/%/connections.inc: $(MAPS_DIR)/%/map.json
-	$(MAPJSON) map emerald $< $(LAYOUTS_DIR)/layouts.json $(@D)
+# All of the maps are converted at once, but mapjson only rewrites the files
+# which have changed, so the stamp records when it was last run.
+MAP_DATA_STAMP := $(MAPS_OUTDIR)/map_data.stamp
+
+$(MAP_DATA_STAMP): $(MAPS_DIR)/map_groups.json $(LAYOUTS_DIR)/layouts.json $(MAP_DIRS:%=%map.json)
+	$(MAPJSON) all emerald $(MAPS_DIR)/map_groups.json $(LAYOUTS_DIR)/layouts.json $(MAPS_OUTDIR)
+	@touch $@
+
+$(eval $(call STAMPED_OUTPUTS,$(MAP_CONNECTIONS) $(MAP_EVENTS) $(MAP_HEADERS),$(MAP_DATA_STAMP)))
 
 $(MAPS_OUTDIR)/connections.inc $(MAPS_OUTDIR)/groups.inc $(MAPS_OUTDIR)/events.inc $(MAPS_OUTDIR)/headers.inc $(INCLUDECONSTS_OUTDIR)/map_groups.h $(DATA_SRC_SUBDIR)/map_group_count.h: $(MAPS_DIR)/map_groups.json
 	$(MAPJSON) groups emerald $< $(MAPS_OUTDIR) $(INCLUDECONSTS_OUTDIR)
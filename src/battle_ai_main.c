@@ -26,14 +26,22 @@
 #include "constants/moves.h"
 #include "constants/items.h"
 #include "constants/trainers.h"
+#if TESTING
+#include "test/test.h"
+#endif
 
 #define AI_ACTION_DONE          (1 << 0)
 #define AI_ACTION_FLEE          (1 << 1)
 #define AI_ACTION_WATCH         (1 << 2)
 #define AI_ACTION_DO_NOT_ATTACK (1 << 3)
 
+#define SCANLINES_PER_FRAME 228
+
+// The flags the AI still runs once it has been thinking for B_AI_THINK_MAX_FRAMES.
+#define AI_FLAGS_OUT_OF_TIME (AI_FLAG_CHECK_BAD_MOVE | AI_FLAG_TRY_TO_FAINT | AI_FLAG_ROAMING | AI_FLAG_SAFARI | AI_FLAG_FIRST_BATTLE)
+
 static u32 ChooseMoveOrAction_Singles(u32 battlerAi);
-static u32 ChooseMoveOrAction_Doubles(u32 battlerAi);
+static bool32 ChooseMoveOrAction_Doubles(struct AiThinkingProgress *thinking, u32 *moveOrAction);
 static inline void BattleAI_DoAIProcessing(struct AI_ThinkingStruct *aiThink, u32 battlerAi, u32 battlerDef);
 static bool32 IsPinchBerryItemEffect(u32 holdEffect);
 
@@ -272,10 +280,127 @@ u32 BattleAI_ChooseMoveOrAction(void)
 {
     u32 ret;
 
+    BattleAI_StartChoosingMoveOrAction(FALSE);
+    BattleAI_ContinueChoosingMoveOrAction(&ret);
+    return ret;
+}
+
+static u32 GetAiThinkingFlags(struct AiThinkingProgress *thinking)
+{
+    u32 flags = AI_THINKING_STRUCT->aiFlags[thinking->battler];
+
+    if (thinking->outOfTime)
+        flags &= AI_FLAGS_OUT_OF_TIME;
+    return flags;
+}
+
+// Tests choose their own budget with AI_THINK_OVER_FRAMES, and think within the frame without it.
+static u32 GetAiThinkScanlines(void)
+{
+    if (TESTING)
+        return TestRunner_Battle_GetAiThinkScanlines();
+    return B_AI_THINK_SCANLINES;
+}
+
+static u32 GetAiThinkMaxFrames(void)
+{
+    if (TESTING)
+        return TestRunner_Battle_GetAiThinkMaxFrames();
+    return B_AI_THINK_MAX_FRAMES;
+}
+
+// Starts choosing the move or action of sBattler_AI, after BattleAI_SetupAIData. If overFrames is TRUE and
+// B_AI_THINK_SCANLINES is set, BattleAI_ContinueChoosingMoveOrAction only thinks for that long each time, and has to
+// be called once per frame until it returns TRUE.
+void BattleAI_StartChoosingMoveOrAction(bool32 overFrames)
+{
+    struct AiThinkingProgress *thinking = &AI_DATA->thinking;
+
+    memset(thinking, 0, sizeof(*thinking));
+    thinking->inProgress = TRUE;
+    thinking->scanlines = GetAiThinkScanlines();
+    thinking->maxFrames = GetAiThinkMaxFrames();
+    thinking->overFrames = (overFrames && thinking->scanlines != 0);
+    thinking->battler = sBattler_AI;
+    thinking->startFrame = gMain.vblankCounter1;
     if (!IsDoubleBattle())
+    {
+        thinking->target = gBattlerTarget;
+        thinking->flags = GetAiThinkingFlags(thinking);
+    }
+}
+
+static bool32 IsAiThinkingTimeUp(struct AiThinkingProgress *thinking)
+{
+    if (!thinking->overFrames || thinking->outOfTime)
+        return FALSE;
+    if (gMain.vblankCounter1 != thinking->stepFrame)
+        return TRUE;
+    return (REG_VCOUNT + SCANLINES_PER_FRAME - thinking->stepScanline) % SCANLINES_PER_FRAME >= thinking->scanlines;
+}
+
+// Runs the flags that haven't been run against the target yet, until the AI's time for this frame is up.
+// Returns TRUE once all of them have been run.
+static bool32 RunAiFlags(struct AiThinkingProgress *thinking, u32 battlerAi, u32 battlerDef)
+{
+    while (thinking->flags != 0)
+    {
+        if (thinking->flags & 1)
+        {
+            BattleAI_DoAIProcessing(AI_THINKING_STRUCT, battlerAi, battlerDef);
+        }
+        thinking->flags >>= 1;
+        AI_THINKING_STRUCT->aiLogicId++;
+
+        if (thinking->flags != 0 && IsAiThinkingTimeUp(thinking))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// Returns TRUE and sets moveOrAction once the AI has made its choice.
+bool32 BattleAI_ContinueChoosingMoveOrAction(u32 *moveOrAction)
+{
+    struct AiThinkingProgress *thinking = &AI_DATA->thinking;
+    u32 ret;
+
+    if (thinking->overFrames)
+    {
+        thinking->stepFrame = gMain.vblankCounter1;
+        thinking->stepScanline = REG_VCOUNT;
+        if (!thinking->outOfTime && gMain.vblankCounter1 - thinking->startFrame >= thinking->maxFrames)
+        {
+            // Make up its mind with the cheapest flags, instead of keeping the player waiting.
+            thinking->outOfTime = TRUE;
+            if (IsDoubleBattle())
+            {
+                // The best scores against each target are compared with each other, so they have to come from the
+                // same flags. Score every target again from the start.
+                thinking->target = 0;
+                thinking->targetStarted = FALSE;
+                memset(thinking->actionOrMoveIndex, 0, sizeof(thinking->actionOrMoveIndex));
+                memset(thinking->bestMovePointsForTarget, 0, sizeof(thinking->bestMovePointsForTarget));
+            }
+            else
+            {
+                thinking->flags &= AI_FLAGS_OUT_OF_TIME >> AI_THINKING_STRUCT->aiLogicId;
+            }
+        }
+    }
+
+    sBattler_AI = thinking->battler;
+    if (!IsDoubleBattle())
+    {
+        gBattlerTarget = thinking->target;
+        AI_DATA->partnerMove = 0;   // no ally
+        if (!RunAiFlags(thinking, sBattler_AI, gBattlerTarget))
+            return FALSE;
         ret = ChooseMoveOrAction_Singles(sBattler_AI);
-    else
-        ret = ChooseMoveOrAction_Doubles(sBattler_AI);
+    }
+    else if (!ChooseMoveOrAction_Doubles(thinking, &ret))
+    {
+        return FALSE;
+    }
 
     // Clear protect structures, some flags may be set during AI calcs
     // e.g. pranksterElevated from GetMovePriority
@@ -283,7 +408,9 @@ u32 BattleAI_ChooseMoveOrAction(void)
     #if TESTING
     TestRunner_Battle_CheckAiMoveScores(sBattler_AI);
     #endif // TESTING
-    return ret;
+    thinking->inProgress = FALSE;
+    *moveOrAction = ret;
+    return TRUE;
 }
 
 static void CopyBattlerDataToAIParty(u32 bPosition, u32 side)
@@ -407,7 +534,7 @@ static u32 Ai_SetMoveAccuracy(struct AiLogicData *aiData, u32 battlerAtk, u32 ba
     return accuracy;
 }
 
-static void SetBattlerAiMovesData(struct AiLogicData *aiData, u32 battlerAtk, u32 battlersCount, u32 weather)
+static void SetBattlerAiMovesData(struct AiMovesDataCache *cache, struct AiLogicData *aiData, u32 battlerAtk, u32 targets, u32 weather)
 {
     u16 *moves;
     u32 battlerDef, moveIndex, move;
@@ -418,9 +545,9 @@ static void SetBattlerAiMovesData(struct AiLogicData *aiData, u32 battlerAtk, u3
     SetBattlerData(battlerAtk);
 
     // Simulate dmg for both ai controlled mons and for player controlled mons.
-    for (battlerDef = 0; battlerDef < battlersCount; battlerDef++)
+    for (battlerDef = 0; battlerDef < MAX_BATTLERS_COUNT; battlerDef++)
     {
-        if (battlerAtk == battlerDef || !IsBattlerAlive(battlerDef))
+        if (!(targets & (1u << battlerDef)))
             continue;
 
         SaveBattlerData(battlerDef);
@@ -429,6 +556,7 @@ static void SetBattlerAiMovesData(struct AiLogicData *aiData, u32 battlerAtk, u3
         {
             struct SimulatedDamage dmg = {0};
             u8 effectiveness = AI_EFFECTIVENESS_x0;
+            u8 accuracy = 0;
             move = moves[moveIndex];
 
             if (move != 0
@@ -437,19 +565,225 @@ static void SetBattlerAiMovesData(struct AiLogicData *aiData, u32 battlerAtk, u3
              && !(aiData->moveLimitations[battlerAtk] & (1u << moveIndex)))
             {
                 dmg = AI_CalcDamage(move, battlerAtk, battlerDef, &effectiveness, TRUE, weather, rollType);
-                aiData->moveAccuracy[battlerAtk][battlerDef][moveIndex] = Ai_SetMoveAccuracy(aiData, battlerAtk, battlerDef, move);
+                accuracy = Ai_SetMoveAccuracy(aiData, battlerAtk, battlerDef, move);
             }
-            aiData->simulatedDmg[battlerAtk][battlerDef][moveIndex] = dmg;
-            aiData->effectiveness[battlerAtk][battlerDef][moveIndex] = effectiveness;
+            cache->simulatedDmg[battlerAtk][battlerDef][moveIndex] = dmg;
+            cache->effectiveness[battlerAtk][battlerDef][moveIndex] = effectiveness;
+            cache->moveAccuracy[battlerAtk][battlerDef][moveIndex] = accuracy;
         }
         RestoreBattlerData(battlerDef);
     }
     RestoreBattlerData(battlerAtk);
 }
 
+static u32 HashAiMovesData(u32 hash, const void *data, u32 size)
+{
+    const u8 *bytes = data;
+    u32 i;
+
+    // FNV-1a
+    for (i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 16777619;
+    return hash;
+}
+
+static u32 HashAiMovesDataValue(u32 hash, u32 value)
+{
+    return HashAiMovesData(hash, &value, sizeof(value));
+}
+
+// Beat Up's damage depends on which of the user's party can join in.
+static u32 HashAiMovesDataParty(u32 hash, struct Pokemon *party)
+{
+    u32 i;
+
+    for (i = 0; i < PARTY_SIZE; i++)
+    {
+        hash = HashAiMovesDataValue(hash, GetMonData(&party[i], MON_DATA_SPECIES_OR_EGG));
+        hash = HashAiMovesDataValue(hash, GetMonData(&party[i], MON_DATA_HP));
+        hash = HashAiMovesDataValue(hash, GetMonData(&party[i], MON_DATA_STATUS));
+    }
+    return hash;
+}
+
+// Everything about a battler that its moves' damage, effectiveness and accuracy, or the moves used against it,
+// depend on.
+static u32 GetBattlerAiMovesDataKey(struct AiLogicData *aiData, u32 battler)
+{
+    u32 i;
+    u32 side = GetBattlerSide(battler);
+    u32 partyIndex = gBattlerPartyIndexes[battler];
+    struct BattlePokemon mon = gBattleMons[battler];
+    u16 *moves = GetMovesArray(battler);
+    u32 hash = 2166136261;
+
+    // PP only matters to Trump Card; how many are left of the other moves changes
+    // every turn they're used, and running out is covered by moveLimitations.
+    for (i = 0; i < MAX_MON_MOVES; i++)
+    {
+        if (gMovesInfo[mon.moves[i]].effect != EFFECT_TRUMP_CARD)
+            mon.pp[i] = 0;
+    }
+
+    hash = HashAiMovesData(hash, &mon, sizeof(mon));
+    hash = HashAiMovesDataValue(hash, gStatuses3[battler]);
+    hash = HashAiMovesDataValue(hash, gStatuses4[battler]);
+    hash = HashAiMovesData(hash, &gDisableStructs[battler], sizeof(gDisableStructs[battler]));
+    hash = HashAiMovesData(hash, &gProtectStructs[battler], sizeof(gProtectStructs[battler]));
+    hash = HashAiMovesData(hash, &gSpecialStatuses[battler], sizeof(gSpecialStatuses[battler]));
+    hash = HashAiMovesDataValue(hash, gBattleResources->flags->flags[battler]);
+    hash = HashAiMovesDataValue(hash, partyIndex);
+    hash = HashAiMovesDataValue(hash, gLastMoves[battler]);
+    hash = HashAiMovesDataValue(hash, gLastLandedMoves[battler]);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->sameMoveTurns[battler]);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->chosenMovePositions[battler]);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->timesGotHit[side][partyIndex]);
+    hash = HashAiMovesData(hash, &gBattleStruct->illusion[battler], sizeof(gBattleStruct->illusion[battler]));
+    hash = HashAiMovesDataValue(hash, gBattleStruct->gimmick.usableGimmick[battler]);
+    hash = HashAiMovesDataValue(hash, GetActiveGimmick(battler));
+    hash = HashAiMovesDataValue(hash, GetBattlerTeraType(battler));
+    hash = HashAiMovesDataValue(hash, gBattleStruct->supremeOverlordCounter[battler]);
+
+    // Only Beat Up depends on the rest of the party, which changes whenever the partner is hit in doubles,
+    // so the party is only hashed for battlers that know it.
+    for (i = 0; i < MAX_MON_MOVES; i++)
+    {
+        if (moves[i] != MOVE_NONE && moves[i] != 0xFFFF && gMovesInfo[moves[i]].effect == EFFECT_BEAT_UP)
+        {
+            hash = HashAiMovesDataParty(hash, GetBattlerParty(battler));
+            break;
+        }
+    }
+
+    // What the AI knows or assumes about it.
+    hash = HashAiMovesDataValue(hash, aiData->abilities[battler]);
+    hash = HashAiMovesDataValue(hash, aiData->items[battler]);
+    hash = HashAiMovesDataValue(hash, aiData->holdEffects[battler]);
+    hash = HashAiMovesDataValue(hash, aiData->holdEffectParams[battler]);
+    hash = HashAiMovesDataValue(hash, aiData->moveLimitations[battler]);
+    hash = HashAiMovesDataValue(hash, AI_THINKING_STRUCT->aiFlags[battler]);
+    hash = HashAiMovesDataValue(hash, BATTLE_HISTORY->abilities[battler]);
+    hash = HashAiMovesDataValue(hash, BATTLE_HISTORY->itemEffects[battler]);
+    hash = HashAiMovesData(hash, BATTLE_HISTORY->usedMoves[battler], sizeof(BATTLE_HISTORY->usedMoves[battler]));
+    hash = HashAiMovesData(hash, &AI_PARTY->mons[side][partyIndex], sizeof(AI_PARTY->mons[side][partyIndex]));
+    return hash;
+}
+
+// Everything that the damage, effectiveness and accuracy of any battler's moves depends on, including the few
+// things about every battler that matter to moves between other battlers, e.g. Friend Guard or Round.
+static u32 GetFieldAiMovesDataKey(struct AiLogicData *aiData)
+{
+    u32 i;
+    u32 hash = 2166136261;
+
+    hash = HashAiMovesDataValue(hash, gBattleWeather);
+    hash = HashAiMovesDataValue(hash, aiData->weatherHasEffect);
+    hash = HashAiMovesDataValue(hash, gFieldStatuses);
+    hash = HashAiMovesDataValue(hash, gBattleTypeFlags);
+    hash = HashAiMovesDataValue(hash, gBattlersCount);
+    hash = HashAiMovesDataValue(hash, gAbsentBattlerFlags);
+    hash = HashAiMovesDataValue(hash, gMultiHitCounter);
+    // Last Respects and Supreme Overlord count each side's fainted mons.
+    hash = HashAiMovesDataValue(hash, gBattleResults.playerFaintCounter);
+    hash = HashAiMovesDataValue(hash, gBattleResults.opponentFaintCounter);
+    hash = HashAiMovesDataValue(hash, gMovesInfo[gLastUsedMove].effect == EFFECT_FUSION_COMBO ? gLastUsedMove : MOVE_NONE);
+    hash = HashAiMovesData(hash, gActionsByTurnOrder, sizeof(gActionsByTurnOrder));
+    hash = HashAiMovesData(hash, gBattlerByTurnOrder, sizeof(gBattlerByTurnOrder));
+    // Mold Breaker and Protean look at whoever is using a move, if a turn is in progress.
+    hash = HashAiMovesDataValue(hash, gCurrentTurnActionNumber < gBattlersCount ? gBattlerAttacker : MAX_BATTLERS_COUNT);
+    hash = HashAiMovesDataValue(hash, gCurrentTurnActionNumber < gBattlersCount ? gCurrentMove : MOVE_NONE);
+    hash = HashAiMovesDataValue(hash, gDisableStructs[gBattlerAttacker].usedProteanLibero);
+    for (i = 0; i < NUM_BATTLE_SIDES; i++)
+    {
+        hash = HashAiMovesDataValue(hash, gSideStatuses[i]);
+        hash = HashAiMovesDataValue(hash, gSideTimers[i].retaliateTimer);
+        hash = HashAiMovesDataValue(hash, gBattleStruct->ateBerry[i]);
+    }
+    hash = HashAiMovesDataValue(hash, gBattleStruct->pledgeMove);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->fickleBeamBoosted);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->magnitudeBasePower);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->presentBasePower);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->lastMoveFailed);
+    hash = HashAiMovesDataValue(hash, gBattleStruct->boosterEnergyActivates);
+    hash = HashAiMovesData(hash, gBattleStruct->shellSideArmCategory, sizeof(gBattleStruct->shellSideArmCategory));
+
+    for (i = 0; i < gBattlersCount; i++)
+    {
+        hash = HashAiMovesDataValue(hash, gBattleMons[i].species);
+        hash = HashAiMovesDataValue(hash, gBattleMons[i].ability);
+        hash = HashAiMovesDataValue(hash, gBattleMons[i].item);
+        hash = HashAiMovesDataValue(hash, IsBattlerAlive(i));
+        hash = HashAiMovesData(hash, gBattleMons[i].types, sizeof(gBattleMons[i].types));
+        hash = HashAiMovesDataValue(hash, gStatuses3[i] & STATUS3_GASTRO_ACID);
+        hash = HashAiMovesDataValue(hash, gLastMoves[i] == MOVE_ROUND);
+    }
+    return hash;
+}
+
+#if DEBUG_AI_CHECK_MOVES_CACHE
+static void CheckAiMovesDataCache(struct AiMovesDataCache *cache, struct AiLogicData *aiData, u32 battlersCount, u32 weather)
+{
+    u32 battlerAtk, battlerDef, moveIndex, targets;
+    struct AiMovesDataCache *check = AllocZeroed(sizeof(*check));
+
+    for (battlerAtk = 0; battlerAtk < battlersCount; battlerAtk++)
+    {
+        if (!IsBattlerAlive(battlerAtk))
+            continue;
+
+        targets = 0;
+        for (battlerDef = 0; battlerDef < battlersCount; battlerDef++)
+        {
+            if (battlerAtk != battlerDef && IsBattlerAlive(battlerDef))
+                targets |= 1u << battlerDef;
+        }
+        SetBattlerAiMovesData(check, aiData, battlerAtk, targets, weather);
+
+        for (battlerDef = 0; battlerDef < battlersCount; battlerDef++)
+        {
+            if (!(targets & (1u << battlerDef)))
+                continue;
+
+            for (moveIndex = 0; moveIndex < MAX_MON_MOVES; moveIndex++)
+            {
+                if (cache->simulatedDmg[battlerAtk][battlerDef][moveIndex].expected != check->simulatedDmg[battlerAtk][battlerDef][moveIndex].expected
+                 || cache->simulatedDmg[battlerAtk][battlerDef][moveIndex].minimum != check->simulatedDmg[battlerAtk][battlerDef][moveIndex].minimum
+                 || cache->effectiveness[battlerAtk][battlerDef][moveIndex] != check->effectiveness[battlerAtk][battlerDef][moveIndex]
+                 || cache->moveAccuracy[battlerAtk][battlerDef][moveIndex] != check->moveAccuracy[battlerAtk][battlerDef][moveIndex])
+                {
+                #if TESTING
+                    Test_ExitWithResult(TEST_RESULT_FAIL, SourceLine(0), ":L%s:%d: AI moves cache: battler %d move %d against battler %d was %d/%d, is %d/%d",
+                                        gTestRunnerState.test->filename, SourceLine(0),
+                                        battlerAtk, moveIndex, battlerDef,
+                                        cache->simulatedDmg[battlerAtk][battlerDef][moveIndex].expected,
+                                        cache->simulatedDmg[battlerAtk][battlerDef][moveIndex].minimum,
+                                        check->simulatedDmg[battlerAtk][battlerDef][moveIndex].expected,
+                                        check->simulatedDmg[battlerAtk][battlerDef][moveIndex].minimum);
+                #else
+                    DebugPrintf("AI moves cache: battler %d move %d against battler %d was %d/%d, is %d/%d",
+                                battlerAtk, moveIndex, battlerDef,
+                                cache->simulatedDmg[battlerAtk][battlerDef][moveIndex].expected,
+                                cache->simulatedDmg[battlerAtk][battlerDef][moveIndex].minimum,
+                                check->simulatedDmg[battlerAtk][battlerDef][moveIndex].expected,
+                                check->simulatedDmg[battlerAtk][battlerDef][moveIndex].minimum);
+                #endif
+                }
+            }
+        }
+    }
+
+    memcpy(cache->simulatedDmg, check->simulatedDmg, sizeof(cache->simulatedDmg));
+    memcpy(cache->effectiveness, check->effectiveness, sizeof(cache->effectiveness));
+    memcpy(cache->moveAccuracy, check->moveAccuracy, sizeof(cache->moveAccuracy));
+    Free(check);
+}
+#endif // DEBUG_AI_CHECK_MOVES_CACHE
+
 void SetAiLogicDataForTurn(struct AiLogicData *aiData)
 {
-    u32 battlerAtk, battlersCount, weather;
+    u32 battlerAtk, battlerDef, battlersCount, weather, fieldKey, targets;
+    u32 battlerKeys[MAX_BATTLERS_COUNT];
+    struct AiMovesDataCache *cache = AI_MOVES_DATA_CACHE;
 
     memset(aiData, 0, sizeof(struct AiLogicData));
     if (!(gBattleTypeFlags & BATTLE_TYPE_HAS_AI) && !IsWildMonSmart())
@@ -473,12 +807,57 @@ void SetAiLogicDataForTurn(struct AiLogicData *aiData)
         SetBattlerAiData(battlerAtk, aiData);
     }
 
+    // Only simulate the damage between battlers if something that could change it has changed since last time.
+    fieldKey = GetFieldAiMovesDataKey(aiData);
+    if (fieldKey != cache->fieldKey)
+        memset(cache->validTargets, 0, sizeof(cache->validTargets));
+    cache->fieldKey = fieldKey;
+    for (battlerAtk = 0; battlerAtk < battlersCount; battlerAtk++)
+    {
+        battlerKeys[battlerAtk] = GetBattlerAiMovesDataKey(aiData, battlerAtk);
+        if (battlerKeys[battlerAtk] != cache->battlerKeys[battlerAtk])
+        {
+            cache->validTargets[battlerAtk] = 0;
+            for (battlerDef = 0; battlerDef < MAX_BATTLERS_COUNT; battlerDef++)
+                cache->validTargets[battlerDef] &= ~(1u << battlerAtk);
+        }
+        cache->battlerKeys[battlerAtk] = battlerKeys[battlerAtk];
+    }
+
     for (battlerAtk = 0; battlerAtk < battlersCount; battlerAtk++)
     {
         if (!IsBattlerAlive(battlerAtk))
+        {
+            cache->validTargets[battlerAtk] = 0;
             continue;
+        }
 
-        SetBattlerAiMovesData(aiData, battlerAtk, battlersCount, weather);
+        targets = 0;
+        for (battlerDef = 0; battlerDef < battlersCount; battlerDef++)
+        {
+            if (battlerAtk != battlerDef && IsBattlerAlive(battlerDef))
+                targets |= 1u << battlerDef;
+        }
+        if (targets & ~cache->validTargets[battlerAtk])
+            SetBattlerAiMovesData(cache, aiData, battlerAtk, targets & ~cache->validTargets[battlerAtk], weather);
+        cache->validTargets[battlerAtk] = targets;
+    }
+
+#if DEBUG_AI_CHECK_MOVES_CACHE
+    CheckAiMovesDataCache(cache, aiData, battlersCount, weather);
+#endif
+
+    for (battlerAtk = 0; battlerAtk < battlersCount; battlerAtk++)
+    {
+        for (battlerDef = 0; battlerDef < battlersCount; battlerDef++)
+        {
+            if (!(cache->validTargets[battlerAtk] & (1u << battlerDef)))
+                continue;
+
+            memcpy(aiData->simulatedDmg[battlerAtk][battlerDef], cache->simulatedDmg[battlerAtk][battlerDef], sizeof(aiData->simulatedDmg[battlerAtk][battlerDef]));
+            memcpy(aiData->effectiveness[battlerAtk][battlerDef], cache->effectiveness[battlerAtk][battlerDef], sizeof(aiData->effectiveness[battlerAtk][battlerDef]));
+            memcpy(aiData->moveAccuracy[battlerAtk][battlerDef], cache->moveAccuracy[battlerAtk][battlerDef], sizeof(aiData->moveAccuracy[battlerAtk][battlerDef]));
+        }
     }
     AI_DATA->aiCalcInProgress = FALSE;
 }
@@ -489,18 +868,6 @@ static u32 ChooseMoveOrAction_Singles(u32 battlerAi)
     u8 consideredMoveArray[MAX_MON_MOVES];
     u32 numOfBestMoves;
     s32 i;
-    u32 flags = AI_THINKING_STRUCT->aiFlags[battlerAi];
-
-    AI_DATA->partnerMove = 0;   // no ally
-    while (flags != 0)
-    {
-        if (flags & 1)
-        {
-            BattleAI_DoAIProcessing(AI_THINKING_STRUCT, battlerAi, gBattlerTarget);
-        }
-        flags >>= 1;
-        AI_THINKING_STRUCT->aiLogicId++;
-    }
 
     for (i = 0; i < MAX_MON_MOVES; i++)
     {
@@ -538,21 +905,22 @@ static u32 ChooseMoveOrAction_Singles(u32 battlerAi)
     return consideredMoveArray[Random() % numOfBestMoves];
 }
 
-static u32 ChooseMoveOrAction_Doubles(u32 battlerAi)
+static bool32 ChooseMoveOrAction_Doubles(struct AiThinkingProgress *thinking, u32 *moveOrAction)
 {
     s32 i, j;
-    u32 flags;
-    s32 bestMovePointsForTarget[MAX_BATTLERS_COUNT];
+    u32 battlerAi = thinking->battler;
+    s32 *bestMovePointsForTarget = thinking->bestMovePointsForTarget;
     u8 mostViableTargetsArray[MAX_BATTLERS_COUNT];
-    u8 actionOrMoveIndex[MAX_BATTLERS_COUNT];
+    u8 *actionOrMoveIndex = thinking->actionOrMoveIndex;
     s32 mostViableMovesScores[MAX_MON_MOVES];
     u8 mostViableMovesIndices[MAX_MON_MOVES];
     u32 mostViableTargetsNo;
     u32 mostViableMovesNo;
     s32 mostMovePoints;
 
-    for (i = 0; i < MAX_BATTLERS_COUNT; i++)
+    for (; thinking->target < MAX_BATTLERS_COUNT; thinking->target++)
     {
+        i = thinking->target;
         if (i == battlerAi || gBattleMons[i].hp == 0)
         {
             actionOrMoveIndex[i] = 0xFF;
@@ -560,28 +928,25 @@ static u32 ChooseMoveOrAction_Doubles(u32 battlerAi)
         }
         else
         {
-            if (gBattleTypeFlags & BATTLE_TYPE_PALACE)
-                BattleAI_SetupAIData(gBattleStruct->palaceFlags >> 4, battlerAi);
-            else
-                BattleAI_SetupAIData(0xF, battlerAi);
-
-            gBattlerTarget = i;
-
-            AI_DATA->partnerMove = GetAllyChosenMove(battlerAi);
-            AI_THINKING_STRUCT->aiLogicId = 0;
-            AI_THINKING_STRUCT->movesetIndex = 0;
-            flags = AI_THINKING_STRUCT->aiFlags[sBattler_AI];
-
-            while (flags != 0)
+            if (!thinking->targetStarted)
             {
-                if (flags & 1)
-                {
-                    BattleAI_DoAIProcessing(AI_THINKING_STRUCT, battlerAi, gBattlerTarget);
-                }
-                flags >>= 1;
-                AI_THINKING_STRUCT->aiLogicId++;
+                if (gBattleTypeFlags & BATTLE_TYPE_PALACE)
+                    BattleAI_SetupAIData(gBattleStruct->palaceFlags >> 4, battlerAi);
+                else
+                    BattleAI_SetupAIData(0xF, battlerAi);
+
+                AI_DATA->partnerMove = GetAllyChosenMove(battlerAi);
+                AI_THINKING_STRUCT->aiLogicId = 0;
+                AI_THINKING_STRUCT->movesetIndex = 0;
+                thinking->flags = GetAiThinkingFlags(thinking);
+                thinking->targetStarted = TRUE;
             }
 
+            gBattlerTarget = i;
+            if (!RunAiFlags(thinking, battlerAi, gBattlerTarget))
+                return FALSE;
+            thinking->targetStarted = FALSE;
+
             if (AI_THINKING_STRUCT->aiAction & AI_ACTION_FLEE)
             {
                 actionOrMoveIndex[i] = AI_CHOICE_FLEE;
@@ -654,7 +1019,8 @@ static u32 ChooseMoveOrAction_Doubles(u32 battlerAi)
 
     gBattlerTarget = mostViableTargetsArray[Random() % mostViableTargetsNo];
     gBattleStruct->aiChosenTarget[battlerAi] = gBattlerTarget;
-    return actionOrMoveIndex[gBattlerTarget];
+    *moveOrAction = actionOrMoveIndex[gBattlerTarget];
+    return TRUE;
 }
 
 static inline bool32 ShouldConsiderMoveForBattler(u32 battlerAi, u32 battlerDef, u32 move)
@@ -37,6 +37,86 @@ static void InitializeSwitchinCandidate(struct Pokemon *mon)
     AI_DATA->switchinCandidate.hypotheticalStatus = FALSE;
 }
 
+// Called when the battle has moved on since the AI last decided whether to switch, e.g. when it has to choose a mon
+// to replace one that fainted.
+void ClearSwitchinMatchups(u32 battler)
+{
+    memset(AI_DATA->switchinMatchups[battler], 0, sizeof(AI_DATA->switchinMatchups[battler]));
+}
+
+static struct AiSwitchinMatchup *GetSwitchinMatchup(u32 battler, u32 partyIndex, u32 opposingBattler)
+{
+    struct AiSwitchinMatchup *matchup = &AI_DATA->switchinMatchups[battler][partyIndex][opposingBattler];
+    u32 i, move;
+
+    if (!matchup->hasEffectiveness)
+    {
+        struct Pokemon *mon = &GetBattlerParty(battler)[partyIndex];
+
+        for (i = 0; i < MAX_MON_MOVES; i++)
+        {
+            move = GetMonData(mon, MON_DATA_MOVE1 + i);
+            if (move != MOVE_NONE)
+                matchup->effectiveness[i] = AI_GetMoveEffectiveness(move, battler, opposingBattler);
+        }
+        matchup->hasEffectiveness = TRUE;
+    }
+    return matchup;
+}
+
+// Puts the switchin candidate, which has to be the party mon, in the battler's place once to simulate all of the damage
+// both ways, rather than once per move. The candidate can have a hypothetical status from Toxic Spikes, so the damage
+// is simulated again if its status has changed since.
+static struct AiSwitchinMatchup *GetSwitchinMatchupWithDamage(u32 battler, u32 partyIndex, u32 opposingBattler, enum DamageRollType rollType)
+{
+    struct AiSwitchinMatchup *matchup = GetSwitchinMatchup(battler, partyIndex, opposingBattler);
+    struct BattlePokemon *savedBattleMons;
+    u32 i, move, weather;
+    u32 status = AI_DATA->switchinCandidate.battleMon.status1 & ~STATUS1_TOXIC_COUNTER;
+    s32 damage;
+    u8 effectiveness;
+
+    if (matchup->hasDamage && matchup->damageRollType == rollType && matchup->damageStatus == status)
+        return matchup;
+
+    savedBattleMons = AllocSaveBattleMons();
+    weather = AI_GetWeather(AI_DATA);
+    gBattleMons[battler] = AI_DATA->switchinCandidate.battleMon;
+    SetBattlerAiData(battler, AI_DATA);
+
+    matchup->maxDamageTaken = 0;
+    for (i = 0; i < MAX_MON_MOVES; i++)
+    {
+        move = gBattleMons[opposingBattler].moves[i];
+        if (move != MOVE_NONE && gMovesInfo[move].power != 0)
+        {
+            damage = AI_CalcDamage(move, opposingBattler, battler, &effectiveness, FALSE, weather, DMG_ROLL_HIGHEST).expected;
+            if (damage > matchup->maxDamageTaken)
+                matchup->maxDamageTaken = damage;
+        }
+    }
+
+    matchup->strikesFirst = 0;
+    for (i = 0; i < MAX_MON_MOVES; i++)
+    {
+        move = gBattleMons[battler].moves[i];
+        matchup->damageDealt[i] = 0;
+        if (move != MOVE_NONE && gMovesInfo[move].power != 0)
+            matchup->damageDealt[i] = AI_CalcDamage(move, battler, opposingBattler, &effectiveness, FALSE, weather, rollType).expected;
+        if (AI_IsFaster(battler, opposingBattler, move))
+            matchup->strikesFirst |= 1u << i;
+    }
+
+    // restores original gBattleMon struct
+    FreeRestoreBattleMons(savedBattleMons);
+    SetBattlerAiData(battler, AI_DATA);
+
+    matchup->damageRollType = rollType;
+    matchup->damageStatus = status;
+    matchup->hasDamage = TRUE;
+    return matchup;
+}
+
 static bool32 IsAceMon(u32 battler, u32 monPartyId)
 {
     if (AI_THINKING_STRUCT->aiFlags[battler] & AI_FLAG_ACE_POKEMON
@@ -747,7 +827,7 @@ static bool32 FindMonWithFlagsAndSuperEffective(u32 battler, u16 flags, u32 perc
                 if (move == 0)
                     continue;
 
-                if (AI_GetMoveEffectiveness(move, battler, battlerIn1) >= AI_EFFECTIVENESS_x2 && RandomPercentage(RNG_AI_SWITCH_SE_DEFENSIVE, percentChance))
+                if (GetSwitchinMatchup(battler, i, battlerIn1)->effectiveness[j] >= AI_EFFECTIVENESS_x2 && RandomPercentage(RNG_AI_SWITCH_SE_DEFENSIVE, percentChance))
                     return SetSwitchinAndSwitch(battler, i);
             }
         }
@@ -1201,7 +1281,7 @@ static u32 GetBestMonTypeMatchup(struct Pokemon *party, int firstId, int lastId,
             for (i = 0; i < MAX_MON_MOVES; i++)
             {
                 u32 move = GetMonData(&party[bestMonId], MON_DATA_MOVE1 + i);
-                if (move != MOVE_NONE && AI_GetMoveEffectiveness(move, battler, opposingBattler) >= AI_EFFECTIVENESS_x2)
+                if (move != MOVE_NONE && GetSwitchinMatchup(battler, bestMonId, opposingBattler)->effectiveness[i] >= AI_EFFECTIVENESS_x2)
                     break;
             }
 
@@ -1225,6 +1305,7 @@ static u32 GetBestMonDmg(struct Pokemon *party, int firstId, int lastId, u8 inva
     int dmg, bestDmg = 0;
     int bestMonId = PARTY_SIZE;
     u32 rollType = GetDmgRollType(battler);
+    struct AiSwitchinMatchup *matchup;
 
     u32 aiMove;
 
@@ -1235,13 +1316,13 @@ static u32 GetBestMonDmg(struct Pokemon *party, int firstId, int lastId, u8 inva
         if ((1 << (i)) & invalidMons)
             continue;
         InitializeSwitchinCandidate(&party[i]);
+        matchup = GetSwitchinMatchupWithDamage(battler, i, opposingBattler, rollType);
         for (j = 0; j < MAX_MON_MOVES; j++)
         {
             aiMove = AI_DATA->switchinCandidate.battleMon.moves[j];
             if (aiMove != MOVE_NONE && gMovesInfo[aiMove].power != 0)
             {
-                aiMove = GetMonData(&party[i], MON_DATA_MOVE1 + j);
-                dmg = AI_CalcPartyMonDamage(aiMove, battler, opposingBattler, AI_DATA->switchinCandidate.battleMon, TRUE, rollType);
+                dmg = matchup->damageDealt[j];
                 if (bestDmg < dmg)
                 {
                     bestDmg = dmg;
@@ -1685,25 +1766,6 @@ static int GetRandomSwitchinWithBatonPass(int aliveCount, int bits, int firstId,
         return PARTY_SIZE;
 }
 
-static s32 GetMaxDamagePlayerCouldDealToSwitchin(u32 battler, u32 opposingBattler, struct BattlePokemon battleMon)
-{
-    int i = 0;
-    u32 playerMove;
-    s32 damageTaken = 0, maxDamageTaken = 0;
-
-    for (i = 0; i < MAX_MON_MOVES; i++)
-    {
-        playerMove = gBattleMons[opposingBattler].moves[i];
-        if (playerMove != MOVE_NONE && gMovesInfo[playerMove].power != 0)
-        {
-            damageTaken = AI_CalcPartyMonDamage(playerMove, opposingBattler, battler, battleMon, FALSE, DMG_ROLL_HIGHEST);
-            if (damageTaken > maxDamageTaken)
-                maxDamageTaken = damageTaken;
-        }
-    }
-    return maxDamageTaken;
-}
-
 static bool32 CanAbilityTrapOpponent(u16 ability, u32 opponent)
 {
     if ((B_GHOSTS_ESCAPE >= GEN_6 && IS_BATTLER_OF_TYPE(opponent, TYPE_GHOST)))
@@ -1777,6 +1839,8 @@ static u32 GetBestMonIntegrated(struct Pokemon *party, int firstId, int lastId,
     u32 aiMove, hitsToKOAI, maxHitsToKO = 0;
     u16 bestResist = UQ_4_12(1.0), bestResistEffective = UQ_4_12(1.0), typeMatchup;
     bool32 isFreeSwitch = IsFreeSwitch(isSwitchAfterKO, battlerIn1, opposingBattler), isSwitchinFirst, canSwitchinWin1v1;
+    enum DamageRollType rollType = (AI_THINKING_STRUCT->aiFlags[battler] & AI_FLAG_CONSERVATIVE) ? DMG_ROLL_LOWEST : DMG_ROLL_DEFAULT;
+    struct AiSwitchinMatchup *matchup;
 
     // Iterate through mons
     for (i = firstId; i < lastId; i++)
@@ -1805,10 +1869,15 @@ static u32 GetBestMonIntegrated(struct Pokemon *party, int firstId, int lastId,
         if (AI_DATA->switchinCandidate.battleMon.ability == ABILITY_TRUANT && IsTruantMonVulnerable(battler, opposingBattler))
             continue;
 
+        matchup = GetSwitchinMatchupWithDamage(battler, i, opposingBattler, rollType);
+
         // Get max number of hits for player to KO AI mon and type matchup for defensive switching
-        hitsToKOAI = GetSwitchinHitsToKO(GetMaxDamagePlayerCouldDealToSwitchin(battler, opposingBattler, AI_DATA->switchinCandidate.battleMon), battler);
+        hitsToKOAI = GetSwitchinHitsToKO(matchup->maxDamageTaken, battler);
         typeMatchup = GetSwitchinTypeMatchup(opposingBattler, AI_DATA->switchinCandidate.battleMon);
 
+        // GetSwitchinHitsToKO can leave the candidate with the status it would get from Toxic Spikes
+        matchup = GetSwitchinMatchupWithDamage(battler, i, opposingBattler, rollType);
+
         // Track max hits to KO and set defensive mon
         if(hitsToKOAI > maxHitsToKO)
         {
@@ -1823,15 +1892,10 @@ static u32 GetBestMonIntegrated(struct Pokemon *party, int firstId, int lastId,
             aiMove = AI_DATA->switchinCandidate.battleMon.moves[j];
 
             if (aiMove != MOVE_NONE && gMovesInfo[aiMove].power != 0)
-            {
-                if (AI_THINKING_STRUCT->aiFlags[battler] & AI_FLAG_CONSERVATIVE)
-                    damageDealt = AI_CalcPartyMonDamage(aiMove, battler, opposingBattler, AI_DATA->switchinCandidate.battleMon, TRUE, DMG_ROLL_LOWEST);
-                else
-                    damageDealt = AI_CalcPartyMonDamage(aiMove, battler, opposingBattler, AI_DATA->switchinCandidate.battleMon, TRUE, DMG_ROLL_DEFAULT);
-            }
+                damageDealt = matchup->damageDealt[j];
 
             // Offensive switchin decisions are based on which whether switchin moves first and whether it can win a 1v1
-            isSwitchinFirst = AI_WhoStrikesFirstPartyMon(battler, opposingBattler, AI_DATA->switchinCandidate.battleMon, aiMove);
+            isSwitchinFirst = (matchup->strikesFirst >> j) & 1;
             canSwitchinWin1v1 = CanSwitchinWin1v1(hitsToKOAI, GetNoOfHitsToKOBattlerDmg(damageDealt, opposingBattler), isSwitchinFirst, isFreeSwitch);
 
             // Check for Baton Pass; hitsToKO requirements mean mon can boost and BP without dying whether it's slower or not
@@ -1856,7 +1920,7 @@ static u32 GetBestMonIntegrated(struct Pokemon *party, int firstId, int lastId,
             {
                 if (typeMatchup < bestResistEffective)
                 {
-                    if (AI_GetMoveEffectiveness(aiMove, battler, opposingBattler) >= AI_EFFECTIVENESS_x2)
+                    if (matchup->effectiveness[j] >= AI_EFFECTIVENESS_x2)
                     {
                         if (canSwitchinWin1v1)
                         {
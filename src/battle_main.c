@@ -4185,7 +4185,8 @@ enum
     STATE_WAIT_ACTION_CONFIRMED,
     STATE_SELECTION_SCRIPT,
     STATE_WAIT_SET_BEFORE_ACTION,
-    STATE_SELECTION_SCRIPT_MAY_RUN
+    STATE_SELECTION_SCRIPT_MAY_RUN,
+    STATE_AI_THINKING,
 };
 
 static void HandleTurnActionSelectionState(void)
@@ -4200,28 +4201,46 @@ static void HandleTurnActionSelectionState(void)
         {
         case STATE_TURN_START_RECORD: // Recorded battle related action on start of every turn.
             RecordedBattle_CopyBattlerMoves(battler);
-            gBattleCommunication[battler] = STATE_BEFORE_ACTION_CHOSEN;
-            u32 isAiRisky = AI_THINKING_STRUCT->aiFlags[battler] & AI_FLAG_RISKY; // Risky AI switches aggressively even mid battle
-
+            gBattleCommunication[battler] = STATE_AI_THINKING;
+            // fallthrough
+        case STATE_AI_THINKING:
             // Do AI score computations here so we can use them in AI_TrySwitchOrUseItem
             if ((gBattleTypeFlags & BATTLE_TYPE_HAS_AI || IsWildMonSmart())
                     && (BattlerHasAi(battler) && !(gBattleTypeFlags & BATTLE_TYPE_PALACE)))
             {
+                u32 moveOrAction;
+
+                // The AI thinks for one battler at a time.
+                if (AI_DATA->thinking.inProgress && AI_DATA->thinking.battler != battler)
+                    break;
+
                 AI_DATA->aiCalcInProgress = TRUE;
+                if (!AI_DATA->thinking.inProgress)
+                {
+                    u32 isAiRisky = AI_THINKING_STRUCT->aiFlags[battler] & AI_FLAG_RISKY; // Risky AI switches aggressively even mid battle
 
-                // Setup battler data
-                sBattler_AI = battler;
-                BattleAI_SetupAIData(0xF, sBattler_AI);
+                    // Setup battler data
+                    sBattler_AI = battler;
+                    BattleAI_SetupAIData(0xF, sBattler_AI);
 
-                // Setup switching data
-                AI_DATA->mostSuitableMonId[battler] = GetMostSuitableMonToSwitchInto(battler, isAiRisky);
-                if (ShouldSwitch(battler))
-                    AI_DATA->shouldSwitch |= (1u << battler);
+                    // Setup switching data
+                    AI_DATA->mostSuitableMonId[battler] = GetMostSuitableMonToSwitchInto(battler, isAiRisky);
+                    if (ShouldSwitch(battler))
+                        AI_DATA->shouldSwitch |= (1u << battler);
 
-                // Do scoring
-                gBattleStruct->aiMoveOrAction[battler] = BattleAI_ChooseMoveOrAction();
+                    BattleAI_StartChoosingMoveOrAction(TRUE);
+                }
+
+                // Do scoring, over several frames if B_AI_THINK_SCANLINES is set
+                if (!BattleAI_ContinueChoosingMoveOrAction(&moveOrAction))
+                {
+                    AI_DATA->aiCalcInProgress = FALSE;
+                    break;
+                }
+                gBattleStruct->aiMoveOrAction[battler] = moveOrAction;
                 AI_DATA->aiCalcInProgress = FALSE;
             }
+            gBattleCommunication[battler] = STATE_BEFORE_ACTION_CHOSEN;
             // fallthrough
         case STATE_BEFORE_ACTION_CHOSEN: // Choose an action.
             *(gBattleStruct->monToSwitchIntoId + battler) = PARTY_SIZE;
@@ -1,5 +1,5 @@
 //
-// DO NOT MODIFY THIS FILE! It is auto-generated from tools/learnset_helpers/teachable.py
+// DO NOT MODIFY THIS FILE! It is auto-generated from tools/learnset_helpers/teachable.cpp
 //
 
 // *************************************************** //
@@ -168,6 +168,7 @@ void AgbMainLoop(void)
 
         PlayTimeCounter_Update();
         MapMusicMain();
+        TestRunner_RecordFrame();
         WaitForVBlank();
     }
 }
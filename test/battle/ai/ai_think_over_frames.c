@@ -0,0 +1,80 @@
+#include "global.h"
+#include "test/battle.h"
+
+// With a budget of one scanline the AI stops after nearly every flag, so it has to pick up where it left off each frame.
+AI_SINGLE_BATTLE_TEST("AI chooses the same move when it thinks over several frames")
+{
+    bool32 overFrames;
+
+    PARAMETRIZE { overFrames = FALSE; }
+    PARAMETRIZE { overFrames = TRUE; }
+
+    GIVEN {
+        if (overFrames)
+            AI_THINK_OVER_FRAMES(1, 255);
+        AI_FLAGS(AI_FLAG_CHECK_BAD_MOVE | AI_FLAG_CHECK_VIABILITY | AI_FLAG_TRY_TO_FAINT);
+        PLAYER(SPECIES_TYPHLOSION);
+        PLAYER(SPECIES_WOBBUFFET);
+        OPPONENT(SPECIES_NIDOQUEEN) { Moves(MOVE_WATERFALL, MOVE_SCALD, MOVE_POISON_JAB, MOVE_WATER_GUN); }
+    } WHEN {
+        TURN { EXPECT_MOVE(opponent, MOVE_WATERFALL); }
+    }
+}
+
+// In doubles the AI also has to go back to the target it was scoring its moves against.
+AI_DOUBLE_BATTLE_TEST("AI chooses the same move when it thinks over several frames in doubles")
+{
+    bool32 overFrames;
+    u32 species;
+
+    PARAMETRIZE { overFrames = FALSE; species = SPECIES_CHARIZARD; }
+    PARAMETRIZE { overFrames = TRUE; species = SPECIES_CHARIZARD; }
+    PARAMETRIZE { overFrames = FALSE; species = SPECIES_CHARMANDER; }
+    PARAMETRIZE { overFrames = TRUE; species = SPECIES_CHARMANDER; }
+
+    GIVEN {
+        ASSUME(gMovesInfo[MOVE_EARTHQUAKE].target == MOVE_TARGET_FOES_AND_ALLY);
+        if (overFrames)
+            AI_THINK_OVER_FRAMES(1, 255);
+        AI_FLAGS(AI_FLAG_CHECK_BAD_MOVE | AI_FLAG_CHECK_VIABILITY | AI_FLAG_TRY_TO_FAINT);
+        PLAYER(SPECIES_WOBBUFFET);
+        PLAYER(SPECIES_WOBBUFFET);
+        OPPONENT(SPECIES_PHANPY) { Moves(MOVE_EARTHQUAKE, MOVE_TACKLE); }
+        OPPONENT(species) { Moves(MOVE_CELEBRATE); }
+    } WHEN {
+        if (species == SPECIES_CHARIZARD)
+            TURN { EXPECT_MOVE(opponentLeft, MOVE_EARTHQUAKE); }
+        else
+            TURN { EXPECT_MOVE(opponentLeft, MOVE_TACKLE); }
+    }
+}
+
+// A one scanline budget runs about one flag a frame, and the AI runs four flags against each target in doubles, so
+// after six frames it has scored its first target with every flag and is partway through the second. Running out of
+// time then must not leave the first target with a score from more flags than the others.
+AI_DOUBLE_BATTLE_TEST("AI scores every target with the same flags when it runs out of time partway through them")
+{
+    bool32 overFrames;
+
+    PARAMETRIZE { overFrames = FALSE; }
+    PARAMETRIZE { overFrames = TRUE; }
+
+    GIVEN {
+        if (overFrames)
+        {
+            AI_THINK_OVER_FRAMES(1, 6);
+            AI_FLAGS(AI_FLAG_CHECK_BAD_MOVE | AI_FLAG_CHECK_VIABILITY | AI_FLAG_TRY_TO_FAINT);
+        }
+        else
+        {
+            // What the AI is left with once it has run out of time.
+            AI_FLAGS(AI_FLAG_CHECK_BAD_MOVE | AI_FLAG_TRY_TO_FAINT);
+        }
+        PLAYER(SPECIES_WOBBUFFET);
+        PLAYER(SPECIES_WOBBUFFET) { HP(1); }
+        OPPONENT(SPECIES_WOBBUFFET) { Moves(MOVE_TACKLE, MOVE_CELEBRATE); }
+        OPPONENT(SPECIES_WOBBUFFET) { Moves(MOVE_CELEBRATE); }
+    } WHEN {
+        TURN { EXPECT_MOVE(opponentLeft, MOVE_TACKLE, target: playerRight); }
+    }
+}
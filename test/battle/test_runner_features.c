@@ -25,3 +25,19 @@ SINGLE_BATTLE_TEST("Forced abilities activate on switch-in")
         MESSAGE("Kadabra's Sp. Atk was heightened!");
     }
 }
+
+// Trial n must see the same RNG whichever shard runs it, otherwise a
+// sharded run could pass or fail differently from an unsharded one.
+SINGLE_BATTLE_TEST("PASSES_RANDOMLY with a tag seeds each trial the same way however the trials are sharded")
+{
+    PASSES_RANDOMLY(1, 1, RNG_DAMAGE_MODIFIER);
+    GIVEN {
+        PLAYER(SPECIES_WOBBUFFET);
+        OPPONENT(SPECIES_WOBBUFFET);
+    } WHEN {
+        TURN { MOVE(player, MOVE_TACKLE); }
+    } THEN {
+        rng_value_t seed = GetTrialRngSeed(gBattleTestRunnerState->runTrial);
+        EXPECT(memcmp(&gBattleTestRunnerState->data.recordedBattle.rngSeed, &seed, sizeof(seed)) == 0);
+    }
+}
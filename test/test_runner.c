@@ -11,6 +11,9 @@
 #include "test/test.h"
 
 #define TIMEOUT_SECONDS 55
+#define TIMER2_RELOAD (UINT16_MAX - (274 * 60)) // Approx. 1 second.
+#define TIMER2_TICKS_PER_OVERFLOW (0x10000 - TIMER2_RELOAD)
+#define TIMER2_CYCLES_PER_TICK 1024 // Hydra's CYCLES_PER_TICK must match.
 
 void CB2_TestRunner(void);
 
@@ -63,43 +66,94 @@ enum
     STATE_EXIT,
 };
 
-static u32 MinCostProcess(void)
+static bool32 ProcessCostLess(u32 a, u32 b)
+{
+    if (gTestRunnerState.processCosts[a] != gTestRunnerState.processCosts[b])
+        return gTestRunnerState.processCosts[a] < gTestRunnerState.processCosts[b];
+    return a < b;
+}
+
+static void InitProcessHeap(void)
 {
     u32 i;
-    u32 minCost, minCostProcess;
+    for (i = 0; i < gTestRunnerN; i++)
+    {
+        gTestRunnerState.processCosts[i] = 0;
+        gTestRunnerState.processHeap[i] = i;
+    }
+}
+
+// processHeap is a min heap ordered by (cost, process) so that ties go
+// to the lowest-numbered process.
+static u32 MinCostProcess(void)
+{
+    return gTestRunnerState.processHeap[0];
+}
+
+static void AddCostToMinCostProcess(u32 cost)
+{
+    u8 *heap = gTestRunnerState.processHeap;
+    u32 i = 0;
+    u32 process = heap[0];
 
-    minCost = gTestRunnerState.processCosts[0];
-    minCostProcess = 0;
-    for (i = 1; i < gTestRunnerN; i++)
+    gTestRunnerState.processCosts[process] += cost;
+    while (TRUE)
     {
-        if (gTestRunnerState.processCosts[i] < minCost)
-        {
-            minCost = gTestRunnerState.processCosts[i];
-            minCostProcess = i;
-        }
+        u32 child = 2 * i + 1;
+        if (child >= gTestRunnerN)
+            break;
+        if (child + 1 < gTestRunnerN && ProcessCostLess(heap[child + 1], heap[child]))
+            child++;
+        if (!ProcessCostLess(heap[child], process))
+            break;
+        heap[i] = heap[child];
+        i = child;
     }
+    heap[i] = process;
+}
 
-    return minCostProcess;
+// Returns the runner that Hydra scheduled the current test on, or
+// TEST_RUNNER_UNSCHEDULED if it has no measured costs for this ROM.
+static u32 ScheduledRunner(void)
+{
+    u32 testIndex = gTestRunnerState.test - __start_tests;
+    if (testIndex >= ARRAY_COUNT(gTestRunnerSchedule))
+        return TEST_RUNNER_UNSCHEDULED;
+    if (gTestRunnerSchedule[testIndex] == TEST_RUNNER_SHARDED)
+        return gTestRunnerI;
+    return gTestRunnerSchedule[testIndex];
+}
+
+static bool32 IsTrialSharded(void)
+{
+    u32 testIndex = gTestRunnerState.test - __start_tests;
+    return testIndex < ARRAY_COUNT(gTestRunnerSchedule)
+        && gTestRunnerSchedule[testIndex] == TEST_RUNNER_SHARDED
+        && gTestRunnerTrialShard < gTestRunnerTrialShards;
 }
 
-// Greedily assign tests to processes based on estimated cost.
-// TODO: Make processCosts a min heap.
+// Assign tests to processes using Hydra's schedule if there is one,
+// otherwise greedily based on estimated cost.
 static u32 AssignCostToRunner(void)
 {
-    u32 minCostProcess;
+    u32 minCostProcess, scheduledRunner;
 
     if (gTestRunnerState.test->runner == &gAssumptionsRunner)
         return gTestRunnerI;
 
+    scheduledRunner = ScheduledRunner();
+    if (scheduledRunner != TEST_RUNNER_UNSCHEDULED)
+        return scheduledRunner;
+
     minCostProcess = MinCostProcess();
 
     // XXX: If estimateCost returns only on some processes, or
     // returns inconsistent results then processCosts will be
     // inconsistent and some tests may not run.
     if (gTestRunnerState.test->runner->estimateCost)
-        gTestRunnerState.processCosts[minCostProcess] += gTestRunnerState.test->runner->estimateCost(gTestRunnerState.test->data);
+        AddCostToMinCostProcess(gTestRunnerState.test->runner->estimateCost(gTestRunnerState.test->data));
     else
-        gTestRunnerState.processCosts[minCostProcess] += 1;
+        AddCostToMinCostProcess(1);
 
     return minCostProcess;
 }
@@ -127,6 +181,8 @@ top:
 
         gSaveBlock2Ptr->optionsBattleStyle = OPTIONS_BATTLE_STYLE_SET;
 
+        InitProcessHeap();
+
         // The current test restarted the ROM (e.g. by jumping to NULL).
         if (sCurrentTest.address != 0)
         {
@@ -138,8 +194,12 @@ top:
             }
             if (sCurrentTest.state == CURRENT_TEST_STATE_ESTIMATE)
             {
-                u32 runner = MinCostProcess();
-                gTestRunnerState.processCosts[runner] += 1;
+                u32 runner = ScheduledRunner();
+                if (runner == TEST_RUNNER_UNSCHEDULED)
+                {
+                    runner = MinCostProcess();
+                    AddCostToMinCostProcess(1);
+                }
                 if (runner == gTestRunnerI)
                 {
                     gTestRunnerState.state = STATE_REPORT_RESULT;
@@ -193,7 +253,7 @@ top:
         InitHeap(gHeap, HEAP_SIZE);
         ResetTasks();
         EnableInterrupts(INTR_FLAG_TIMER2);
-        REG_TM2CNT_L = UINT16_MAX - (274 * 60); // Approx. 1 second.
+        REG_TM2CNT_L = TIMER2_RELOAD;
         REG_TM2CNT_H = TIMER_ENABLE | TIMER_INTR_ENABLE | TIMER_1024CLK;
 
         sCurrentTest.address = (uintptr_t)gTestRunnerState.test;
@@ -211,6 +271,22 @@ top:
     case STATE_RUN_TEST:
         gTestRunnerState.state = STATE_REPORT_RESULT;
         sCurrentTest.state = CURRENT_TEST_STATE_RUN;
+        Test_MgbaPrintf(":S%d", gTestRunnerState.test - __start_tests);
+        if (IsTrialSharded())
+        {
+            gTestRunnerState.trialShard = gTestRunnerTrialShard;
+            gTestRunnerState.trialShards = gTestRunnerTrialShards;
+        }
+        else
+        {
+            gTestRunnerState.trialShard = 0;
+            gTestRunnerState.trialShards = 1;
+        }
+        gTestRunnerState.profiling = TRUE;
+        gTestRunnerState.frames = 0;
+        gTestRunnerState.vblankCounterStart = gMain.vblankCounter1;
+        gTestRunnerState.timer2Overflows = 0;
+        gTestRunnerState.timer2Start = REG_TM2CNT_L;
         SeedRng(0);
         SeedRng2(0);
         if (gTestRunnerState.test->runner->setUp)
@@ -232,6 +308,18 @@ top:
         break;
 
     case STATE_REPORT_RESULT:
+        if (gTestRunnerState.profiling)
+        {
+            // Read the timer before it is stopped. Unsigned arithmetic handles
+            // the counter having wrapped since the test started. Hydra turns
+            // the ticks into cycles, which would overflow a u32 after about
+            // four minutes.
+            u32 ticks = gTestRunnerState.timer2Overflows * TIMER2_TICKS_PER_OVERFLOW
+                      + REG_TM2CNT_L - gTestRunnerState.timer2Start;
+            gTestRunnerState.profiling = FALSE;
+            if (gTestRunnerState.test->runner != &gAssumptionsRunner)
+                Test_MgbaPrintf(":M%d %d %d", gTestRunnerState.frames, gMain.vblankCounter1 - gTestRunnerState.vblankCounterStart, ticks);
+        }
         REG_TM2CNT_H = 0;
 
         gTestRunnerState.state = STATE_NEXT_TEST;
@@ -476,8 +564,14 @@ void ReinitCallbacks(void)
     gMain.hblankCallback = NULL;
 }
 
+void TestRunner_RecordFrame(void)
+{
+    gTestRunnerState.frames++;
+}
+
 static void Intr_Timer2(void)
 {
+    gTestRunnerState.timer2Overflows++;
     if (--gTestRunnerState.timeoutSeconds == 0)
     {
         if (gTestRunnerState.test->runner->checkProgress
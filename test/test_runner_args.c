@@ -1,8 +1,22 @@
 #include "global.h"
+#include "test/test.h"
 
-// These values are patched by patchelf. Therefore we have put them in
-// their own TU so that the optimizer cannot inline them.
+// These values are patched by patchelf and mgba-rom-test-hydra. Therefore
+// we have put them in their own TU so that the optimizer cannot inline
+// them.
 const bool8 gTestRunnerEnabled = TRUE;
 const u8 gTestRunnerN = 0;
 const u8 gTestRunnerI = 0;
 const char gTestRunnerArgv[256] = {'\0'};
+
+// The runner assigned to each test (in __start_tests order) by
+// mgba-rom-test-hydra from the costs measured in previous runs.
+const u8 gTestRunnerSchedule[MAX_SCHEDULED_TESTS] = { [0 ... MAX_SCHEDULED_TESTS - 1] = TEST_RUNNER_UNSCHEDULED };
+
+// Tests scheduled as TEST_RUNNER_SHARDED only run the PASSES_RANDOMLY
+// trials t where t % gTestRunnerTrialShards == gTestRunnerTrialShard.
+const u8 gTestRunnerTrialShard = 0;
+const u8 gTestRunnerTrialShards = 1;
+
+// Reports every tagged RNG draw in battle tests with ':G'.
+const bool8 gTestRunnerTraceRng = FALSE;
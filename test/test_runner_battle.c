@@ -351,6 +351,110 @@ static void BattleTest_Run(void *data)
     PrintTestName();
 }
 
+static inline rng_value_t MakeRngValue(const u16 seed)
+{
+    int i;
+    rng_value_t result = {0, 0, seed, 1};
+    for (i = 0; i < 16; i++)
+    {
+            _SFC32_Next(&result);
+    }
+    return result;
+}
+
+// A shard of the trials may start beyond the last trial, e.g. if there
+// are fewer trials than shards. It still has to run a trial to find out
+// how many trials there are, but that trial reuses trial 0's values and
+// its result is not counted.
+static bool32 IsSkippedTrial(void)
+{
+    return STATE->trials != 0
+        && STATE->runTrial >= STATE->trials
+        && STATE->runTrial == gTestRunnerState.trialShard;
+}
+
+static u32 RandomlyTrial(void)
+{
+    return IsSkippedTrial() ? 0 : STATE->runTrial;
+}
+
+static const char *const sRandomTagNames[] =
+{
+    [RNG_NONE] = "NONE",
+    [RNG_ACCURACY] = "ACCURACY",
+    [RNG_CONFUSION] = "CONFUSION",
+    [RNG_CRITICAL_HIT] = "CRITICAL_HIT",
+    [RNG_CURSED_BODY] = "CURSED_BODY",
+    [RNG_CUTE_CHARM] = "CUTE_CHARM",
+    [RNG_DAMAGE_MODIFIER] = "DAMAGE_MODIFIER",
+    [RNG_DIRE_CLAW] = "DIRE_CLAW",
+    [RNG_EFFECT_SPORE] = "EFFECT_SPORE",
+    [RNG_FLAME_BODY] = "FLAME_BODY",
+    [RNG_FORCE_RANDOM_SWITCH] = "FORCE_RANDOM_SWITCH",
+    [RNG_FROZEN] = "FROZEN",
+    [RNG_G_MAX_STUN_SHOCK] = "G_MAX_STUN_SHOCK",
+    [RNG_G_MAX_BEFUDDLE] = "G_MAX_BEFUDDLE",
+    [RNG_G_MAX_REPLENISH] = "G_MAX_REPLENISH",
+    [RNG_G_MAX_SNOOZE] = "G_MAX_SNOOZE",
+    [RNG_HARVEST] = "HARVEST",
+    [RNG_HITS] = "HITS",
+    [RNG_HOLD_EFFECT_FLINCH] = "HOLD_EFFECT_FLINCH",
+    [RNG_INFATUATION] = "INFATUATION",
+    [RNG_LOADED_DICE] = "LOADED_DICE",
+    [RNG_METRONOME] = "METRONOME",
+    [RNG_PARALYSIS] = "PARALYSIS",
+    [RNG_PICKUP] = "PICKUP",
+    [RNG_POISON_POINT] = "POISON_POINT",
+    [RNG_POISON_TOUCH] = "POISON_TOUCH",
+    [RNG_RAMPAGE_TURNS] = "RAMPAGE_TURNS",
+    [RNG_SECONDARY_EFFECT] = "SECONDARY_EFFECT",
+    [RNG_SECONDARY_EFFECT_2] = "SECONDARY_EFFECT_2",
+    [RNG_SECONDARY_EFFECT_3] = "SECONDARY_EFFECT_3",
+    [RNG_SHED_SKIN] = "SHED_SKIN",
+    [RNG_SLEEP_TURNS] = "SLEEP_TURNS",
+    [RNG_SPEED_TIE] = "SPEED_TIE",
+    [RNG_STATIC] = "STATIC",
+    [RNG_STENCH] = "STENCH",
+    [RNG_TOXIC_CHAIN] = "TOXIC_CHAIN",
+    [RNG_TRI_ATTACK] = "TRI_ATTACK",
+    [RNG_QUICK_DRAW] = "QUICK_DRAW",
+    [RNG_QUICK_CLAW] = "QUICK_CLAW",
+    [RNG_TRACE] = "TRACE",
+    [RNG_FICKLE_BEAM] = "FICKLE_BEAM",
+    [RNG_AI_ABILITY] = "AI_ABILITY",
+    [RNG_AI_SWITCH_HASBADODDS] = "AI_SWITCH_HASBADODDS",
+    [RNG_AI_SWITCH_BADLY_POISONED] = "AI_SWITCH_BADLY_POISONED",
+    [RNG_AI_SWITCH_CURSED] = "AI_SWITCH_CURSED",
+    [RNG_AI_SWITCH_NIGHTMARE] = "AI_SWITCH_NIGHTMARE",
+    [RNG_AI_SWITCH_SEEDED] = "AI_SWITCH_SEEDED",
+    [RNG_AI_SWITCH_ABSORBING] = "AI_SWITCH_ABSORBING",
+    [RNG_AI_SWITCH_NATURAL_CURE] = "AI_SWITCH_NATURAL_CURE",
+    [RNG_AI_SWITCH_REGENERATOR] = "AI_SWITCH_REGENERATOR",
+    [RNG_AI_SWITCH_ENCORE] = "AI_SWITCH_ENCORE",
+    [RNG_AI_SWITCH_STATS_LOWERED] = "AI_SWITCH_STATS_LOWERED",
+    [RNG_AI_SWITCH_SE_DEFENSIVE] = "AI_SWITCH_SE_DEFENSIVE",
+    [RNG_SHELL_SIDE_ARM] = "SHELL_SIDE_ARM",
+    [RNG_RANDOM_TARGET] = "RANDOM_TARGET",
+    [RNG_HEALER] = "HEALER",
+};
+
+// Reports a tagged RNG draw to Hydra if gTestRunnerTraceRng is set.
+// 'source' is "forced" (by WITH_RNG or a MOVE option), "trial" (by
+// PASSES_RANDOMLY) or "default".
+static u32 TraceRng(enum RandomTag tag, u32 lo, u32 hi, u32 value, const char *source, void *caller)
+{
+    if (gTestRunnerTraceRng)
+    {
+        if (tag < ARRAY_COUNT(sRandomTagNames) && sRandomTagNames[tag])
+            Test_MgbaPrintf(":G%s %d %d %d %s %p %p", sRandomTagNames[tag], lo, hi, value, source, gBattlescriptCurrInstr, caller);
+        else
+            Test_MgbaPrintf(":G%d %d %d %d %s %p %p", tag, lo, hi, value, source, gBattlescriptCurrInstr, caller);
+    }
+    return value;
+}
+
+#define TRACE_RNG(tag, lo, hi, value, source) TraceRng(tag, lo, hi, value, source, __builtin_extract_return_addr(__builtin_return_address(0)))
+
 u32 RandomUniform(enum RandomTag tag, u32 lo, u32 hi)
 {
     const struct BattlerTurn *turn = NULL;
@@ -360,7 +464,7 @@ u32 RandomUniform(enum RandomTag tag, u32 lo, u32 hi)
         u32 battlerId = gBattlerByTurnOrder[gCurrentTurnActionNumber];
         turn = &DATA.battleRecordTurns[gBattleResults.battleTurnCounter][battlerId];
         if (turn && turn->rng.tag == tag)
-            return turn->rng.value;
+            return TRACE_RNG(tag, lo, hi, turn->rng.value, "forced");
     }
 
     if (tag == STATE->rngTag)
@@ -377,10 +481,10 @@ u32 RandomUniform(enum RandomTag tag, u32 lo, u32 hi)
             Test_ExitWithResult(TEST_RESULT_ERROR, SourceLine(0), ":LRandomUniform called from %p with tag %d and inconsistent trials %d and %d", __builtin_extract_return_addr(__builtin_return_address(0)), tag, STATE->trials, n);
         }
         STATE->trialRatio = Q_4_12(1) / STATE->trials;
-        return STATE->runTrial + lo;
+        return TRACE_RNG(tag, lo, hi, RandomlyTrial() + lo, "trial");
     }
 
-    return hi;
+    return TRACE_RNG(tag, lo, hi, hi, "default");
 }
 
 u32 RandomUniformExcept(enum RandomTag tag, u32 lo, u32 hi, bool32 (*reject)(u32))
@@ -396,7 +500,7 @@ u32 RandomUniformExcept(enum RandomTag tag, u32 lo, u32 hi, bool32 (*reject)(u32
         {
             if (reject(turn->rng.value))
                 Test_ExitWithResult(TEST_RESULT_INVALID, SourceLine(0), ":LWITH_RNG specified a rejected value (%d)", turn->rng.value);
-            return turn->rng.value;
+            return TRACE_RNG(tag, lo, hi, turn->rng.value, "forced");
         }
     }
 
@@ -414,14 +518,15 @@ u32 RandomUniformExcept(enum RandomTag tag, u32 lo, u32 hi, bool32 (*reject)(u32
         }
         STATE->trialRatio = Q_4_12(1) / STATE->trials;
 
-        while (reject(STATE->runTrial + lo + STATE->rngTrialOffset))
+        // Each trial uses the next value which is not rejected.
+        u32 value, skip = RandomlyTrial();
+        for (value = lo; reject(value) || skip-- > 0; value++)
         {
-            if (STATE->runTrial + lo + STATE->rngTrialOffset > hi)
+            if (value >= hi)
                 Test_ExitWithResult(TEST_RESULT_ERROR, SourceLine(0), ":LRandomUniformExcept called from %p with tag %d and inconsistent reject", __builtin_extract_return_addr(__builtin_return_address(0)), tag);
-            STATE->rngTrialOffset++;
         }
 
-        return STATE->runTrial + lo + STATE->rngTrialOffset;
+        return TRACE_RNG(tag, lo, hi, value, "trial");
     }
 
     default_ = hi;
@@ -431,7 +536,7 @@ u32 RandomUniformExcept(enum RandomTag tag, u32 lo, u32 hi, bool32 (*reject)(u32
             Test_ExitWithResult(TEST_RESULT_ERROR, SourceLine(0), ":LRandomUniformExcept called from %p with tag %d rejected all values", __builtin_extract_return_addr(__builtin_return_address(0)), tag);
         default_--;
     }
-    return default_;
+    return TRACE_RNG(tag, lo, hi, default_, "default");
 }
 
 u32 RandomWeightedArray(enum RandomTag tag, u32 sum, u32 n, const u8 *weights)
@@ -446,7 +551,7 @@ u32 RandomWeightedArray(enum RandomTag tag, u32 sum, u32 n, const u8 *weights)
         u32 battlerId = gBattlerByTurnOrder[gCurrentTurnActionNumber];
         turn = &DATA.battleRecordTurns[gBattleResults.battleTurnCounter][battlerId];
         if (turn && turn->rng.tag == tag)
-            return turn->rng.value;
+            return TRACE_RNG(tag, 0, n - 1, turn->rng.value, "forced");
     }
 
     if (tag == STATE->rngTag)
@@ -462,8 +567,8 @@ u32 RandomWeightedArray(enum RandomTag tag, u32 sum, u32 n, const u8 *weights)
             Test_ExitWithResult(TEST_RESULT_ERROR, SourceLine(0), ":LRandomWeighted called from %p with tag %d and inconsistent trials %d and %d", __builtin_extract_return_addr(__builtin_return_address(0)), tag, STATE->trials, n);
         }
         // TODO: Detect inconsistent sum.
-        STATE->trialRatio = Q_4_12(weights[STATE->runTrial]) / sum;
-        return STATE->runTrial;
+        STATE->trialRatio = Q_4_12(weights[RandomlyTrial()]) / sum;
+        return TRACE_RNG(tag, 0, n - 1, RandomlyTrial(), "trial");
     }
 
     switch (tag)
@@ -471,23 +576,23 @@ u32 RandomWeightedArray(enum RandomTag tag, u32 sum, u32 n, const u8 *weights)
     case RNG_ACCURACY:
         ASSUME(n == 2);
         if (turn && turn->hit)
-            return turn->hit - 1;
+            return TRACE_RNG(tag, 0, n - 1, turn->hit - 1, "forced");
         else
-            return TRUE;
+            return TRACE_RNG(tag, 0, n - 1, TRUE, "default");
 
     case RNG_CRITICAL_HIT:
         ASSUME(n == 2);
         if (turn && turn->criticalHit)
-            return turn->criticalHit - 1;
+            return TRACE_RNG(tag, 0, n - 1, turn->criticalHit - 1, "forced");
         else
-            return weights[FALSE] > 0 ? FALSE : TRUE;
+            return TRACE_RNG(tag, 0, n - 1, weights[FALSE] > 0 ? FALSE : TRUE, "default");
 
     case RNG_SECONDARY_EFFECT:
         ASSUME(n == 2);
         if (turn && turn->secondaryEffect)
-            return turn->secondaryEffect - 1;
+            return TRACE_RNG(tag, 0, n - 1, turn->secondaryEffect - 1, "forced");
         else
-            return TRUE;
+            return TRACE_RNG(tag, 0, n - 1, TRUE, "default");
 
     default:
         while (weights[n-1] == 0)
@@ -496,7 +601,7 @@ u32 RandomWeightedArray(enum RandomTag tag, u32 sum, u32 n, const u8 *weights)
                 Test_ExitWithResult(TEST_RESULT_ERROR, SourceLine(0), ":LRandomWeightedArray called from %p with tag %d and all zero weights", __builtin_extract_return_addr(__builtin_return_address(0)), tag);
             n--;
         }
-        return n-1;
+        return TRACE_RNG(tag, 0, n - 1, n - 1, "default");
     }
 }
 
@@ -516,7 +621,10 @@ const void *RandomElementArray(enum RandomTag tag, const void *array, size_t siz
             {
                 memcpy(&element, (const u8 *)array + size * index, size);
                 if (element == turn->rng.value)
+                {
+                    TRACE_RNG(tag, 0, count - 1, index, "forced");
                     return (const u8 *)array + size * index;
+                }
             }
             // TODO: Incorporate the line number.
             Test_ExitWithResult(TEST_RESULT_ERROR, SourceLine(0), ":L%s: RandomElement illegal value requested: %d", gTestRunnerState.test->filename, turn->rng.value);
@@ -536,8 +644,10 @@ const void *RandomElementArray(enum RandomTag tag, const void *array, size_t siz
             Test_ExitWithResult(TEST_RESULT_ERROR, SourceLine(0), ":LRandomElement called from %p with tag %d and inconsistent trials %d and %d", __builtin_extract_return_addr(__builtin_return_address(0)), tag, STATE->trials, count);
         }
         STATE->trialRatio = Q_4_12(1) / count;
-        return (const u8 *)array + size * STATE->runTrial;
+        TRACE_RNG(tag, 0, count - 1, RandomlyTrial(), "trial");
+        return (const u8 *)array + size * RandomlyTrial();
     }
+    TRACE_RNG(tag, 0, count - 1, index, "default");
     return (const u8 *)array + size * index;
 }
 
@@ -1329,7 +1439,7 @@ void TestRunner_Battle_AfterLastTurn(void)
     }
 
     STATE->runThen = TRUE;
-    STATE->runFinally = STATE->runParameter + 1 == STATE->parameters && STATE->runTrial + 1 >= STATE->trials;
+    STATE->runFinally = STATE->runParameter + 1 == STATE->parameters && STATE->runTrial + gTestRunnerState.trialShards >= STATE->trials;
     InvokeTestFunction(test);
     STATE->runThen = FALSE;
     STATE->runFinally = FALSE;
@@ -1358,17 +1468,6 @@ static void CB2_BattleTest_NextParameter(void)
     }
 }
 
-static inline rng_value_t MakeRngValue(const u16 seed)
-{
-    int i;
-    rng_value_t result = {0, 0, seed, 1};
-    for (i = 0; i < 16; i++)
-    {
-            _SFC32_Next(&result);
-    }
-    return result;
-}
-
 static void CB2_BattleTest_NextTrial(void)
 {
     ClearFlagAfterTest();
@@ -1381,7 +1480,8 @@ static void CB2_BattleTest_NextTrial(void)
     case TEST_RESULT_FAIL:
         break;
     case TEST_RESULT_PASS:
-        STATE->observedRatio += STATE->trialRatio;
+        if (STATE->runTrial < STATE->trials)
+            STATE->observedRatio += STATE->trialRatio;
         break;
     default:
         return;
@@ -1389,11 +1489,12 @@ static void CB2_BattleTest_NextTrial(void)
     if (STATE->rngTag)
         STATE->trialRatio = 0;
 
-    if (++STATE->runTrial < STATE->trials)
+    STATE->runTrial += gTestRunnerState.trialShards;
+    if (STATE->runTrial < STATE->trials)
     {
         PrintTestName();
         gTestRunnerState.result = TEST_RESULT_PASS;
-        DATA.recordedBattle.rngSeed = MakeRngValue(STATE->runTrial);
+        DATA.recordedBattle.rngSeed = GetTrialRngSeed(STATE->runTrial);
         memset(&DATA.trial, 0, sizeof(DATA.trial));
         SetVariablesForRecordedBattle(&DATA.recordedBattle);
         SetMainCallback2(CB2_InitBattle);
@@ -1403,8 +1504,13 @@ static void CB2_BattleTest_NextTrial(void)
         if (STATE->rngTag && !STATE->didRunRandomly && STATE->expectedRatio != Q_4_12(0.0) && STATE->expectedRatio != Q_4_12(1.0))
             Test_ExitWithResult(TEST_RESULT_INVALID, SourceLine(0), ":L%s:%d: PASSES_RANDOMLY specified but no Random* call with that tag executed", gTestRunnerState.test->filename, SourceLine(0));
 
+        Test_MgbaPrintf(":Q%d %d %d %d %d", SourceLine(0), STATE->runParameter, STATE->trials, STATE->observedRatio, STATE->expectedRatio);
+
+        // Hydra sums the observed ratios of the shards and checks them.
+        if (gTestRunnerState.trialShards > 1)
+            gTestRunnerState.result = TEST_RESULT_PASS;
         // This is a tolerance of +/- ~2%.
-        if (abs(STATE->observedRatio - STATE->expectedRatio) <= Q_4_12(0.02))
+        else if (abs(STATE->observedRatio - STATE->expectedRatio) <= Q_4_12(0.02))
             gTestRunnerState.result = TEST_RESULT_PASS;
         else
             Test_ExitWithResult(TEST_RESULT_FAIL, SourceLine(0), ":L%s:%d: Expected %q passes/successes, observed %q", gTestRunnerState.test->filename, SourceLine(0), STATE->expectedRatio, STATE->observedRatio);
@@ -1438,7 +1544,7 @@ static bool32 BattleTest_HandleExitWithResult(void *data, enum TestResult result
      && result != TEST_RESULT_INVALID
      && result != TEST_RESULT_ERROR
      && result != TEST_RESULT_TIMEOUT
-     && STATE->runTrial < STATE->trials)
+     && (STATE->runTrial < STATE->trials || IsSkippedTrial()))
     {
         SetMainCallback2(CB2_BattleTest_NextTrial);
         return TRUE;
@@ -1457,8 +1563,7 @@ void Randomly(u32 sourceLine, u32 passes, u32 trials, struct RandomlyContext ctx
     INVALID_IF(test->resultsSize > 0 && STATE->parametersCount > 1, "PASSES_RANDOMLY is incompatible with results");
     INVALID_IF(passes > trials, "%d passes specified, but only %d trials", passes, trials);
     STATE->rngTag = ctx.tag;
-    STATE->rngTrialOffset = 0;
-    STATE->runTrial = 0;
+    STATE->runTrial = gTestRunnerState.trialShard;
     STATE->expectedRatio = Q_4_12(passes) / trials;
     STATE->observedRatio = 0;
     if (STATE->rngTag)
@@ -1468,12 +1573,32 @@ void Randomly(u32 sourceLine, u32 passes, u32 trials, struct RandomlyContext ctx
     }
     else
     {
-        const rng_value_t defaultSeed = RNG_SEED_DEFAULT;
         INVALID_IF(RngSeedNotDefault(&DATA.recordedBattle.rngSeed), "RNG seed already set");
         STATE->trials = 50;
         STATE->trialRatio = Q_4_12(1) / STATE->trials;
-        DATA.recordedBattle.rngSeed = defaultSeed;
     }
+    // A shard's first trial must be seeded like the trial would be if
+    // the trials were not sharded.
+    DATA.recordedBattle.rngSeed = GetTrialRngSeed(STATE->runTrial);
+}
+
+rng_value_t GetTrialRngSeed(u32 trial)
+{
+    const rng_value_t defaultSeed = RNG_SEED_DEFAULT;
+    if (trial == 0)
+        return defaultSeed;
+    else
+        return MakeRngValue(trial);
+}
+
+u32 TestRunner_Battle_GetAiThinkScanlines(void)
+{
+    return DATA.aiThinkScanlines;
+}
+
+u32 TestRunner_Battle_GetAiThinkMaxFrames(void)
+{
+    return DATA.aiThinkMaxFrames;
 }
 
 void RNGSeed_(u32 sourceLine, rng_value_t seed)
@@ -1495,6 +1620,15 @@ void AILogScores(u32 sourceLine)
     DATA.logAI = TRUE;
 }
 
+void AIThinkOverFrames_(u32 sourceLine, u32 scanlines, u32 maxFrames)
+{
+    INVALID_IF(!IsAITest(), "AI_THINK_OVER_FRAMES is usable only in AI_SINGLE_BATTLE_TEST & AI_DOUBLE_BATTLE_TEST");
+    INVALID_IF(scanlines == 0 || scanlines >= 228, "AI_THINK_OVER_FRAMES scanlines must be between 1 and 227");
+    INVALID_IF(maxFrames == 0 || maxFrames > 255, "AI_THINK_OVER_FRAMES maxFrames must be between 1 and 255");
+    DATA.aiThinkScanlines = scanlines;
+    DATA.aiThinkMaxFrames = maxFrames;
+}
+
 const struct TestRunner gBattleTestRunner =
 {
     .estimateCost = BattleTest_EstimateCost,
@@ -0,0 +1,273 @@
+/* assetcache. Runs a tool which converts one asset into another, e.g.
+ * gbagfx or mid2agb, unless the same conversion has been run before,
+ * in which case the output is copied out of the cache instead.
+ *
+ * Usage: assetcache <cache dir> <tool> <input> <output> [<option>]...
+ *
+ * The cache is content-addressed: each output is stored under the
+ * SHA-256 of the tool executable, the input file and the arguments
+ * (including the input and output paths, because some tools derive
+ * labels from them). Timestamps play no part, so switching branches or
+ * worktrees back to identical inputs hits the cache even though make
+ * thinks the outputs are out of date. Entries are never evicted, but
+ * every hit touches the entry, so the cache can be pruned with e.g.
+ * 'find <cache dir> -type f -mtime +30 -delete'. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Change this if the layout of the cache or what goes into the key changes.
+#define CACHE_VERSION "assetcache 1"
+
+struct Sha256
+{
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char block[64];
+    size_t block_n;
+};
+
+static const uint32_t sha256_k[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_init(struct Sha256 *sha)
+{
+    static const uint32_t initial_state[8] =
+    {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(sha->state, initial_state, sizeof(initial_state));
+    sha->length = 0;
+    sha->block_n = 0;
+}
+
+static void sha256_block(struct Sha256 *sha)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)sha->block[i * 4] << 24 | (uint32_t)sha->block[i * 4 + 1] << 16 | (uint32_t)sha->block[i * 4 + 2] << 8 | sha->block[i * 4 + 3];
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = sha->state[0], b = sha->state[1], c = sha->state[2], d = sha->state[3];
+    uint32_t e = sha->state[4], f = sha->state[5], g = sha->state[6], h = sha->state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    sha->state[0] += a; sha->state[1] += b; sha->state[2] += c; sha->state[3] += d;
+    sha->state[4] += e; sha->state[5] += f; sha->state[6] += g; sha->state[7] += h;
+}
+
+static void sha256_update(struct Sha256 *sha, const void *data, size_t n)
+{
+    const unsigned char *p = data;
+    sha->length += n;
+    while (n > 0)
+    {
+        size_t chunk = sizeof(sha->block) - sha->block_n;
+        if (chunk > n)
+            chunk = n;
+        memcpy(&sha->block[sha->block_n], p, chunk);
+        sha->block_n += chunk;
+        p += chunk;
+        n -= chunk;
+        if (sha->block_n == sizeof(sha->block))
+        {
+            sha256_block(sha);
+            sha->block_n = 0;
+        }
+    }
+}
+
+static void sha256_final(struct Sha256 *sha, char hex[65])
+{
+    uint64_t bits = sha->length * 8;
+    unsigned char pad = 0x80;
+    sha256_update(sha, &pad, 1);
+    pad = 0;
+    while (sha->block_n != 56)
+        sha256_update(sha, &pad, 1);
+    for (int i = 7; i >= 0; i--)
+    {
+        unsigned char byte = bits >> (i * 8);
+        sha256_update(sha, &byte, 1);
+    }
+    for (int i = 0; i < 8; i++)
+        sprintf(&hex[i * 8], "%08x", sha->state[i]);
+}
+
+static bool sha256_file(struct Sha256 *sha, const char *path)
+{
+    int fd;
+    if ((fd = open(path, O_RDONLY)) == -1)
+    {
+        fprintf(stderr, "assetcache: open(%s) failed: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    char buffer[65536];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        sha256_update(sha, buffer, n);
+    if (n == -1)
+        fprintf(stderr, "assetcache: read(%s) failed: %s\n", path, strerror(errno));
+    close(fd);
+    return n == 0;
+}
+
+// Copies via a temporary file so that neither a concurrent build sharing
+// the cache nor an interrupted one can see a partially-written file.
+static bool copy_file(const char *source, const char *dest)
+{
+    bool ok = false;
+    int in_fd = -1, out_fd = -1;
+    char tmp[4096];
+
+    if ((in_fd = open(source, O_RDONLY)) == -1)
+        return false;
+
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", dest, (int)getpid());
+    if ((out_fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+        goto error;
+
+    char buffer[65536];
+    ssize_t n;
+    while ((n = read(in_fd, buffer, sizeof(buffer))) > 0)
+    {
+        if (write(out_fd, buffer, n) != n)
+            goto error;
+    }
+    if (n == -1)
+        goto error;
+
+    if (close(out_fd) == -1)
+    {
+        out_fd = -1;
+        goto error;
+    }
+    out_fd = -1;
+
+    if (rename(tmp, dest) == -1)
+        goto error;
+
+    ok = true;
+
+error:
+    if (out_fd != -1)
+        close(out_fd);
+    if (!ok)
+        unlink(tmp);
+    close(in_fd);
+    return ok;
+}
+
+static bool make_dirs(const char *path)
+{
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *p = dir + 1; ; p++)
+    {
+        if (*p == '/' || *p == '\0')
+        {
+            char c = *p;
+            *p = '\0';
+            if (mkdir(dir, 0755) == -1 && errno != EEXIST)
+                return false;
+            if (c == '\0')
+                return true;
+            *p = c;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        fprintf(stderr, "Usage: %s <cache dir> <tool> <input> <output> [<option>]...\n", argv[0]);
+        return 1;
+    }
+
+    const char *cache_dir = argv[1];
+    char **tool_argv = &argv[2];
+    const char *input = argv[3];
+    const char *output = argv[4];
+
+    struct Sha256 sha;
+    sha256_init(&sha);
+    sha256_update(&sha, CACHE_VERSION, sizeof(CACHE_VERSION));
+    if (!sha256_file(&sha, tool_argv[0]) || !sha256_file(&sha, input))
+        return 1;
+    for (int i = 3; i < argc; i++)
+        sha256_update(&sha, argv[i], strlen(argv[i]) + 1);
+
+    char key[65];
+    sha256_final(&sha, key);
+
+    char entry_dir[4096], entry[4096];
+    snprintf(entry_dir, sizeof(entry_dir), "%s/%.2s", cache_dir, key);
+    snprintf(entry, sizeof(entry), "%s/%s", entry_dir, key + 2);
+
+    if (copy_file(entry, output))
+    {
+        utimes(entry, NULL);
+        return 0;
+    }
+
+    pid_t pid;
+    switch ((pid = fork()))
+    {
+    case -1:
+        perror("assetcache: fork failed");
+        return 1;
+    case 0:
+        execv(tool_argv[0], tool_argv);
+        fprintf(stderr, "assetcache: exec(%s) failed: %s\n", tool_argv[0], strerror(errno));
+        _exit(127);
+    }
+
+    int wstatus;
+    if (waitpid(pid, &wstatus, 0) == -1)
+    {
+        perror("assetcache: waitpid failed");
+        return 1;
+    }
+    if (!WIFEXITED(wstatus))
+        return 1;
+    if (WEXITSTATUS(wstatus) != 0)
+        return WEXITSTATUS(wstatus);
+
+    // Failing to fill the cache only costs the next build some time.
+    if (!make_dirs(entry_dir) || !copy_file(output, entry))
+        fprintf(stderr, "assetcache: failed to cache %s in %s\n", output, entry);
+
+    return 0;
+}
@@ -6,209 +6,192 @@
 #include "global.h"
 #include "huff.h"
 
-static int cmp_tree(const void * a0, const void * b0) {
-    return ((struct HuffData *)a0)->value - ((struct HuffData *)b0)->value;
+// The tree is built with a min-heap ordered by frequency and then by age,
+// which gives exactly the same tree as repeatedly stable-sorting the
+// remaining nodes and merging the first two.
+struct HeapEntry {
+    unsigned value;
+    int seq;
+    HuffNode_t * node;
+};
+
+static bool heap_less(const struct HeapEntry * a, const struct HeapEntry * b) {
+    return a->value < b->value || (a->value == b->value && a->seq < b->seq);
 }
 
-typedef int (*cmpfun)(const void *, const void *);
-
-int msort_r(void * data, size_t count, size_t size, cmpfun cmp, void * buffer) {
-    /*
-     * Out-of-place mergesort (stable sort)
-     * Returns 1 on success, 0 on failure
-     */
-    void * leftPtr;
-    void * rightPtr;
-    void * leftEnd;
-    void * rightEnd;
-    int i;
-
-    switch (count) {
-    case 0:
-        // Should never be here
-        return 0;
-
-    case 1:
-        // Nothing to do here
-        break;
-
-    case 2:
-        // Swap the two entries if the right one compares higher.
-        if (cmp(data, data + size) > 0) {
-            memcpy(buffer, data, size);
-            memcpy(data, data + size, size);
-            memcpy(data + size, buffer, size);
-        }
-        break;
-    default:
-        // Merge sort out-of-place.
-        leftPtr = data;
-        leftEnd = rightPtr = data + count / 2 * size;
-        rightEnd = data + count * size;
-
-        // Sort the left half
-        if (!msort_r(leftPtr, count / 2, size, cmp, buffer))
-            return 0;
-
-        // Sort the right half
-        if (!msort_r(rightPtr, count / 2 + (count & 1), size, cmp, buffer))
-            return 0;
-
-        // Merge the sorted halves out of place
-        i = 0;
-        do {
-            if (cmp(leftPtr, rightPtr) <= 0) {
-                memcpy(buffer + i * size, leftPtr, size);
-                leftPtr += size;
-            } else {
-                memcpy(buffer + i * size, rightPtr, size);
-                rightPtr += size;
-            }
-
-        } while (++i < count && leftPtr < leftEnd && rightPtr < rightEnd);
-
-        // Copy the remainder
-        if (i < count) {
-            if (leftPtr < leftEnd) {
-                memcpy(buffer + i * size, leftPtr, leftEnd - leftPtr);
-            }
-            else {
-                memcpy(buffer + i * size, rightPtr, rightEnd - rightPtr);
-            }
-        }
-
-        // Copy the merged data back
-        memcpy(data, buffer, count * size);
-        break;
+static void heap_push(struct HeapEntry * heap, int * count, struct HeapEntry entry) {
+    int i = (*count)++;
+    while (i > 0 && heap_less(&entry, &heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
-
-    return 1;
+    heap[i] = entry;
 }
 
-int msort(void * data, size_t count, size_t size, cmpfun cmp) {
-    void * buffer = malloc(count * size);
-    if (buffer == NULL) return 0;
-    int result = msort_r(data, count, size, cmp, buffer);
-    free(buffer);
-    return result;
+static struct HeapEntry heap_pop(struct HeapEntry * heap, int * count) {
+    struct HeapEntry top = heap[0];
+    struct HeapEntry last = heap[--*count];
+    int i = 0;
+    for (;;) {
+        int child = i * 2 + 1;
+        if (child >= *count)
+            break;
+        if (child + 1 < *count && heap_less(&heap[child + 1], &heap[child]))
+            child++;
+        if (!heap_less(&heap[child], &last))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
 }
 
 static void write_tree(unsigned char * dest, HuffNode_t * tree, int nitems, struct BitEncoding * encoding) {
     /*
      * The example used to guide this function encodes the tree in a
-     * breadth-first manner.  We attempt to emulate that here.
+     * breadth-first manner, with the left child first.  Each node's
+     * path through the tree is its code.
      */
 
-    int i, j, k;
-
-    // There are (2 * nitems - 1) nodes in the binary tree.  Allocate that.
-    HuffNode_t * traversal = calloc(2 * nitems - 1, sizeof(HuffNode_t));
-    if (traversal == NULL)
+    int nnodes = 2 * nitems - 1;
+    HuffNode_t ** traversal = malloc(nnodes * sizeof(HuffNode_t *));
+    struct BitEncoding * paths = malloc(nnodes * sizeof(struct BitEncoding));
+    if (traversal == NULL || paths == NULL)
         FATAL_ERROR("Fatal error while compressing Huff file.\n");
 
     // The first node is the root of the tree.
-    traversal[0] = *tree;
-    i = 1;
-
-    // Copy the tree into a breadth-first ordering using brute force.
-    for (int depth = 1; i < 2 * nitems - 1; depth++) {
-        // Consider every possible path up to the current depth.
-        for (j = 0; i < 2 * nitems - 1 && j < 1 << depth; j++) {
-            // The index of the path is used to encode the path itself.
-            // Start from the most significant relevant bit and work our way down.
-            // Keep track of the current and previous nodes.
-            HuffNode_t * currNode = traversal;
-            HuffNode_t * parent = NULL;
-            for (k = 0; k < depth; k++) {
-                if (currNode->header.isLeaf)
-                    break;
-                parent = currNode;
-                if ((j >> (depth - k - 1)) & 1)
-                    currNode = currNode->branch.right;
-                else
-                    currNode = currNode->branch.left;
-            }
-            // Check that the length of the current path equals the current depth.
-            if (k == depth) {
-                // Make sure we can encode the current branch.
-                // Bail here if we cannot.
-                // This is only applicable for 8-bit encodings.
-                if (traversal + i - parent > 128)
-                    FATAL_ERROR("Fatal error while compressing Huff file: unable to encode binary tree.\n");
-                // Copy the current node, and update its parent.
-                traversal[i] = *currNode;
-                if (parent != NULL) {
-                    if ((j & 1) == 1)
-                        parent->branch.right = traversal + i;
-                    else
-                        parent->branch.left = traversal + i;
-                }
-                // Encode the path through the tree in the lookup table
-                if (traversal[i].header.isLeaf) {
-                    encoding[traversal[i].leaf.key].nbits = depth;
-                    encoding[traversal[i].leaf.key].bitstring = j;
-                }
-                i++;
-            }
-        }
-    }
+    traversal[0] = tree;
+    paths[0].nbits = 0;
+    paths[0].bitstring = 0;
 
     // Encode the size of the tree.
     // This is used by the decompressor to skip the tree.
     dest[4] = nitems - 1;
 
-    // Encode each node in the tree.
-    for (i = 0; i < 2 * nitems - 1; i++) {
-        HuffNode_t * currNode = traversal + i;
+    int tail = 1;
+    for (int i = 0; i < tail; i++) {
+        HuffNode_t * currNode = traversal[i];
         if (currNode->header.isLeaf) {
-            dest[5 + i] = traversal[i].leaf.key;
-        } else {
-            dest[5 + i] = (((currNode->branch.right - traversal - i) / 2) - 1);
-            if (currNode->branch.left->header.isLeaf)
-                dest[5 + i] |= 0x80;
-            if (currNode->branch.right->header.isLeaf)
-                dest[5 + i] |= 0x40;
+            dest[5 + i] = currNode->leaf.key;
+            encoding[currNode->leaf.key] = paths[i];
+            continue;
+        }
+
+        // Both children go at the end of the queue, so the right child is
+        // always the farther one.  Bail if it cannot be encoded in the
+        // node's 6-bit offset.
+        int right = tail + 1;
+        if (right - i > 128)
+            FATAL_ERROR("Fatal error while compressing Huff file: unable to encode binary tree.\n");
+        if (paths[i].nbits >= 57)
+            FATAL_ERROR("Fatal error while compressing Huff file: tree is too deep.\n");
+
+        for (int j = 0; j < 2; j++) {
+            traversal[tail] = j ? currNode->branch.right : currNode->branch.left;
+            paths[tail].nbits = paths[i].nbits + 1;
+            paths[tail].bitstring = (paths[i].bitstring << 1) | j;
+            tail++;
         }
+
+        dest[5 + i] = ((right - i) / 2) - 1;
+        if (currNode->branch.left->header.isLeaf)
+            dest[5 + i] |= 0x80;
+        if (currNode->branch.right->header.isLeaf)
+            dest[5 + i] |= 0x40;
     }
 
+    free(paths);
     free(traversal);
 }
 
-static inline void write_32_le(unsigned char * dest, int * destPos, uint32_t * buff, int * buffPos) {
-    dest[*destPos] = *buff;
-    dest[*destPos + 1] = *buff >> 8;
-    dest[*destPos + 2] = *buff >> 16;
-    dest[*destPos + 3] = *buff >> 24;
+static inline void write_32_le(unsigned char * dest, int * destPos, uint32_t value) {
+    dest[*destPos] = value;
+    dest[*destPos + 1] = value >> 8;
+    dest[*destPos + 2] = value >> 16;
+    dest[*destPos + 3] = value >> 24;
     *destPos += 4;
-    *buff = 0;
-    *buffPos = 0;
 }
 
-static inline void read_32_le(unsigned char * src, int * srcPos, uint32_t * buff) {
-    uint32_t tmp = src[*srcPos];
-    tmp |= src[*srcPos + 1] << 8;
-    tmp |= src[*srcPos + 2] << 16;
-    tmp |= src[*srcPos + 3] << 24;
-    *srcPos += 4;
-    *buff = tmp;
+// Reads a 32-bit little-endian word, treating anything past the end of
+// the data as zeros.
+static inline uint32_t read_32_le(const unsigned char * src, int srcPos, int srcSize) {
+    if (srcPos + 4 <= srcSize)
+        return src[srcPos] | (src[srcPos + 1] << 8) | (src[srcPos + 2] << 16) | ((uint32_t)src[srcPos + 3] << 24);
+
+    uint32_t value = 0;
+    for (int i = 0; i < 4 && srcPos + i < srcSize; i++)
+        value |= (uint32_t)src[srcPos + i] << (i * 8);
+    return value;
 }
 
-static void write_bits(unsigned char * dest, int * destPos, struct BitEncoding * encoding, int value, uint32_t * buff, int * buffBits) {
-    int nbits = encoding[value].nbits;
-    uint32_t bitstring = encoding[value].bitstring;
-
-    if (*buffBits + nbits >= 32) {
-        int diff = *buffBits + nbits - 32;
-        *buff <<= nbits - diff;
-        *buff |= bitstring >> diff;
-        bitstring &= ~(1 << diff);
-        nbits = diff;
-        write_32_le(dest, destPos, buff, buffBits);
+// The bits are packed into little-endian 32-bit words, starting from the
+// most significant bit of each word.
+struct BitWriter {
+    unsigned char * dest;
+    int destPos;
+    uint64_t buffer;
+    int bufferBits;
+};
+
+static inline void write_bits(struct BitWriter * writer, uint32_t bits, int nbits) {
+    writer->buffer = (writer->buffer << nbits) | bits;
+    writer->bufferBits += nbits;
+    if (writer->bufferBits >= 32) {
+        writer->bufferBits -= 32;
+        write_32_le(writer->dest, &writer->destPos, writer->buffer >> writer->bufferBits);
     }
-    if (nbits != 0) {
-        *buff <<= nbits;
-        *buff |= bitstring;
-        *buffBits += nbits;
+}
+
+static inline void write_code(struct BitWriter * writer, const struct BitEncoding * code) {
+    if (code->nbits > 32)
+        write_bits(writer, code->bitstring >> 32, code->nbits - 32);
+    write_bits(writer, code->bitstring, code->nbits > 32 ? 32 : code->nbits);
+}
+
+static void flush_bits(struct BitWriter * writer) {
+    if (writer->bufferBits != 0)
+        write_bits(writer, 0, 32 - writer->bufferBits);
+}
+
+// Decoding looks up this many bits at a time.  Longer codes walk the rest
+// of the tree one bit at a time from the node the lookup ends at.
+#define HUFF_LOOKUP_BITS 10
+
+struct HuffLookup {
+    uint16_t value; // the symbol if isLeaf, otherwise the position of the node reached
+    uint8_t nbits;
+    bool isLeaf;
+};
+
+// Returns the position of the child of the node at treePos taken by bit,
+// and whether it is a leaf.
+static inline int tree_child(const unsigned char * src, int srcSize, int treePos, int bit, bool * isLeaf) {
+    unsigned char treeView = src[treePos];
+    *isLeaf = ((treeView << bit) & 0x80) != 0;
+    int childPos = (treePos & ~1) + ((treeView & 0x3F) + 1) * 2 + bit;
+    if (childPos >= srcSize)
+        FATAL_ERROR("Fatal error while decompressing Huff file.\n");
+    return childPos;
+}
+
+static void fill_lookup(struct HuffLookup * lookup, const unsigned char * src, int srcSize, int treePos, int depth, int prefix) {
+    for (int bit = 0; bit < 2; bit++) {
+        bool isLeaf;
+        int childPos = tree_child(src, srcSize, treePos, bit, &isLeaf);
+        int childPrefix = (prefix << 1) | bit;
+        int remainingBits = HUFF_LOOKUP_BITS - depth - 1;
+
+        if (isLeaf || remainingBits == 0) {
+            struct HuffLookup entry;
+            entry.value = isLeaf ? src[childPos] : childPos;
+            entry.nbits = depth + 1;
+            entry.isLeaf = isLeaf;
+            for (int i = 0; i < 1 << remainingBits; i++)
+                lookup[(childPrefix << remainingBits) | i] = entry;
+        } else {
+            fill_lookup(lookup, src, srcSize, childPos, depth + 1, childPrefix);
+        }
     }
 }
 
@@ -222,120 +205,100 @@ unsigned char * HuffCompress(unsigned char * src, int srcSize, int * compressedS
     if (srcSize <= 0)
         goto fail;
 
-    int worstCaseDestSize = 4 + (2 << bitDepth) + srcSize * 3;
+    int nitems = 1 << bitDepth;
+    // Huffman codes are never longer on average than the values themselves,
+    // but the zero padding of the last word adds up to 6 more codes.
+    int worstCaseDestSize = 4 + nitems * 2 + srcSize + 64;
 
     unsigned char *dest = malloc(worstCaseDestSize);
     if (dest == NULL)
         goto fail;
 
-    int nitems = 1 << bitDepth;
-
-    HuffNode_t * freqs = calloc(nitems, sizeof(HuffNode_t));
-    if (freqs == NULL)
-        goto fail;
-
-    struct BitEncoding * encoding = calloc(nitems, sizeof(struct BitEncoding));
-    if (encoding == NULL)
-        goto fail;
-
-    // Set up the frequencies table.  This will inform the tree.
-    for (int i = 0; i < nitems; i++) {
-        freqs[i].header.isLeaf = 1;
-        freqs[i].header.value = 0;
-        freqs[i].leaf.key = i;
-    }
+    unsigned freqs[256] = {0};
+    struct BitEncoding encoding[256];
+    memset(encoding, 0, sizeof(encoding));
 
     // Count each nybble or byte.
-    for (int i = 0; i < srcSize; i++) {
-        if (bitDepth == 8) {
-            freqs[src[i]].header.value++;
-        } else {
-            freqs[src[i] >> 4].header.value++;
-            freqs[src[i] & 0xF].header.value++;
+    if (bitDepth == 8) {
+        for (int i = 0; i < srcSize; i++)
+            freqs[src[i]]++;
+    } else {
+        for (int i = 0; i < srcSize; i++) {
+            freqs[src[i] >> 4]++;
+            freqs[src[i] & 0xF]++;
         }
     }
 
 #ifdef DEBUG
     for (int i = 0; i < nitems; i++) {
-        fprintf(stderr, "%d: %d\n", i, freqs[i].header.value);
+        fprintf(stderr, "%d: %d\n", i, freqs[i]);
     }
 #endif // DEBUG
 
-    // Sort the frequency table.
-    if (!msort(freqs, nitems, sizeof(HuffNode_t), cmp_tree))
-        goto fail;
+    // The leaves go first, in order of their values, followed by the
+    // branches in the order they are made.  Zero-frequency values are pruned.
+    HuffNode_t tree[511];
+    struct HeapEntry heap[256];
+    int heapCount = 0;
+    int nleaves = 0;
 
-    // Prune zero-frequency values.
+    // The tree needs at least two leaves, so data with only one value also
+    // gets a leaf for another value that is never used.
+    int onlyValue = -1;
     for (int i = 0; i < nitems; i++) {
-        if (freqs[i].header.value != 0) {
-            if (i > 0) {
-                for (int j = i; j < nitems; j++) {
-                    freqs[j - i] = freqs[j];
-                }
-                nitems -= i;
-            }
-            break;
-        }
-        // This should never happen:
-        if (i == nitems - 1)
-            goto fail;
+        if (freqs[i] != 0)
+            onlyValue = onlyValue == -1 ? i : -2;
     }
 
-    HuffNode_t * tree = calloc(nitems * 2 - 1, sizeof(HuffNode_t));
-    if (tree == NULL)
-        goto fail;
+    for (int i = 0; i < nitems; i++) {
+        if (freqs[i] == 0 && (onlyValue < 0 || i != (onlyValue ^ 1)))
+            continue;
+        HuffNode_t * leaf = &tree[nleaves];
+        leaf->header.isLeaf = 1;
+        leaf->header.value = freqs[i];
+        leaf->leaf.key = i;
+        heap_push(heap, &heapCount, (struct HeapEntry){ freqs[i], nleaves, leaf });
+        nleaves++;
+    }
 
     // Iteratively collapse the two least frequent nodes.
-    HuffNode_t * endptr = freqs + nitems - 2;
-
-    for (int i = 0; i < nitems - 1; i++) {
-        HuffNode_t * left = freqs;
-        HuffNode_t * right = freqs + 1;
-        tree[i * 2] = *right;
-        tree[i * 2 + 1] = *left;
-        for (int j = 0; j < nitems - i - 2; j++)
-            freqs[j] = freqs[j + 2];
-        endptr->header.isLeaf = 0;
-        endptr->header.value = tree[i * 2].header.value + tree[i * 2 + 1].header.value;
-        endptr->branch.left = tree + i * 2;
-        endptr->branch.right = tree + i * 2 + 1;
-        endptr--;
-        if (i < nitems - 2 && !msort(freqs, nitems - i - 1, sizeof(HuffNode_t), cmp_tree))
-            goto fail;
+    for (int i = 0; i < nleaves - 1; i++) {
+        struct HeapEntry right = heap_pop(heap, &heapCount);
+        struct HeapEntry left = heap_pop(heap, &heapCount);
+        HuffNode_t * branch = &tree[nleaves + i];
+        branch->header.isLeaf = 0;
+        branch->header.value = left.value + right.value;
+        branch->branch.left = left.node;
+        branch->branch.right = right.node;
+        heap_push(heap, &heapCount, (struct HeapEntry){ left.value + right.value, nleaves + i, branch });
     }
 
     // Write the tree breadth-first, and create the path lookup table.
-    write_tree(dest, freqs, nitems, encoding);
-
-    free(tree);
-    free(freqs);
-
-    // Encode the data itself.
-    int destPos = 4 + nitems * 2;
-    uint32_t destBuf = 0;
-    uint32_t srcBuf = 0;
-    int destBitPos = 0;
-
-    for (int srcPos = 0; srcPos < srcSize;) {
-        read_32_le(src, &srcPos, &srcBuf);
-        for (int i = 0; i < 32 / bitDepth; i++) {
-            write_bits(dest, &destPos, encoding, srcBuf & (0xFF >> (8 - bitDepth)), &destBuf, &destBitPos);
-            srcBuf >>= bitDepth;
-        }
-    }
+    write_tree(dest, heap[0].node, nleaves, encoding);
 
-    if (destBitPos != 0) {
-        write_32_le(dest, &destPos, &destBuf, &destBitPos);
+    // Encode the data itself, a 32-bit word at a time starting from the
+    // least significant nybble or byte.
+    struct BitWriter writer = { dest, 4 + nleaves * 2, 0, 0 };
+
+    for (int srcPos = 0; srcPos < srcSize; srcPos += 4) {
+        uint32_t srcBuf = read_32_le(src, srcPos, srcSize);
+        if (bitDepth == 8) {
+            for (int i = 0; i < 4; i++, srcBuf >>= 8)
+                write_code(&writer, &encoding[srcBuf & 0xFF]);
+        } else {
+            for (int i = 0; i < 8; i++, srcBuf >>= 4)
+                write_code(&writer, &encoding[srcBuf & 0xF]);
+        }
     }
 
-    free(encoding);
+    flush_bits(&writer);
 
     // Write the header.
     dest[0] = bitDepth | 0x20;
     dest[1] = srcSize;
     dest[2] = srcSize >> 8;
     dest[3] = srcSize >> 16;
-    *compressedSize_p = (destPos + 3) & ~3;
+    *compressedSize_p = (writer.destPos + 3) & ~3;
     return dest;
 
 fail:
@@ -343,7 +306,7 @@ fail:
 }
 
 unsigned char * HuffDecompress(unsigned char * src, int srcSize, int * uncompressedSize_p) {
-    if (srcSize < 4)
+    if (srcSize < 6)
         goto fail;
 
     int bitDepth = *src & 15;
@@ -352,47 +315,74 @@ unsigned char * HuffDecompress(unsigned char * src, int srcSize, int * uncompres
 
     int destSize = (src[3] << 16) | (src[2] << 8) | src[1];
 
-    unsigned char *dest = malloc(destSize);
+    unsigned char *dest = malloc(destSize > 0 ? destSize : 1);
 
     if (dest == NULL)
         goto fail;
 
-    int treePos = 5;
+    struct HuffLookup lookup[1 << HUFF_LOOKUP_BITS];
+    fill_lookup(lookup, src, srcSize, 5, 0, 0);
+
     int treeSize = (src[4] + 1) * 2;
     int srcPos = 4 + treeSize;
     int destPos = 0;
-    int curValPos = 0;
-    uint32_t destTmp = 0;
-    uint32_t window;
+    int symbolsPerByte = 8 / bitDepth;
+    int symbolsInByte = 0;
+    unsigned char destByte = 0;
+
+    // The next bit to decode is always the most significant bit of the window.
+    uint64_t window = 0;
+    int windowBits = 0;
+
+    while (destPos < destSize) {
+        if (windowBits <= 32 && srcPos < srcSize) {
+            window |= (uint64_t)read_32_le(src, srcPos, srcSize) << (32 - windowBits);
+            windowBits += 32;
+            srcPos += 4;
+        }
 
-    for (;;)
-    {
-        if (srcPos >= srcSize)
-            goto fail;
-        read_32_le(src, &srcPos, &window);
-        for (int i = 0; i < 32; i++) {
-            int curBit = (window >> 31) & 1;
-            unsigned char treeView = src[treePos];
-            bool isLeaf = ((treeView << curBit) & 0x80) != 0;
-            treePos &= ~1; // align
-            treePos += ((treeView & 0x3F) + 1) * 2 + curBit;
-            if (isLeaf) {
-                destTmp >>= bitDepth;
-                destTmp |= (src[treePos] << (32 - bitDepth));
-                curValPos++;
-                if (curValPos == 32 / bitDepth) {
-                    write_32_le(dest, &destPos, &destTmp, &curValPos);
-                    if (destPos == destSize) {
-                        *uncompressedSize_p = destSize;
-                        return dest;
-                    }
+        struct HuffLookup entry = lookup[window >> (64 - HUFF_LOOKUP_BITS)];
+        window <<= entry.nbits;
+        windowBits -= entry.nbits;
+
+        int value = entry.value;
+        if (!entry.isLeaf) {
+            bool isLeaf = false;
+            int treePos = value;
+            while (!isLeaf) {
+                if (windowBits == 0) {
+                    if (srcPos >= srcSize)
+                        goto fail;
+                    window = (uint64_t)read_32_le(src, srcPos, srcSize) << 32;
+                    windowBits = 32;
+                    srcPos += 4;
                 }
-                treePos = 5;
+                treePos = tree_child(src, srcSize, treePos, window >> 63, &isLeaf);
+                window <<= 1;
+                windowBits--;
+            }
+            value = src[treePos];
+        }
+
+        if (windowBits < 0)
+            goto fail;
+
+        // Nybbles are stored least significant first.
+        if (bitDepth == 8) {
+            dest[destPos++] = value;
+        } else {
+            destByte |= (value & 0xF) << (symbolsInByte * 4);
+            if (++symbolsInByte == symbolsPerByte) {
+                dest[destPos++] = destByte;
+                destByte = 0;
+                symbolsInByte = 0;
             }
-            window <<= 1;
         }
     }
 
+    *uncompressedSize_p = destSize;
+    return dest;
+
 fail:
     FATAL_ERROR("Fatal error while decompressing Huff file.\n");
 }
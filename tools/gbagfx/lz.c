@@ -69,7 +69,134 @@ fail:
 	FATAL_ERROR("Fatal error while decompressing LZ file.\n");
 }
 
-unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize, const int minDistance)
+#define LZ_MIN_BLOCK_SIZE 3
+#define LZ_MAX_BLOCK_SIZE 18
+#define LZ_MAX_DISTANCE 0x1000
+#define LZ_HASH_BITS 15
+
+// Chains together every earlier position which starts with the same three
+// bytes, nearest first, so that finding the longest block only compares
+// against positions which could match rather than the whole window.
+struct LZMatchFinder {
+	unsigned char *src;
+	int srcSize;
+	int minDistance;
+	int nextPos;
+	int *head;
+	int *prev;
+};
+
+static int LZHash(unsigned char *src)
+{
+	unsigned int key = (src[0] << 16) | (src[1] << 8) | src[2];
+
+	return (key * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static bool LZInitMatchFinder(struct LZMatchFinder *finder, unsigned char *src, int srcSize, int minDistance)
+{
+	finder->src = src;
+	finder->srcSize = srcSize;
+	finder->minDistance = minDistance;
+	finder->nextPos = 0;
+	finder->head = malloc(sizeof(int) << LZ_HASH_BITS);
+	finder->prev = malloc(sizeof(int) * srcSize);
+
+	if (finder->head == NULL || finder->prev == NULL)
+		return false;
+
+	for (int i = 0; i < (1 << LZ_HASH_BITS); i++)
+		finder->head[i] = -1;
+
+	return true;
+}
+
+static void LZFreeMatchFinder(struct LZMatchFinder *finder)
+{
+	free(finder->head);
+	free(finder->prev);
+}
+
+// Returns the size of the longest block at srcPos, preferring the nearest on
+// ties, which is what a scan of every distance in turn would find.
+static int LZFindBlock(struct LZMatchFinder *finder, int srcPos, int *blockDistance)
+{
+	unsigned char *src = finder->src;
+	int maxBlockSize = finder->srcSize - srcPos;
+
+	for (; finder->nextPos < srcPos && finder->nextPos + LZ_MIN_BLOCK_SIZE <= finder->srcSize; finder->nextPos++) {
+		int hash = LZHash(&src[finder->nextPos]);
+		finder->prev[finder->nextPos] = finder->head[hash];
+		finder->head[hash] = finder->nextPos;
+	}
+
+	if (maxBlockSize < LZ_MIN_BLOCK_SIZE)
+		return 0;
+
+	if (maxBlockSize > LZ_MAX_BLOCK_SIZE)
+		maxBlockSize = LZ_MAX_BLOCK_SIZE;
+
+	int bestBlockSize = 0;
+
+	for (int blockStart = finder->head[LZHash(&src[srcPos])];
+	     blockStart >= 0 && srcPos - blockStart <= LZ_MAX_DISTANCE;
+	     blockStart = finder->prev[blockStart]) {
+		if (srcPos - blockStart < finder->minDistance)
+			continue;
+
+		int blockSize = 0;
+
+		while (blockSize < maxBlockSize && src[blockStart + blockSize] == src[srcPos + blockSize])
+			blockSize++;
+
+		if (blockSize > bestBlockSize) {
+			*blockDistance = srcPos - blockStart;
+			bestBlockSize = blockSize;
+
+			if (blockSize == maxBlockSize)
+				break;
+		}
+	}
+
+	return bestBlockSize;
+}
+
+// Chooses the blocks which give the smallest output rather than the longest
+// block at each step. Every literal costs 9 bits and every block 17 bits
+// (including its flag bit) wherever it points, so it is enough to know the
+// longest block at each position; any shorter prefix of it is also a block.
+static bool LZOptimalParse(struct LZMatchFinder *finder, int *blockSizes, int *blockDistances)
+{
+	int srcSize = finder->srcSize;
+	int *cost = malloc(sizeof(int) * (srcSize + 1));
+
+	if (cost == NULL)
+		return false;
+
+	for (int srcPos = 0; srcPos < srcSize; srcPos++)
+		blockSizes[srcPos] = LZFindBlock(finder, srcPos, &blockDistances[srcPos]);
+
+	cost[srcSize] = 0;
+
+	for (int srcPos = srcSize - 1; srcPos >= 0; srcPos--) {
+		int longestBlockSize = blockSizes[srcPos];
+
+		cost[srcPos] = 9 + cost[srcPos + 1];
+		blockSizes[srcPos] = 0;
+
+		for (int blockSize = LZ_MIN_BLOCK_SIZE; blockSize <= longestBlockSize; blockSize++) {
+			if (17 + cost[srcPos + blockSize] < cost[srcPos]) {
+				cost[srcPos] = 17 + cost[srcPos + blockSize];
+				blockSizes[srcPos] = blockSize;
+			}
+		}
+	}
+
+	free(cost);
+	return true;
+}
+
+unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize, const int minDistance, const bool optimal)
 {
 	if (srcSize <= 0)
 		goto fail;
@@ -84,6 +211,22 @@ unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize,
 	if (dest == NULL)
 		goto fail;
 
+	struct LZMatchFinder finder;
+
+	if (!LZInitMatchFinder(&finder, src, srcSize, minDistance))
+		goto fail;
+
+	int *blockSizes = NULL;
+	int *blockDistances = NULL;
+
+	if (optimal) {
+		blockSizes = malloc(sizeof(int) * srcSize);
+		blockDistances = malloc(sizeof(int) * srcSize);
+
+		if (blockSizes == NULL || blockDistances == NULL || !LZOptimalParse(&finder, blockSizes, blockDistances))
+			goto fail;
+	}
+
 	// header
 	dest[0] = 0x10; // LZ compression type
 	dest[1] = (unsigned char)srcSize;
@@ -99,30 +242,16 @@ unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize,
 
 		for (int i = 0; i < 8; i++) {
 			int bestBlockDistance = 0;
-			int bestBlockSize = 0;
-			int blockDistance = minDistance;
+			int bestBlockSize;
 
-			while (blockDistance <= srcPos && blockDistance <= 0x1000) {
-				int blockStart = srcPos - blockDistance;
-				int blockSize = 0;
-
-				while (blockSize < 18
-				    && srcPos + blockSize < srcSize
-				    && src[blockStart + blockSize] == src[srcPos + blockSize])
-					blockSize++;
-
-				if (blockSize > bestBlockSize) {
-					bestBlockDistance = blockDistance;
-					bestBlockSize = blockSize;
-
-					if (blockSize == 18)
-						break;
-				}
-
-				blockDistance++;
+			if (optimal) {
+				bestBlockSize = blockSizes[srcPos];
+				bestBlockDistance = blockDistances[srcPos];
+			} else {
+				bestBlockSize = LZFindBlock(&finder, srcPos, &bestBlockDistance);
 			}
 
-			if (bestBlockSize >= 3) {
+			if (bestBlockSize >= LZ_MIN_BLOCK_SIZE) {
 				*flags |= (0x80 >> i);
 				srcPos += bestBlockSize;
 				bestBlockSize -= 3;
@@ -142,6 +271,10 @@ unsigned char *LZCompress(unsigned char *src, int srcSize, int *compressedSize,
 						dest[destPos++] = 0;
 				}
 
+				LZFreeMatchFinder(&finder);
+				free(blockSizes);
+				free(blockDistances);
+
 				*compressedSize = destPos;
 				return dest;
 			}
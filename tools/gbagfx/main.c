@@ -3,6 +3,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 #include "global.h"
 #include "util.h"
 #include "options.h"
@@ -426,6 +430,7 @@ void HandleLZCompressCommand(char *inputPath, char *outputPath, int argc, char *
 {
     int overflowSize = 0;
     int minDistance = 2; // default, for compatibility with LZ77UnCompVram()
+    bool optimal = false;
 
     for (int i = 3; i < argc; i++)
     {
@@ -457,6 +462,11 @@ void HandleLZCompressCommand(char *inputPath, char *outputPath, int argc, char *
             if (minDistance < 1)
                 FATAL_ERROR("LZ min search distance must be positive.\n");
         }
+        else if (strcmp(option, "-optimal") == 0)
+        {
+            // Smaller, but not byte-for-byte what the original games used.
+            optimal = true;
+        }
         else
         {
             FATAL_ERROR("Unrecognized option \"%s\".\n", option);
@@ -473,7 +483,7 @@ void HandleLZCompressCommand(char *inputPath, char *outputPath, int argc, char *
     unsigned char *buffer = ReadWholeFileZeroPadded(inputPath, &fileSize, overflowSize);
 
     int compressedSize;
-    unsigned char *compressedData = LZCompress(buffer, fileSize + overflowSize, &compressedSize, minDistance);
+    unsigned char *compressedData = LZCompress(buffer, fileSize + overflowSize, &compressedSize, minDistance, optimal);
 
     compressedData[1] = (unsigned char)fileSize;
     compressedData[2] = (unsigned char)(fileSize >> 8);
@@ -586,40 +596,36 @@ void HandleHuffDecompressCommand(char *inputPath, char *outputPath, int argc UNU
     free(uncompressedData);
 }
 
-int main(int argc, char **argv)
+struct CommandHandler handlers[] =
 {
-    char converted = 0;
-
-    if (argc < 3)
-        FATAL_ERROR("Usage: gbagfx INPUT_PATH OUTPUT_PATH [options...]\n");
-
-    struct CommandHandler handlers[] =
-    {
-        { "1bpp", "png", HandleGbaToPngCommand },
-        { "4bpp", "png", HandleGbaToPngCommand },
-        { "8bpp", "png", HandleGbaToPngCommand },
-        { "png", "1bpp", HandlePngToGbaCommand },
-        { "png", "4bpp", HandlePngToGbaCommand },
-        { "png", "8bpp", HandlePngToGbaCommand },
-        { "png", "gbapal", HandlePngToGbaPaletteCommand },
-        { "png", "pal", HandlePngToJascPaletteCommand },
-        { "gbapal", "pal", HandleGbaToJascPaletteCommand },
-        { "pal", "gbapal", HandleJascToGbaPaletteCommand },
-        { "latfont", "png", HandleLatinFontToPngCommand },
-        { "png", "latfont", HandlePngToLatinFontCommand },
-        { "hwjpnfont", "png", HandleHalfwidthJapaneseFontToPngCommand },
-        { "png", "hwjpnfont", HandlePngToHalfwidthJapaneseFontCommand },
-        { "fwjpnfont", "png", HandleFullwidthJapaneseFontToPngCommand },
-        { "png", "fwjpnfont", HandlePngToFullwidthJapaneseFontCommand },
-        { NULL, "huff", HandleHuffCompressCommand },
-        { NULL, "lz", HandleLZCompressCommand },
-        { "huff", NULL, HandleHuffDecompressCommand },
-        { "lz", NULL, HandleLZDecompressCommand },
-        { NULL, "rl", HandleRLCompressCommand },
-        { "rl", NULL, HandleRLDecompressCommand },
-        { NULL, NULL, NULL }
-    };
+    { "1bpp", "png", HandleGbaToPngCommand },
+    { "4bpp", "png", HandleGbaToPngCommand },
+    { "8bpp", "png", HandleGbaToPngCommand },
+    { "png", "1bpp", HandlePngToGbaCommand },
+    { "png", "4bpp", HandlePngToGbaCommand },
+    { "png", "8bpp", HandlePngToGbaCommand },
+    { "png", "gbapal", HandlePngToGbaPaletteCommand },
+    { "png", "pal", HandlePngToJascPaletteCommand },
+    { "gbapal", "pal", HandleGbaToJascPaletteCommand },
+    { "pal", "gbapal", HandleJascToGbaPaletteCommand },
+    { "latfont", "png", HandleLatinFontToPngCommand },
+    { "png", "latfont", HandlePngToLatinFontCommand },
+    { "hwjpnfont", "png", HandleHalfwidthJapaneseFontToPngCommand },
+    { "png", "hwjpnfont", HandlePngToHalfwidthJapaneseFontCommand },
+    { "fwjpnfont", "png", HandleFullwidthJapaneseFontToPngCommand },
+    { "png", "fwjpnfont", HandlePngToFullwidthJapaneseFontCommand },
+    { NULL, "huff", HandleHuffCompressCommand },
+    { NULL, "lz", HandleLZCompressCommand },
+    { "huff", NULL, HandleHuffDecompressCommand },
+    { "lz", NULL, HandleLZDecompressCommand },
+    { NULL, "rl", HandleRLCompressCommand },
+    { "rl", NULL, HandleRLDecompressCommand },
+    { NULL, NULL, NULL }
+};
 
+void ConvertFile(int argc, char **argv)
+{
+    char converted = 0;
     char *inputPath = argv[1];
     char *outputPath = argv[2];
     char *inputFileExtension = GetFileExtensionAfterDot(inputPath);
@@ -672,6 +678,285 @@ int main(int argc, char **argv)
 
     if (!converted)
         FATAL_ERROR("Don't know how to convert \"%s\" to \"%s\".\n", argv[1], argv[2]);
+}
+
+struct BatchJob
+{
+    int argc;
+    char **argv;
+};
+
+struct Batch
+{
+    struct BatchJob *jobs;
+    int jobsCount;
+    atomic_int nextJob;
+};
+
+void *BatchWorker(void *arg)
+{
+    struct Batch *batch = arg;
+
+    for (;;)
+    {
+        int i = atomic_fetch_add(&batch->nextJob, 1);
+
+        if (i >= batch->jobsCount)
+            return NULL;
+
+        ConvertFile(batch->jobs[i].argc, batch->jobs[i].argv);
+    }
+}
+
+// Each line of the list is the arguments of one conversion, i.e.
+// "INPUT_PATH OUTPUT_PATH [options...]". Blank lines and lines starting with
+// '#' are ignored. This saves starting a process for each of the thousands of
+// graphics in a clean build.
+void HandleBatch(int argc, char **argv)
+{
+    char *listPath = argv[2];
+    int threadsCount = 0;
+
+    for (int i = 3; i < argc; i++)
+    {
+        char *option = argv[i];
+
+        if (strcmp(option, "-threads") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("No count following \"-threads\".\n");
+
+            i++;
+
+            if (!ParseNumber(argv[i], NULL, 10, &threadsCount))
+                FATAL_ERROR("Failed to parse thread count.\n");
+
+            if (threadsCount < 1)
+                FATAL_ERROR("Thread count must be positive.\n");
+        }
+        else
+        {
+            FATAL_ERROR("Unrecognized option \"%s\".\n", option);
+        }
+    }
+
+    if (threadsCount == 0)
+    {
+#ifdef _SC_NPROCESSORS_ONLN
+        threadsCount = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (threadsCount < 1)
+            threadsCount = 1;
+    }
+
+    int listSize;
+    char *list = (char *)ReadWholeFileZeroPadded(listPath, &listSize, 1);
+
+    struct Batch batch;
+    int jobsCapacity = 0;
+
+    batch.jobs = NULL;
+    batch.jobsCount = 0;
+    atomic_init(&batch.nextJob, 0);
+
+    for (char *line = strtok(list, "\r\n"); line != NULL; line = strtok(NULL, "\r\n"))
+    {
+        int jobArgc = 1;
+        char **jobArgv = malloc(sizeof(char *) * (strlen(line) / 2 + 2));
+
+        if (jobArgv == NULL)
+            FATAL_ERROR("Failed to allocate memory for batch job.\n");
+
+        jobArgv[0] = argv[0];
+
+        for (char *p = line; *p != 0;)
+        {
+            while (*p == ' ' || *p == '\t')
+                *p++ = 0;
+
+            if (*p == 0)
+                break;
+
+            jobArgv[jobArgc++] = p;
+
+            while (*p != 0 && *p != ' ' && *p != '\t')
+                p++;
+        }
+
+        if (jobArgc == 1 || jobArgv[1][0] == '#')
+        {
+            free(jobArgv);
+            continue;
+        }
+
+        if (jobArgc < 3)
+            FATAL_ERROR("Batch line \"%s\" has no output path.\n", jobArgv[1]);
+
+        if (batch.jobsCount == jobsCapacity)
+        {
+            jobsCapacity = jobsCapacity == 0 ? 64 : jobsCapacity * 2;
+            batch.jobs = realloc(batch.jobs, sizeof(struct BatchJob) * jobsCapacity);
+
+            if (batch.jobs == NULL)
+                FATAL_ERROR("Failed to allocate memory for batch jobs.\n");
+        }
+
+        batch.jobs[batch.jobsCount].argc = jobArgc;
+        batch.jobs[batch.jobsCount].argv = jobArgv;
+        batch.jobsCount++;
+    }
+
+    if (threadsCount > batch.jobsCount)
+        threadsCount = batch.jobsCount;
+
+    pthread_t *threads = malloc(sizeof(pthread_t) * threadsCount);
+
+    if (threads == NULL)
+        FATAL_ERROR("Failed to allocate memory for threads.\n");
+
+    // The main thread is a worker too.
+    for (int i = 1; i < threadsCount; i++)
+    {
+        if (pthread_create(&threads[i], NULL, BatchWorker, &batch) != 0)
+            FATAL_ERROR("Failed to create thread.\n");
+    }
+
+    BatchWorker(&batch);
+
+    for (int i = 1; i < threadsCount; i++)
+        pthread_join(threads[i], NULL);
+
+    for (int i = 0; i < batch.jobsCount; i++)
+        free(batch.jobs[i].argv);
+
+    free(threads);
+    free(batch.jobs);
+    free(list);
+}
+
+struct BenchCodec
+{
+    const char *name;
+    unsigned char *(*compress)(unsigned char *src, int srcSize, int *compressedSize);
+    unsigned char *(*decompress)(unsigned char *src, int srcSize, int *uncompressedSize);
+};
+
+static unsigned char *BenchLZCompress(unsigned char *src, int srcSize, int *compressedSize)
+{
+    return LZCompress(src, srcSize, compressedSize, 2, false);
+}
+
+static unsigned char *BenchHuff4Compress(unsigned char *src, int srcSize, int *compressedSize)
+{
+    return HuffCompress(src, srcSize, compressedSize, 4);
+}
+
+static unsigned char *BenchHuff8Compress(unsigned char *src, int srcSize, int *compressedSize)
+{
+    return HuffCompress(src, srcSize, compressedSize, 8);
+}
+
+static const struct BenchCodec benchCodecs[] =
+{
+    { "lz", BenchLZCompress, LZDecompress },
+    { "rl", RLCompress, RLDecompress },
+    { "huff4", BenchHuff4Compress, HuffDecompress },
+    { "huff8", BenchHuff8Compress, HuffDecompress },
+};
+
+static double BenchMBPerSecond(int size, int iterations, clock_t start)
+{
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    if (seconds <= 0)
+        return 0;
+
+    return (double)size * iterations / seconds / 1000000;
+}
+
+// Compresses and decompresses a file with each of the compression formats
+// and reports how fast that was, checking that the data survives the trip.
+void HandleBench(int argc, char **argv)
+{
+    char *inputPath = argv[2];
+    int iterations = 10;
+
+    for (int i = 3; i < argc; i++)
+    {
+        char *option = argv[i];
+
+        if (strcmp(option, "-iterations") == 0)
+        {
+            if (i + 1 >= argc)
+                FATAL_ERROR("No count following \"-iterations\".\n");
+
+            i++;
+
+            if (!ParseNumber(argv[i], NULL, 10, &iterations))
+                FATAL_ERROR("Failed to parse iteration count.\n");
+
+            if (iterations < 1)
+                FATAL_ERROR("Iteration count must be positive.\n");
+        }
+        else
+        {
+            FATAL_ERROR("Unrecognized option \"%s\".\n", option);
+        }
+    }
+
+    int fileSize;
+    unsigned char *buffer = ReadWholeFile(inputPath, &fileSize);
+
+    for (int i = 0; i < sizeof(benchCodecs) / sizeof(benchCodecs[0]); i++)
+    {
+        const struct BenchCodec *codec = &benchCodecs[i];
+        unsigned char *compressedData = NULL;
+        unsigned char *uncompressedData = NULL;
+        int compressedSize;
+        int uncompressedSize;
+
+        clock_t start = clock();
+        for (int j = 0; j < iterations; j++)
+        {
+            free(compressedData);
+            compressedData = codec->compress(buffer, fileSize, &compressedSize);
+        }
+        double compressSpeed = BenchMBPerSecond(fileSize, iterations, start);
+
+        start = clock();
+        for (int j = 0; j < iterations; j++)
+        {
+            free(uncompressedData);
+            uncompressedData = codec->decompress(compressedData, compressedSize, &uncompressedSize);
+        }
+        double decompressSpeed = BenchMBPerSecond(fileSize, iterations, start);
+
+        if (uncompressedSize != fileSize || memcmp(uncompressedData, buffer, fileSize) != 0)
+            FATAL_ERROR("%s: decompressed data does not match \"%s\".\n", codec->name, inputPath);
+
+        printf("%-6s %d -> %d bytes, compress %.1f MB/s, decompress %.1f MB/s\n",
+            codec->name, fileSize, compressedSize, compressSpeed, decompressSpeed);
+
+        free(compressedData);
+        free(uncompressedData);
+    }
+
+    free(buffer);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+        FATAL_ERROR("Usage: gbagfx INPUT_PATH OUTPUT_PATH [options...]\n"
+                    "       gbagfx -batch LIST_PATH [-threads COUNT]\n"
+                    "       gbagfx -bench INPUT_PATH [-iterations COUNT]\n");
+
+    if (strcmp(argv[1], "-batch") == 0)
+        HandleBatch(argc, argv);
+    else if (strcmp(argv[1], "-bench") == 0)
+        HandleBench(argc, argv);
+    else
+        ConvertFile(argc, argv);
 
     return 0;
 }
@@ -12,6 +12,9 @@ using std::string; using std::to_string;
 #include <algorithm>
 using std::replace_if;
 
+#include <fstream>
+#include <sstream>
+
 #include <inja.hpp>
 using namespace inja;
 using json = nlohmann::json;
@@ -28,6 +31,30 @@ string get_custom_var(string key)
     return customVars[key];
 }
 
+// Leaves the output alone if it already has this text, so that whatever
+// includes it is not rebuilt.
+void write_if_changed(string filepath, string text)
+{
+    std::ifstream in_file(filepath);
+
+    if (in_file.is_open())
+    {
+        std::ostringstream old_text;
+        old_text << in_file.rdbuf();
+        in_file.close();
+        if (old_text.str() == text)
+            return;
+    }
+
+    std::ofstream out_file(filepath);
+
+    if (!out_file.is_open())
+        FATAL_ERROR("JSONPROC_ERROR: Cannot open file %s for writing.\n", filepath.c_str());
+
+    out_file << text;
+    out_file.close();
+}
+
 int main(int argc, char *argv[])
 {
     if (argc != 4)
@@ -122,7 +149,8 @@ int main(int argc, char *argv[])
 
     try
     {
-        env.write_with_json_file(templateFilepath, jsonfilepath, outputFilepath);
+        string output = env.render_file_with_json_file(templateFilepath, jsonfilepath);
+        write_if_changed(outputFilepath, output);
     }
     catch (const std::exception& e)
     {
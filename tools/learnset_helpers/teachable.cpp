@@ -0,0 +1,759 @@
+// teachable.cpp
+// Fills in src/data/pokemon/teachable_learnsets.h with the TM and tutor moves
+// each species can learn according to the porymoves JSON files, limited to
+// the TMs in include/constants/tms_hms.h and the tutors in the event scripts.
+//
+// Must be run from the root of the project. With -c, what was found in each
+// script and JSON file is kept in a cache so that only the files which have
+// changed since the last run are read again. The header is only rewritten if
+// its contents change.
+
+#include <string>
+using std::string;
+
+#include <vector>
+using std::vector;
+
+#include <map>
+using std::map;
+
+#include <set>
+using std::set;
+
+#include <algorithm>
+using std::sort; using std::find;
+
+#include <iostream>
+using std::cout; using std::endl;
+
+#include <fstream>
+using std::ifstream; using std::ofstream;
+
+#include <sstream>
+using std::ostringstream; using std::istringstream;
+
+#include <ctime>
+#include <cstring>
+#include <filesystem>
+#include <sys/stat.h>
+
+#include "json11.h"
+using json11::Json;
+
+#include "teachable.h"
+
+#if defined(__APPLE__)
+#define MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#elif defined(_WIN32)
+#define MTIME_NSEC(st) 0
+#else
+#define MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+static const string CONFIG_PATH = "include/config/pokemon.h";
+static const string TMS_HMS_PATH = "include/constants/tms_hms.h";
+static const string POKEMON_C_PATH = "src/pokemon.c";
+static const string LEARNSETS_PATH = "src/data/pokemon/teachable_learnsets.h";
+static const string PORYMOVES_DIR = "tools/learnset_helpers/porymoves_files";
+static const string CUSTOM_JSON_PATH = PORYMOVES_DIR + "/custom.json";
+
+static const string GENERATED_MARKER = "// DO NOT MODIFY THIS FILE!";
+
+// Reads a file the way Python's text mode does, with every line ending
+// turned into '\n'.
+string read_text_file(const string &filepath) {
+    ifstream in_file(filepath, std::ios::binary);
+
+    if (!in_file.is_open())
+        FATAL_ERROR("Cannot open file %s for reading.\n", filepath.c_str());
+
+    ostringstream raw;
+    raw << in_file.rdbuf();
+
+    string text = raw.str();
+    if (text.find('\r') == string::npos)
+        return text;
+
+    string normalized;
+    normalized.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\r') {
+            normalized += '\n';
+            if (i + 1 < text.size() && text[i + 1] == '\n')
+                i++;
+        } else {
+            normalized += text[i];
+        }
+    }
+    return normalized;
+}
+
+void write_text_file(const string &filepath, const string &text) {
+    ofstream out_file(filepath, std::ios::binary);
+
+    if (!out_file.is_open())
+        FATAL_ERROR("Cannot open file %s for writing.\n", filepath.c_str());
+
+    out_file << text;
+    out_file.close();
+}
+
+// The files in dir whose names end with suffix, sorted so that the output
+// doesn't depend on the order in which the directory is read.
+vector<string> list_files(const string &dir, const string &suffix) {
+    vector<string> paths;
+    std::error_code ec;
+
+    for (auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        string name = entry.path().filename().string();
+        if (name.empty() || name[0] == '.')
+            continue;
+        if (name.size() < suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        paths.push_back(dir + "/" + name);
+    }
+
+    sort(paths.begin(), paths.end());
+    return paths;
+}
+
+vector<string> list_script_files() {
+    vector<string> paths = list_files("data/scripts", ".inc");
+    std::error_code ec;
+
+    vector<string> map_scripts;
+    for (auto &entry : std::filesystem::directory_iterator("data/maps", ec)) {
+        string name = entry.path().filename().string();
+        if (name.empty() || name[0] == '.')
+            continue;
+        string path = "data/maps/" + name + "/scripts.inc";
+        if (std::filesystem::is_regular_file(path, ec))
+            map_scripts.push_back(path);
+    }
+
+    sort(map_scripts.begin(), map_scripts.end());
+    paths.insert(paths.end(), map_scripts.begin(), map_scripts.end());
+    return paths;
+}
+
+void append_unique(vector<string> &list, const string &value) {
+    if (find(list.begin(), list.end(), value) == list.end())
+        list.push_back(value);
+}
+
+string strip(const string &s) {
+    const char *whitespace = " \t\n\r\f\v";
+    size_t start = s.find_first_not_of(whitespace);
+    if (start == string::npos)
+        return "";
+    size_t end = s.find_last_not_of(whitespace);
+    return s.substr(start, end - start + 1);
+}
+
+// What was found in one input file the last time it was read.
+struct CachedInput {
+    long long mtime = 0;
+    long long size = 0;
+    bool valid = false;
+    bool used = false;
+    vector<string> tutor_moves;
+    map<string, vector<string>> compatibility;
+};
+
+class InputCache {
+public:
+    void load(const string &path);
+    void save(const string &path);
+    CachedInput &get(const string &path);
+
+private:
+    map<string, CachedInput> entries;
+    long long saved_time = 0;
+};
+
+static const string CACHE_HEADER = "teachable cache 1";
+
+// Format:
+//   teachable cache 1 <time saved>
+//   F <path> <mtime> <size>
+//   T <tutor move>...
+//   M <species> <move>...
+// with tabs between the fields.
+void InputCache::load(const string &path) {
+    ifstream input(path);
+    string line;
+
+    if (!std::getline(input, line) || line.compare(0, CACHE_HEADER.size(), CACHE_HEADER) != 0)
+        return;
+
+    saved_time = std::strtoll(line.c_str() + CACHE_HEADER.size(), NULL, 10);
+
+    CachedInput *entry = NULL;
+    while (std::getline(input, line)) {
+        if (line.size() < 2 || line[1] != '\t')
+            continue;
+
+        vector<string> fields;
+        for (size_t start = 2; start <= line.size();) {
+            size_t end = line.find('\t', start);
+            if (end == string::npos)
+                end = line.size();
+            fields.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+
+        if (line[0] == 'F' && fields.size() == 2) {
+            entry = &entries[fields[0]];
+            *entry = CachedInput();
+            istringstream stat_fields(fields[1]);
+            entry->valid = !!(stat_fields >> entry->mtime >> entry->size);
+        } else if (line[0] == 'T' && entry != NULL && fields.size() == 1) {
+            entry->tutor_moves.push_back(fields[0]);
+        } else if (line[0] == 'M' && entry != NULL && !fields.empty()) {
+            vector<string> &moves = entry->compatibility[fields[0]];
+            moves.insert(moves.end(), fields.begin() + 1, fields.end());
+        }
+    }
+}
+
+void InputCache::save(const string &path) {
+    string tmp_path = path + ".tmp";
+    ofstream output(tmp_path);
+
+    output << CACHE_HEADER << " " << (long long)std::time(NULL) << "\n";
+    for (auto &it : entries) {
+        const CachedInput &entry = it.second;
+        if (!entry.valid || !entry.used)
+            continue;
+
+        output << "F\t" << it.first << "\t" << entry.mtime << " " << entry.size << "\n";
+        for (const string &move : entry.tutor_moves)
+            output << "T\t" << move << "\n";
+        for (auto &mon : entry.compatibility) {
+            output << "M\t" << mon.first;
+            for (const string &move : mon.second)
+                output << "\t" << move;
+            output << "\n";
+        }
+    }
+
+    output.close();
+    if (!output || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        fprintf(stderr, "Failed to write \"%s\".\n", path.c_str());
+    }
+}
+
+// Returns the cached results for the file, which are marked invalid and
+// must be filled in again if the file has changed since they were saved.
+CachedInput &InputCache::get(const string &path) {
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0)
+        FATAL_ERROR("Cannot open file %s for reading.\n", path.c_str());
+
+    long long mtime = (long long)st.st_mtime * 1000000000 + MTIME_NSEC(st);
+    long long size = st.st_size;
+
+    CachedInput &entry = entries[path];
+    // A file modified in the same second as the cache was saved could have
+    // been modified again since without its mtime changing.
+    if (!entry.valid || entry.mtime != mtime || entry.size != size || mtime / 1000000000 >= saved_time) {
+        entry = CachedInput();
+        entry.mtime = mtime;
+        entry.size = size;
+    }
+    entry.used = true;
+    return entry;
+}
+
+// Whether P_LEARNSET_HELPER_TEACHABLE is TRUE.
+bool is_enabled() {
+    string text = read_text_file(CONFIG_PATH);
+    const string define = "#define P_LEARNSET_HELPER_TEACHABLE";
+    vector<string> values;
+
+    size_t pos = 0;
+    while ((pos = text.find(define, pos)) != string::npos) {
+        pos += define.size();
+        while (pos < text.size() && text[pos] == ' ')
+            pos++;
+        size_t end = text.find(' ', pos);
+        if (end == string::npos)
+            end = text.size();
+        values.push_back(text.substr(pos, end - pos));
+        pos = end;
+    }
+
+    return values.size() == 1 && values[0] == "TRUE";
+}
+
+// The moves taught by the tutors in an event script, i.e. what VAR_0x8005
+// is set to if the script calls ChooseMonForMoveTutor.
+vector<string> find_tutor_moves(const string &text) {
+    vector<string> moves;
+
+    if (text.find("special ChooseMonForMoveTutor") == string::npos)
+        return moves;
+
+    const string setvar = "setvar VAR_0x8005, ";
+    size_t pos = 0;
+    while ((pos = text.find(setvar + "MOVE_", pos)) != string::npos) {
+        size_t start = pos + setvar.size();
+        size_t end = text.find('\n', start);
+        if (end == string::npos)
+            end = text.size();
+        append_unique(moves, text.substr(start, end - start));
+        pos = end;
+    }
+
+    return moves;
+}
+
+// The moves in the F(...) entries of tms_hms.h, in order.
+vector<string> find_tm_moves() {
+    string text = read_text_file(TMS_HMS_PATH);
+    vector<string> moves;
+    istringstream lines(text);
+    string line;
+
+    while (std::getline(lines, line)) {
+        size_t start = line.find("F(");
+        size_t end = line.rfind(')');
+        if (start != string::npos && end != string::npos && end >= start + 2)
+            append_unique(moves, "MOVE_" + line.substr(start + 2, end - start - 2));
+    }
+
+    return moves;
+}
+
+// The moves in sUniversalMoves, which every species is assumed to learn.
+vector<string> find_universal_moves() {
+    string text = read_text_file(POKEMON_C_PATH);
+    const string declaration = "static const u16 sUniversalMoves[] =";
+
+    size_t start = text.find(declaration);
+    size_t open = start == string::npos ? start : text.find('{', start + declaration.size());
+    size_t close = open == string::npos ? open : text.find("};", open + 1);
+    if (close == string::npos)
+        FATAL_ERROR("Cannot find sUniversalMoves in %s.\n", POKEMON_C_PATH.c_str());
+
+    vector<string> moves;
+    string body = text.substr(open + 1, close - open - 1);
+    for (size_t pos = 0; pos <= body.size();) {
+        size_t comma = body.find(',', pos);
+        if (comma == string::npos)
+            comma = body.size();
+        string move = strip(body.substr(pos, comma - pos));
+        if (!move.empty())
+            moves.push_back(move);
+        pos = comma + 1;
+    }
+
+    return moves;
+}
+
+// Every move each species can learn in any of the porymoves files, or only
+// those of them which are in relevant_moves if it isn't null.
+map<string, set<string>> load_compatibility(InputCache &cache, const set<string> *relevant_moves) {
+    map<string, set<string>> compatibility;
+
+    for (const string &path : list_files(PORYMOVES_DIR, ".json")) {
+        CachedInput &input = cache.get(path);
+
+        if (!input.valid) {
+            string err;
+            Json data = Json::parse(read_text_file(path), err);
+            if (data == Json())
+                FATAL_ERROR("%s: %s\n", path.c_str(), err.c_str());
+
+            for (auto &mon : data.object_items()) {
+                vector<string> &moves = input.compatibility[mon.first];
+                for (auto &move : mon.second["LevelMoves"].array_items())
+                    append_unique(moves, move["Move"].string_value());
+                for (const char *list : { "TMMoves", "EggMoves", "TutorMoves" })
+                    for (auto &move : mon.second[list].array_items())
+                        append_unique(moves, move.string_value());
+            }
+            input.valid = true;
+        }
+
+        for (auto &mon : input.compatibility) {
+            set<string> &moves = compatibility[mon.first];
+            for (const string &move : mon.second) {
+                if (relevant_moves == NULL || relevant_moves->count(move))
+                    moves.insert(move);
+            }
+        }
+    }
+
+    return compatibility;
+}
+
+// e.g. "MrMime" -> "MR_MIME"
+string parse_mon_name(const string &name) {
+    string parsed;
+
+    for (size_t i = 0; i < name.size();) {
+        if (i > 0 && isupper((unsigned char)name[i])) {
+            parsed += '_';
+            while (i < name.size() && isupper((unsigned char)name[i]))
+                parsed += name[i++];
+        } else {
+            parsed += name[i++];
+        }
+    }
+
+    for (char &c : parsed)
+        c = toupper((unsigned char)c);
+    return parsed;
+}
+
+string json_dump_string(const string &s) {
+    string out = "\"";
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = s[i];
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+// Dumps JSON with two spaces of indentation, like Python's json.dumps(x, indent=2).
+void json_dump_indented(const Json &value, string &out, int depth) {
+    string indent(2 * (depth + 1), ' ');
+    string closing_indent(2 * depth, ' ');
+
+    if (value.is_object()) {
+        if (value.object_items().empty()) {
+            out += "{}";
+            return;
+        }
+        out += "{";
+        bool first = true;
+        for (auto &item : value.object_items()) {
+            out += first ? "\n" : ",\n";
+            first = false;
+            out += indent + json_dump_string(item.first) + ": ";
+            json_dump_indented(item.second, out, depth + 1);
+        }
+        out += "\n" + closing_indent + "}";
+    } else if (value.is_array()) {
+        if (value.array_items().empty()) {
+            out += "[]";
+            return;
+        }
+        out += "[";
+        bool first = true;
+        for (auto &item : value.array_items()) {
+            out += first ? "\n" : ",\n";
+            first = false;
+            out += indent;
+            json_dump_indented(item, out, depth + 1);
+        }
+        out += "\n" + closing_indent + "]";
+    } else if (value.is_string()) {
+        out += json_dump_string(value.string_value());
+    } else {
+        out += value.dump();
+    }
+}
+
+// teachable_learnsets.h used to be edited by hand. The first time it is
+// generated, any moves in it which the porymoves files don't know about are
+// moved to custom.json so that they aren't lost.
+void preserve_custom_learnsets(const string &learnsets, const map<string, set<string>> &compatibility) {
+    map<string, vector<string>> custom_moves;
+    const string prefix = "static const u16 s";
+    const string suffix = "TeachableLearnset[] = {";
+    istringstream lines(learnsets);
+    string line;
+
+    while (std::getline(lines, line)) {
+        size_t start = line.find(prefix);
+        if (start == string::npos || line.size() < suffix.size() || line.compare(line.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        if (line.size() - suffix.size() < start + prefix.size())
+            continue;
+
+        string mon_name = parse_mon_name(line.substr(start + prefix.size(), line.size() - suffix.size() - start - prefix.size()));
+
+        vector<string> entries;
+        bool closed = false;
+        while (std::getline(lines, line)) {
+            if (line.compare(0, 2, "};") == 0) {
+                closed = true;
+                break;
+            }
+            entries.push_back(line);
+        }
+        if (!closed || mon_name == "NONE")
+            continue;
+
+        vector<string> &moves = custom_moves[mon_name];
+        auto known = compatibility.find(mon_name);
+        for (string move : entries) {
+            move.erase(std::remove(move.begin(), move.end(), ','), move.end());
+            move = strip(move);
+            if (move.empty() || move == "MOVE_UNAVAILABLE")
+                continue;
+            if (known == compatibility.end() || known->second.count(move) == 0)
+                moves.push_back(move);
+        }
+    }
+
+    Json::object custom_json;
+    if (std::filesystem::exists(CUSTOM_JSON_PATH)) {
+        string err;
+        Json existing = Json::parse(read_text_file(CUSTOM_JSON_PATH), err);
+        if (existing == Json())
+            FATAL_ERROR("%s: %s\n", CUSTOM_JSON_PATH.c_str(), err.c_str());
+        custom_json = existing.object_items();
+    }
+
+    bool changed = false;
+    for (auto &mon : custom_moves) {
+        if (mon.second.empty())
+            continue;
+
+        Json::object entry;
+        if (custom_json.count(mon.first)) {
+            entry = custom_json[mon.first].object_items();
+        } else {
+            for (const char *list : { "LevelMoves", "PreEvoMoves", "TMMoves", "EggMoves", "TutorMoves" })
+                entry[list] = Json::array();
+        }
+
+        Json::array tutor_moves = entry["TutorMoves"].array_items();
+        for (const string &move : mon.second)
+            tutor_moves.push_back(move);
+        entry["TutorMoves"] = tutor_moves;
+        custom_json[mon.first] = entry;
+        changed = true;
+    }
+
+    if (changed) {
+        string out;
+        json_dump_indented(Json(custom_json), out, 0);
+        write_text_file(CUSTOM_JSON_PATH, out);
+    }
+
+    cout << "FIRST RUN: Updated custom.json with teachable_learnsets.h's data" << endl;
+}
+
+string generate_learnset(const string &mon, const vector<string> &tm_moves, const vector<string> &tutor_moves,
+                         const vector<string> &universal_moves, const set<string> &compatible) {
+    vector<string> tm_learnset, tutor_learnset;
+
+    for (const string &move : tm_moves) {
+        if (find(universal_moves.begin(), universal_moves.end(), move) == universal_moves.end() && compatible.count(move))
+            append_unique(tm_learnset, move);
+    }
+    for (const string &move : tutor_moves) {
+        if (find(universal_moves.begin(), universal_moves.end(), move) == universal_moves.end() && compatible.count(move))
+            append_unique(tutor_learnset, move);
+    }
+
+    sort(tm_learnset.begin(), tm_learnset.end());
+    sort(tutor_learnset.begin(), tutor_learnset.end());
+    tm_learnset.insert(tm_learnset.end(), tutor_learnset.begin(), tutor_learnset.end());
+
+    string text = "static const u16 s" + mon + "TeachableLearnset[] = {\n    ";
+    for (const string &move : tm_learnset)
+        text += move + ",\n    ";
+    text += "MOVE_UNAVAILABLE,\n};";
+    return text;
+}
+
+// Replaces every learnset in the header.
+string update_learnsets(const string &text, const vector<string> &tm_moves, const vector<string> &tutor_moves,
+                        const vector<string> &universal_moves, const map<string, set<string>> &compatibility) {
+    const string prefix = "static const u16 s";
+    const string name_end = "TeachableLearnset";
+    const string body_start = "TeachableLearnset[] = {";
+
+    vector<string> mons;
+    for (size_t pos = 0; (pos = text.find(prefix, pos)) != string::npos;) {
+        size_t line_end = text.find('\n', pos);
+        if (line_end == string::npos)
+            line_end = text.size();
+        size_t name_start = pos + prefix.size();
+        size_t found = line_end >= name_start + name_end.size() ? text.rfind(name_end, line_end - name_end.size()) : string::npos;
+        if (found == string::npos || found < name_start) {
+            pos++;
+            continue;
+        }
+        mons.push_back(text.substr(name_start, found - name_start));
+        pos = found + name_end.size();
+    }
+
+    map<string, string> learnsets;
+    for (const string &mon : mons) {
+        string mon_parsed = parse_mon_name(mon);
+        auto compatible = compatibility.find(mon_parsed);
+        if (mon_parsed == "NONE" || mon_parsed == "MEW" || compatible == compatibility.end())
+            continue;
+        learnsets[mon] = generate_learnset(mon, tm_moves, tutor_moves, universal_moves, compatible->second);
+    }
+
+    string out;
+    set<string> updated;
+    size_t copied = 0;
+    for (size_t pos = 0; (pos = text.find(prefix, pos)) != string::npos;) {
+        size_t name_start = pos + prefix.size();
+        size_t body = text.find(body_start, name_start);
+        if (body == string::npos)
+            break;
+        auto learnset = learnsets.find(text.substr(name_start, body - name_start));
+        size_t end = text.find("};", body + body_start.size());
+        if (learnset == learnsets.end() || end == string::npos) {
+            pos++;
+            continue;
+        }
+        end += 2;
+        if (text.compare(pos, end - pos, learnset->second) != 0)
+            updated.insert(learnset->first);
+        out.append(text, copied, pos - copied);
+        out += learnset->second;
+        copied = pos = end;
+    }
+    out.append(text, copied, string::npos);
+
+    set<string> reported;
+    for (const string &mon : mons) {
+        string mon_parsed = parse_mon_name(mon);
+        if (mon_parsed == "NONE" || mon_parsed == "MEW")
+            continue;
+        if (!compatibility.count(mon_parsed))
+            cout << "Unable to find " << mon << " in json" << endl;
+        else if (updated.count(mon) && reported.insert(mon).second)
+            cout << "Updated " << mon << endl;
+    }
+
+    return out;
+}
+
+string generate_header(const vector<string> &tm_moves, vector<string> tutor_moves, vector<string> universal_moves) {
+    const string universal_title = "Near-universal moves found in sUniversalMoves:";
+    const string tmhm_title = "TM/HM moves found in \"include/constants/tms_hms.h\":";
+    const string tutor_title = "Tutor moves found in map scripts:";
+
+    size_t width = 0;
+    for (const string &move : tm_moves)
+        width = std::max(width, move.size());
+    for (const string &move : tutor_moves)
+        width = std::max(width, move.size());
+    width += 2; // + 2 for a hyphen and a space
+    width = std::max({ width, universal_title.size(), tmhm_title.size(), tutor_title.size() });
+
+    string header = "//\n" + GENERATED_MARKER + " It is auto-generated from tools/learnset_helpers/teachable.cpp\n//\n\n";
+    string separator = "// " + string(width, '*') + " //\n";
+
+    auto print = [&](const string &s) {
+        header += "// " + s + string(width > s.size() ? width - s.size() : 0, ' ') + " //\n";
+    };
+
+    header += separator;
+    print(tmhm_title);
+    for (const string &move : tm_moves)
+        print("- " + move);
+    header += separator;
+    print(tutor_title);
+    sort(tutor_moves.begin(), tutor_moves.end());
+    for (const string &move : tutor_moves)
+        print("- " + move);
+    header += separator;
+    print(universal_title);
+    sort(universal_moves.begin(), universal_moves.end());
+    for (const string &move : universal_moves)
+        print("- " + move);
+    header += separator + "\n";
+
+    return header;
+}
+
+string replace_header(const string &text, const string &header) {
+    if (text.find(GENERATED_MARKER) == string::npos)
+        return header + text;
+
+    const string end_marker = "* //\n\n";
+    size_t start = text.find("//\n" + GENERATED_MARKER);
+    size_t end = text.rfind(end_marker);
+    if (start == string::npos || end == string::npos || end < start + 3 + GENERATED_MARKER.size())
+        return text;
+
+    return text.substr(0, start) + header + text.substr(end + end_marker.size());
+}
+
+int main(int argc, char *argv[]) {
+    string cache_path;
+
+    if (argc == 3 && string(argv[1]) == "-c")
+        cache_path = argv[2];
+    else if (argc != 1)
+        FATAL_ERROR("USAGE: teachable [-c <cache_file>]\n");
+
+    if (!is_enabled())
+        return 0;
+
+    InputCache cache;
+    if (!cache_path.empty())
+        cache.load(cache_path);
+
+    vector<string> script_paths = list_script_files();
+    if (script_paths.empty())
+        return 0;
+
+    vector<string> tutor_moves;
+    for (const string &path : script_paths) {
+        CachedInput &input = cache.get(path);
+        if (!input.valid) {
+            input.tutor_moves = find_tutor_moves(read_text_file(path));
+            input.valid = true;
+        }
+        for (const string &move : input.tutor_moves)
+            append_unique(tutor_moves, move);
+    }
+
+    vector<string> tm_moves = find_tm_moves();
+    vector<string> universal_moves = find_universal_moves();
+
+    string learnsets = read_text_file(LEARNSETS_PATH);
+    if (learnsets.find(GENERATED_MARKER) == string::npos)
+        preserve_custom_learnsets(learnsets, load_compatibility(cache, NULL));
+
+    // Only whether a species can learn the TM and tutor moves matters.
+    set<string> relevant_moves(tm_moves.begin(), tm_moves.end());
+    relevant_moves.insert(tutor_moves.begin(), tutor_moves.end());
+    map<string, set<string>> compatibility = load_compatibility(cache, &relevant_moves);
+
+    string out = update_learnsets(learnsets, tm_moves, tutor_moves, universal_moves, compatibility);
+    out = replace_header(out, generate_header(tm_moves, tutor_moves, universal_moves));
+
+    ifstream current(LEARNSETS_PATH, std::ios::binary);
+    ostringstream current_text;
+    current_text << current.rdbuf();
+    current.close();
+    if (current_text.str() != out)
+        write_text_file(LEARNSETS_PATH, out);
+
+    if (!cache_path.empty())
+        cache.save(cache_path);
+
+    return 0;
+}
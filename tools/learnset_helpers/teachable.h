@@ -0,0 +1,31 @@
+// teachable.h
+
+#ifndef TEACHABLE_H
+#define TEACHABLE_H
+
+#include <cstdio>
+using std::fprintf; using std::exit;
+
+#include <cstdlib>
+
+#ifdef _MSC_VER
+
+#define FATAL_ERROR(format, ...)          \
+do                                        \
+{                                         \
+    fprintf(stderr, format, __VA_ARGS__); \
+    exit(1);                              \
+} while (0)
+
+#else
+
+#define FATAL_ERROR(format, ...)            \
+do                                          \
+{                                           \
+    fprintf(stderr, format, ##__VA_ARGS__); \
+    exit(1);                                \
+} while (0)
+
+#endif // _MSC_VER
+
+#endif // TEACHABLE_H
@@ -24,6 +24,12 @@ using std::ostringstream;
 #include <limits>
 using std::numeric_limits;
 
+#include <thread>
+using std::thread;
+
+#include <atomic>
+using std::atomic;
+
 #include "json11.h"
 using json11::Json;
 
@@ -63,6 +69,23 @@ void write_text_file(string filepath, string text) {
     out_file.close();
 }
 
+// Leaves the file alone if it already has this text, so that its
+// modification time only changes when its contents do.
+bool write_text_file_if_changed(string filepath, string text) {
+    ifstream in_file(filepath, std::ifstream::binary);
+
+    if (in_file.is_open()) {
+        ostringstream old_text;
+        old_text << in_file.rdbuf();
+        in_file.close();
+        if (old_text.str() == text)
+            return false;
+    }
+
+    write_text_file(filepath, text);
+    return true;
+}
+
 
 string json_to_string(const Json &data, const string &field = "", bool silent = false) {
     const Json value = !field.empty() ? data[field] : data;
@@ -96,20 +119,28 @@ string json_to_string(const Json &data, const string &field = "", bool silent =
     return output;
 }
 
-string generate_map_header_text(Json map_data, Json layouts_data) {
-    string map_layout_id = json_to_string(map_data, "layout");
+// Layouts by id, so that every map can find its layout without searching
+// the whole of layouts.json.
+typedef map<string, vector<Json>> LayoutIndex;
 
-    vector<Json> matched;
+LayoutIndex index_layouts(const Json &layouts_data) {
+    LayoutIndex layouts;
 
-    for (auto &layout : layouts_data["layouts"].array_items()) {
-        if (map_layout_id == json_to_string(layout, "id", true))
-            matched.push_back(layout);
-    }
+    for (auto &layout : layouts_data["layouts"].array_items())
+        layouts[json_to_string(layout, "id", true)].push_back(layout);
+
+    return layouts;
+}
+
+string generate_map_header_text(Json map_data, const LayoutIndex &layouts) {
+    string map_layout_id = json_to_string(map_data, "layout");
+
+    auto matched = layouts.find(map_layout_id);
 
-    if (matched.size() != 1)
+    if (matched == layouts.end() || matched->second.size() != 1)
         FATAL_ERROR("Failed to find matching layout for %s.\n", map_layout_id.c_str());
 
-    Json layout = matched[0];
+    Json layout = matched->second[0];
 
     ostringstream text;
 
@@ -347,28 +378,88 @@ string file_parent(string filename){
     return filename.substr(0, dir_pos + 1);
 }
 
-void process_map(string map_filepath, string layouts_filepath, string output_dir) {
-    string mapdata_err, layouts_err;
+Json read_layouts(string layouts_filepath) {
+    string layouts_err;
+
+    Json layouts_data = Json::parse(read_text_file(layouts_filepath), layouts_err);
+    if (layouts_data == Json())
+        FATAL_ERROR("%s\n", layouts_err.c_str());
+
+    return layouts_data;
+}
+
+void write_map_files(string map_filepath, const LayoutIndex &layouts, string output_dir, bool only_if_changed) {
+    string mapdata_err;
 
     string mapdata_json_text = read_text_file(map_filepath);
-    string layouts_json_text = read_text_file(layouts_filepath);
 
     Json map_data = Json::parse(mapdata_json_text, mapdata_err);
     if (map_data == Json())
         FATAL_ERROR("%s\n", mapdata_err.c_str());
 
-    Json layouts_data = Json::parse(layouts_json_text, layouts_err);
-    if (layouts_data == Json())
-        FATAL_ERROR("%s\n", layouts_err.c_str());
-
-    string header_text = generate_map_header_text(map_data, layouts_data);
+    string header_text = generate_map_header_text(map_data, layouts);
     string events_text = generate_map_events_text(map_data);
     string connections_text = generate_map_connections_text(map_data);
 
     string out_dir = strip_trailing_separator(output_dir).append(sep);
-    write_text_file(out_dir + "header.inc", header_text);
-    write_text_file(out_dir + "events.inc", events_text);
-    write_text_file(out_dir + "connections.inc", connections_text);
+
+    if (!only_if_changed) {
+        write_text_file(out_dir + "header.inc", header_text);
+        write_text_file(out_dir + "events.inc", events_text);
+        write_text_file(out_dir + "connections.inc", connections_text);
+    } else {
+        write_text_file_if_changed(out_dir + "header.inc", header_text);
+        write_text_file_if_changed(out_dir + "events.inc", events_text);
+        write_text_file_if_changed(out_dir + "connections.inc", connections_text);
+    }
+}
+
+void process_map(string map_filepath, string layouts_filepath, string output_dir) {
+    LayoutIndex layouts = index_layouts(read_layouts(layouts_filepath));
+
+    write_map_files(map_filepath, layouts, output_dir, false);
+}
+
+// Does the same as running 'map' mode for every map in map_groups.json, but
+// only reads layouts.json once and spreads the maps over several threads.
+// Files whose contents have not changed are not rewritten, so that whatever
+// includes them is not rebuilt.
+void process_all_maps(string groups_filepath, string layouts_filepath, string output_dir, unsigned num_threads) {
+    string err;
+    Json groups_data = Json::parse(read_text_file(groups_filepath), err);
+
+    if (groups_data == Json())
+        FATAL_ERROR("%s\n", err.c_str());
+
+    LayoutIndex layouts = index_layouts(read_layouts(layouts_filepath));
+
+    vector<string> map_names;
+    for (auto &group : groups_data["group_order"].array_items())
+    for (auto &map_name : groups_data[json_to_string(group)].array_items())
+        map_names.push_back(json_to_string(map_name));
+
+    string maps_dir = file_parent(groups_filepath);
+    output_dir = strip_trailing_separator(output_dir).append(sep);
+
+    atomic<size_t> next_map(0);
+
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next_map++) < map_names.size()) {
+            string map_filepath = maps_dir + map_names[i] + sep + "map.json";
+            write_map_files(map_filepath, layouts, output_dir + map_names[i], true);
+        }
+    };
+
+    if (num_threads == 0)
+        num_threads = std::max(thread::hardware_concurrency(), 1u);
+
+    vector<thread> threads;
+    for (unsigned i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (thread &t : threads)
+        t.join();
 }
 
 string generate_groups_text(Json groups_data) {
@@ -641,8 +732,8 @@ int main(int argc, char *argv[]) {
 
     char *mode_arg = argv[1];
     string mode(mode_arg);
-    if (mode != "layouts" && mode != "map" && mode != "groups")
-        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', or 'groups'.\n");
+    if (mode != "layouts" && mode != "map" && mode != "groups" && mode != "all")
+        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', 'groups', or 'all'.\n");
 
     if (mode == "map") {
         if (argc != 6)
@@ -677,8 +768,20 @@ int main(int argc, char *argv[]) {
 
         process_layouts(filepath, output_asm, output_c);
     }
+    else if (mode == "all") {
+        if (argc != 6 && !(argc == 8 && string(argv[6]) == "-j"))
+            FATAL_ERROR("USAGE: mapjson all <game-version> <groups_file> <layouts_file> <output_dir> [-j <threads>]\n");
+
+        infer_separator(argv[3]);
+        string groups_filepath(argv[3]);
+        string layouts_filepath(argv[4]);
+        string output_dir(argv[5]);
+        unsigned num_threads = argc == 8 ? std::strtoul(argv[7], NULL, 10) : 0;
+
+        process_all_maps(groups_filepath, layouts_filepath, output_dir, num_threads);
+    }
     else {
-        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', or 'groups'.\n");
+        FATAL_ERROR("ERROR: <mode> must be 'layouts', 'map', 'groups', or 'all'.\n");
     }
 
     return 0;
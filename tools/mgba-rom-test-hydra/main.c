@@ -14,12 +14,61 @@
  * P/K/F/A: Sets the result to the remaining of the line, flushes any
  *    output since the previous P/K/F/A and increment the number of
  *    passes/known fails/assumption fails/fails.
+ * S: Marks the start of the test whose index in the tests section is
+ *    the remainder of the line. Used to measure the cost of each test.
+ * M: Sets the number of frames, VBlanks and timer ticks which the
+ *    current test took to the three numbers in the remainder of the
+ *    line. Each tick is CYCLES_PER_TICK CPU cycles. Used by -p.
+ * Q: Reports the PASSES_RANDOMLY trials of a parameter of the current
+ *    test as "<line> <parameter> <trials> <observed> <expected>", where
+ *    the ratios are Q4.12. When the trials are sharded Hydra sums the
+ *    observed ratios of every shard and checks them against the
+ *    expected ratio itself.
+ * G: Reports a tagged RNG draw as "<tag> <lo> <hi> <value> <source>
+ *    <script> <caller>", where source is forced, trial or default,
+ *    script is gBattlescriptCurrInstr and caller is the function which
+ *    made the draw. Only sent when Hydra sets gTestRunnerTraceRng.
+ *
+ * OPTIONS
+ * -c FILE: Reads the measured cost of each test from FILE, uses them to
+ *    schedule the tests across the runners (longest first, onto the
+ *    least loaded runner), and writes the costs measured by this run
+ *    back to FILE. PASSES_RANDOMLY tests which previous runs found to
+ *    have at least as many trials as there are runners are sharded:
+ *    every runner runs every nth trial and Hydra merges the results.
+ * -w: Dispatches the tests dynamically. Instead of each runner running
+ *    a fixed share of the tests, Hydra keeps a queue of tests and gives
+ *    a batch of them to each runner; when a runner exits it is
+ *    restarted with the next batch, and any tests from its batch which
+ *    it did not start (e.g. because it crashed) are put back on the
+ *    queue. The batches shrink as the queue empties.
+ * -i DIR: Only runs the tests in files whose objects (in DIR)
+ *    transitively reference an object which has changed since the last
+ *    run in which every test passed.
+ * -j FILE: Writes a JSON object for each result to FILE as soon as it
+ *    is reported, one per line, with the test's name, file, line,
+ *    result, duration (in milliseconds) and output.
+ * -x FILE: Writes every result to FILE as JUnit XML, with a testsuite
+ *    for each file.
+ * -g FILE: Traces the tagged RNG draws of the battle tests to FILE,
+ *    followed by which tags each test drew and how (forced by
+ *    WITH_RNG, sampled by PASSES_RANDOMLY or left at the default), and
+ *    the totals for each tag. Tests which only ever get the default
+ *    value of a tag may pass by accident.
+ * -p FILE: Writes a profile of the tests to FILE: every test sorted by
+ *    the CPU cycles it took, followed by the totals for each file and
+ *    for each kind of test (e.g. SINGLE_BATTLE_TEST vs
+ *    AI_SINGLE_BATTLE_TEST), all tab-separated so that they can be
+ *    re-sorted with 'sort'.
  */
+#include <dirent.h>
 #include <fcntl.h>
+#include <getopt.h>
 #include <math.h>
 #include <poll.h>
 #include <regex.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -32,6 +81,7 @@
 #endif
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 #include "elf.h"
 
@@ -39,17 +89,50 @@
 
 #define MAX_PROCESSES               32 // See also test/test.h
 #define MAX_SUMMARY_TESTS_TO_LIST   50
-#define MAX_TEST_LIST_BUFFER_LENGTH 256
+#define CYCLES_PER_TICK             1024 // See also TIMER2_CYCLES_PER_TICK in test/test_runner.c
 
 #define ARRAY_COUNT(arr) (sizeof((arr)) / sizeof((arr)[0]))
 
+// Layout of 'struct Test' in include/test/test.h.
+#define TEST_SIZE             20
+#define TEST_NAME_OFFSET      0
+#define TEST_FILENAME_OFFSET  4
+#define TEST_RUNNER_OFFSET    8
+#define TEST_DATA_OFFSET      12
+
+// Names of the 'type' of 'struct BattleTest' in include/test/battle.h.
+static const char *const battle_test_kinds[] =
+{
+    "SINGLE_BATTLE_TEST",
+    "DOUBLE_BATTLE_TEST",
+    "WILD_BATTLE_TEST",
+    "AI_SINGLE_BATTLE_TEST",
+    "AI_DOUBLE_BATTLE_TEST",
+};
+
+#define TEST_RUNNER_UNSCHEDULED 0xFF // See also include/test/test.h
+#define TEST_RUNNER_SKIP        0xFE // See also include/test/test.h
+#define TEST_RUNNER_SHARDED     0xFD // See also include/test/test.h
+
+#define Q_4_12_TOLERANCE 81 // Q_4_12(0.02), see test/test_runner_battle.c
+
 struct Runner
 {
     pid_t pid;
     int outfd;
+    bool rom_written;
     char rom_path[FILENAME_MAX];
-    char test_name[256];
-    char filename_line[256];
+    char *test_name;
+    size_t test_name_capacity;
+    char *filename_line;
+    size_t filename_line_capacity;
+    int test_index;
+    struct timespec test_start;
+    size_t *batch;
+    size_t batch_size;
+    size_t batch_capacity;
+    int trial_shard;
+    int exit_code;
     size_t input_buffer_size;
     size_t input_buffer_capacity;
     char *input_buffer;
@@ -63,12 +146,18 @@ struct Runner
     int assumptionFails;
     int fails;
     int results;
-    char failed_TestNames[MAX_SUMMARY_TESTS_TO_LIST][MAX_TEST_LIST_BUFFER_LENGTH];
-    char failed_TestFilenameLine[MAX_SUMMARY_TESTS_TO_LIST][MAX_TEST_LIST_BUFFER_LENGTH];
-    char knownFailingPassed_TestNames[MAX_SUMMARY_TESTS_TO_LIST][MAX_TEST_LIST_BUFFER_LENGTH];
-    char knownFailingPassed_FilenameLine[MAX_SUMMARY_TESTS_TO_LIST][MAX_TEST_LIST_BUFFER_LENGTH];
-    char assumeFailed_TestNames[MAX_SUMMARY_TESTS_TO_LIST][MAX_TEST_LIST_BUFFER_LENGTH];
-    char assumeFailed_FilenameLine[MAX_SUMMARY_TESTS_TO_LIST][MAX_TEST_LIST_BUFFER_LENGTH];
+};
+
+// A result reported by a runner, in the order they were reported.
+struct TestResult
+{
+    char command; // 'P', 'K', 'U', 'T', 'A' or 'F'.
+    int runner;
+    char *name;
+    char *filename_line;
+    char *result; // e.g. "PASS", without colors.
+    char *output; // Only captured for -j and -x.
+    long duration; // In milliseconds.
 };
 
 struct Symbol {
@@ -80,17 +169,220 @@ struct Symbol {
 struct SymbolTable {
     struct Symbol *symbols;
     size_t symbols_n;
+    bool built;
+};
+
+// The sum of the observed ratios of a parameter of a sharded test.
+struct TrialRatio
+{
+    long line;
+    long observed;
+    long expected;
+};
+
+// How many times a test drew a tag, by source.
+enum { RNG_SOURCE_FORCED, RNG_SOURCE_TRIAL, RNG_SOURCE_DEFAULT, RNG_SOURCE_COUNT };
+
+static const char *const rng_source_names[RNG_SOURCE_COUNT] =
+{
+    [RNG_SOURCE_FORCED] = "forced",
+    [RNG_SOURCE_TRIAL] = "trial",
+    [RNG_SOURCE_DEFAULT] = "default",
+};
+
+struct RngTagCount
+{
+    size_t tag; // Index into rng_tags.
+    long draws[RNG_SOURCE_COUNT];
+};
+
+struct Test
+{
+    const char *name;
+    const char *filename;
+    long cost; // In milliseconds, or -1 if unknown.
+    long measured_cost;
+    long schedule_cost; // 'cost', or an estimate if it is unknown.
+    bool started;
+    bool skip;
+    int trials; // Of PASSES_RANDOMLY, or 0 if unknown.
+    bool sharded;
+    int shards_dispatched;
+    int shards_reported;
+    long shard_cost;
+    char shard_command; // Of the first shard which did not pass.
+    char *shard_result;
+    struct TrialRatio *ratios;
+    size_t ratios_n;
+    struct RngTagCount *rng_tag_counts;
+    size_t rng_tag_counts_n;
+    const char *kind; // e.g. "TEST" or "SINGLE_BATTLE_TEST".
+    bool profiled;
+    long frames;
+    long vblanks;
+    long long cycles;
+};
+
+struct Object
+{
+    char *path;
+    size_t size;
+    uint64_t hash;
+    bool changed;
+    bool affected;
+    size_t *referrers; // Objects which reference a symbol in this one.
+    size_t referrers_n;
+    size_t referrers_c;
 };
 
 static unsigned nrunners = 0;
 static unsigned runners_digits = 0;
 static struct Runner *runners = NULL;
 
-// TODO: Build the symbol table on demand.
-static struct SymbolTable symbol_table = { NULL, 0 };
+static struct SymbolTable symbol_table = { NULL, 0, false };
+
+static size_t ntests = 0;
+static struct Test *tests = NULL;
+
+static void *elf = NULL;
+static size_t elf_size = 0;
+static const char *mgba_rom_test = NULL;
+static const char *objcopy = NULL;
+static pid_t parent_pid;
+
+// Variables in the ROM which Hydra patches.
+static uint8_t *rom_runner_n = NULL;
+static uint8_t *rom_runner_i = NULL;
+static const char *rom_argv = NULL;
+static uint8_t *rom_schedule = NULL;
+static size_t rom_schedule_size = 0;
+static uint8_t *rom_trial_shard = NULL;
+static uint8_t *rom_trial_shards = NULL;
+static uint8_t *rom_trace_rng = NULL;
+
+// Tests which have not been dispatched to a runner yet, in the order
+// they should be dispatched. Used by -w.
+static bool dynamic_dispatch = false;
+static size_t *queue = NULL;
+static size_t queue_head = 0;
+static size_t queue_tail = 0;
+static long queue_cost = 0;
+
+static size_t test_results_n = 0;
+static size_t test_results_capacity = 0;
+static struct TestResult *test_results = NULL;
+static bool capture_output = false;
+static FILE *json_file = NULL;
+
+// The names of the RNG tags which have been traced. Used by -g.
+static FILE *rng_trace_file = NULL;
+static char **rng_tags = NULL;
+static size_t rng_tags_n = 0;
+
+// Objects the ROM was linked from. Used by -i.
+static size_t nobjects = 0;
+static size_t objects_capacity = 0;
+static struct Object *objects = NULL;
+static char object_hashes_path[FILENAME_MAX];
+
+static int compare_addresses(const void *a, const void *b)
+{
+    const struct Symbol *sa = a, *sb = b;
+    if (sa->address < sb->address)
+        return -1;
+    else if (sa->address == sb->address)
+        return 0;
+    else
+        return 1;
+}
+
+static bool find_symtab(const void *elf, const Elf32_Sym **symtab, size_t *symtab_n, const char **strtab)
+{
+    const Elf32_Ehdr *ehdr = (Elf32_Ehdr *)elf;
+    const Elf32_Shdr *shdrs = (Elf32_Shdr *)(elf + ehdr->e_shoff);
+
+    if (ehdr->e_shstrndx == SHN_UNDEF)
+        return false;
+    const Elf32_Shdr *shdr_shstr = &shdrs[ehdr->e_shstrndx];
+    const char *shstr = (const char *)(elf + shdr_shstr->sh_offset);
+    const Elf32_Shdr *shdr_symtab = NULL;
+    const Elf32_Shdr *shdr_strtab = NULL;
+    for (int i = 0; i < ehdr->e_shnum; i++)
+    {
+        const char *sh_name = shstr + shdrs[i].sh_name;
+        if (strcmp(sh_name, ".symtab") == 0)
+            shdr_symtab = &shdrs[i];
+        else if (strcmp(sh_name, ".strtab") == 0)
+            shdr_strtab = &shdrs[i];
+    }
+    if (!shdr_symtab)
+        return false;
+    if (!shdr_strtab)
+        return false;
+
+    *symtab = (Elf32_Sym *)(elf + shdr_symtab->sh_offset);
+    *symtab_n = shdr_symtab->sh_size / shdr_symtab->sh_entsize;
+    *strtab = (const char *)(elf + shdr_strtab->sh_offset);
+    return true;
+}
+
+static void build_symbol_table(void *elf)
+{
+    symbol_table.built = true;
+
+    if (memcmp(elf, ELFMAG, 4) != 0)
+        goto error;
+
+    size_t symbol_table_symbols_c = 1024;
+    symbol_table.symbols = malloc(symbol_table_symbols_c * sizeof(*symbol_table.symbols));
+    if (symbol_table.symbols == NULL)
+        goto error;
+
+    const Elf32_Ehdr *ehdr = (Elf32_Ehdr *)elf;
+    const Elf32_Sym *symtab;
+    size_t symtab_n;
+    const char *strtab;
+    if (!find_symtab(elf, &symtab, &symtab_n, &strtab))
+        goto error;
+
+    for (int i = 0; i < symtab_n; i++)
+    {
+        if (symtab[i].st_name == 0) continue;
+        if (symtab[i].st_shndx > ehdr->e_shnum) continue;
+        if (symtab[i].st_value < 0x2000000 || symtab[i].st_size == 0) continue;
+        struct Symbol symbol =
+        {
+            .name = strtab + symtab[i].st_name,
+            .address = symtab[i].st_value,
+            .size = symtab[i].st_size,
+        };
+        if (symbol_table.symbols_n == symbol_table_symbols_c)
+        {
+            symbol_table_symbols_c *= 2;
+            void *symbols = realloc(symbol_table.symbols, symbol_table_symbols_c * sizeof(*symbol_table.symbols));
+            if (symbols == NULL)
+                goto error;
+            symbol_table.symbols = symbols;
+        }
+        symbol_table.symbols[symbol_table.symbols_n++] = symbol;
+    }
+
+    qsort(symbol_table.symbols, symbol_table.symbols_n, sizeof(*symbol_table.symbols), compare_addresses);
+    return;
+
+error:
+    free(symbol_table.symbols);
+    symbol_table.symbols = NULL;
+    symbol_table.symbols_n = 0;
+}
 
+// The symbol table is only needed to name addresses in crashes and
+// unknown test runners, so it is not built until one has to be named.
 static const struct Symbol *lookup_address(uint32_t address)
 {
+    if (!symbol_table.built)
+        build_symbol_table(elf);
+
     int lo = 0, hi = symbol_table.symbols_n;
     while (lo < hi)
     {
@@ -113,7 +405,9 @@ void *memmem(const void *haystack, size_t haystacklen, const void *needle, size_
 {
     const char *haystack_ = haystack;
     const char *needle_ = needle;
-    for (size_t i = 0; i < haystacklen - needlelen; i++)
+    if (needlelen > haystacklen)
+        return NULL;
+    for (size_t i = 0; i <= haystacklen - needlelen; i++)
     {
         size_t j;
         for (j = 0; j < needlelen; j++)
@@ -190,245 +484,1779 @@ static void fprint_buffer(FILE *f, const char *buffer, size_t size)
     }
 }
 
-static void handle_read(int i, struct Runner *runner)
+// Removes the ANSI color codes from 's' in place.
+static void strip_colors(char *s)
 {
-    char *sol = runner->input_buffer;
-    char *eol;
-    size_t consumed = 0;
-    size_t remaining = runner->input_buffer_size;
-    while ((eol = memchr(sol, '\n', remaining)))
+    char *d = s;
+    while (*s)
     {
-        eol++;
-        size_t n = eol - sol;
-        char *soc;
-        if (runner->input_buffer_size >= strlen("GBA: ")
-         && !strncmp(sol, "GBA: ", strlen("GBA: ")))
+        if (s[0] == '\e' && s[1] == '[')
         {
-            soc = sol + strlen("GBA: ");
-            goto buffer_output;
+            s += 2;
+            while (*s && *s != 'm')
+                s++;
+            if (*s)
+                s++;
         }
-        else if (runner->input_buffer_size >= strlen("GBA Debug: ")
-              && !strncmp(sol, "GBA Debug: ", strlen("GBA Debug: ")))
+        else
         {
-            soc = sol + strlen("GBA Debug: ");
-            if (soc[0] == ':')
-            {
-                switch (soc[1])
-                {
-                case 'N':
-                    soc += 2;
-                    if (sizeof(runner->test_name) <= eol - soc - 1)
-                    {
-                        fprintf(stderr, "test_name too long\n");
-                        exit(2);
-                    }
-                    strncpy(runner->test_name, soc, eol - soc - 1);
-                    runner->test_name[eol - soc - 1] = '\0';
-                    break;
-                case 'L':
-                    soc += 2;
-                    if (sizeof(runner->filename_line) <= eol - soc - 1)
-                    {
-                        fprintf(stderr, "filename_line too long\n");
-                        exit(2);
-                    }
-                    strncpy(runner->filename_line, soc, eol - soc - 1);
-                    runner->filename_line[eol - soc - 1] = '\0';
-                    break;
+            *d++ = *s++;
+        }
+    }
+    *d = '\0';
+}
 
-                case 'P':
-                    runner->passes++;
-                    goto add_to_results;
-                case 'K':
-                    runner->knownFails++;
-                    goto add_to_results;
-                case 'U':
-                    if (runner->knownFailsPassing < MAX_SUMMARY_TESTS_TO_LIST)
-                    {
-                        strcpy(runner->knownFailingPassed_TestNames[runner->knownFailsPassing], runner->test_name);
-                        strcpy(runner->knownFailingPassed_FilenameLine[runner->knownFailsPassing], runner->filename_line);
-                    }
-                    runner->knownFailsPassing++;
-                    goto add_to_results;
-                case 'T':
-                    runner->todos++;
-                    goto add_to_results;
-                case 'A':
-                    if (runner->assumptionFails < MAX_SUMMARY_TESTS_TO_LIST)
-                    {
-                        strcpy(runner->assumeFailed_TestNames[runner->assumptionFails], runner->test_name);
-                        strcpy(runner->assumeFailed_FilenameLine[runner->assumptionFails], runner->filename_line);
-                    }
-                    runner->assumptionFails++;
-                    goto add_to_results;
-                case 'F':
-                    if (runner->fails < MAX_SUMMARY_TESTS_TO_LIST)
-                    {
-                        strcpy(runner->failed_TestNames[runner->fails], runner->test_name);
-                        strcpy(runner->failed_TestFilenameLine[runner->fails], runner->filename_line);
-                    }
-                    runner->fails++;
-add_to_results:
-                    runner->results++;
-                    soc += 2;
-                    fprintf(stdout, "[%0*d] %s: ", runners_digits, i, runner->test_name);
-                    fwrite(soc, 1, eol - soc, stdout);
-                    fprint_buffer(stdout, runner->output_buffer, runner->output_buffer_size);
-                    strcpy(runner->test_name, "WAITING...");
-                    runner->output_buffer_size = 0;
-                    break;
+static char *copy_string(const char *s, size_t n)
+{
+    char *copy = malloc(n + 1);
+    if (!copy)
+    {
+        perror("malloc copy_string failed");
+        exit(2);
+    }
+    memcpy(copy, s, n);
+    copy[n] = '\0';
+    return copy;
+}
 
-                default:
-                    goto buffer_output;
-                }
-            }
-            else
-            {
-buffer_output:
-                if (runner->output_buffer_size + eol - soc >= runner->output_buffer_capacity)
-                {
-                    runner->output_buffer_capacity *= 2;
-                    if (runner->output_buffer_capacity < runner->output_buffer_size + eol - soc)
-                        runner->output_buffer_capacity = runner->output_buffer_size + eol - soc;
-                    runner->output_buffer = realloc(runner->output_buffer, runner->output_buffer_capacity);
-                    if (!runner->output_buffer)
-                    {
-                        perror("realloc output_buffer failed");
-                        exit(2);
-                    }
-                }
-                memcpy(runner->output_buffer + runner->output_buffer_size, soc, eol - soc);
-                runner->output_buffer_size += eol - soc;
+// Formats into one of a runner's strings, e.g. its test_name, growing
+// it if it is too small.
+static void set_string(char **string, size_t *capacity, const char *format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    int n = vsnprintf(*string, *capacity, format, va);
+    va_end(va);
+    if (n < 0)
+    {
+        perror("vsnprintf set_string failed");
+        exit(2);
+    }
+    if ((size_t)n >= *capacity)
+    {
+        *capacity = n + 1;
+        if ((*string = realloc(*string, *capacity)) == NULL)
+        {
+            perror("realloc set_string failed");
+            exit(2);
+        }
+        va_start(va, format);
+        vsnprintf(*string, *capacity, format, va);
+        va_end(va);
+    }
+}
+
+// Returns the line number in 'filename_line', e.g. 12 for
+// "test/battle/move.c:12 - TIMEOUT".
+static long filename_line_line(const char *filename_line)
+{
+    const char *colon = strchr(filename_line, ':');
+    return colon ? strtol(colon + 1, NULL, 10) : 0;
+}
+
+static void fprint_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c == '\n')
+            fputs("\\n", f);
+        else if (c == '\t')
+            fputs("\\t", f);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+// Prints 's' as XML character data. Control characters other than
+// newlines and tabs are not allowed in XML 1.0, so they are dropped.
+static void fprint_xml_string(FILE *f, const char *s)
+{
+    for (; *s; s++)
+    {
+        unsigned char c = *s;
+        switch (c)
+        {
+        case '<': fputs("&lt;", f); break;
+        case '>': fputs("&gt;", f); break;
+        case '&': fputs("&amp;", f); break;
+        case '"': fputs("&quot;", f); break;
+        case '\n':
+        case '\t':
+            fputc(c, f);
+            break;
+        default:
+            if (c >= 0x20)
+                fputc(c, f);
+            break;
+        }
+    }
+}
+
+static const char *test_result_status(char command)
+{
+    switch (command)
+    {
+    case 'P': return "pass";
+    case 'K': return "known_fail";
+    case 'U': return "known_fail_passing";
+    case 'T': return "todo";
+    case 'A': return "assumption_fail";
+    default:  return "fail";
+    }
+}
+
+static const char *test_result_filename(const struct TestResult *result)
+{
+    static char filename[FILENAME_MAX];
+    const char *colon = strchr(result->filename_line, ':');
+    size_t n = colon ? colon - result->filename_line : strlen(result->filename_line);
+    if (n >= sizeof(filename))
+        n = sizeof(filename) - 1;
+    memcpy(filename, result->filename_line, n);
+    filename[n] = '\0';
+    return filename;
+}
+
+static void add_test_result(int i, struct Runner *runner, char command, const char *result, size_t result_n, long duration)
+{
+    if (test_results_n == test_results_capacity)
+    {
+        test_results_capacity = test_results_capacity ? 2 * test_results_capacity : 1024;
+        if ((test_results = realloc(test_results, test_results_capacity * sizeof(*test_results))) == NULL)
+        {
+            perror("realloc test_results failed");
+            exit(2);
+        }
+    }
+
+    struct TestResult *test_result = &test_results[test_results_n++];
+    test_result->command = command;
+    test_result->runner = i;
+    test_result->name = copy_string(runner->test_name, strlen(runner->test_name));
+    test_result->filename_line = copy_string(runner->filename_line, strlen(runner->filename_line));
+    test_result->result = copy_string(result, result_n);
+    strip_colors(test_result->result);
+    test_result->output = NULL;
+    test_result->duration = duration;
+    if (capture_output)
+    {
+        size_t output_n;
+        FILE *f = open_memstream(&test_result->output, &output_n);
+        if (!f)
+        {
+            perror("open_memstream failed");
+            exit(2);
+        }
+        fprint_buffer(f, runner->output_buffer, runner->output_buffer_size);
+        fclose(f);
+        strip_colors(test_result->output);
+    }
+
+    if (json_file)
+    {
+        fprintf(json_file, "{\"name\":");
+        fprint_json_string(json_file, test_result->name);
+        fprintf(json_file, ",\"file\":");
+        fprint_json_string(json_file, test_result_filename(test_result));
+        fprintf(json_file, ",\"line\":%ld,\"result\":", filename_line_line(test_result->filename_line));
+        fprint_json_string(json_file, test_result->result);
+        fprintf(json_file, ",\"status\":\"%s\",\"duration_ms\":%ld,\"runner\":%d,\"output\":",
+                test_result_status(command), duration, i);
+        fprint_json_string(json_file, test_result->output);
+        fprintf(json_file, "}\n");
+        fflush(json_file);
+    }
+}
+
+static int compare_test_results_by_file(const void *a, const void *b)
+{
+    const struct TestResult *result_a = *(const struct TestResult **)a;
+    const struct TestResult *result_b = *(const struct TestResult **)b;
+    char filename_a[FILENAME_MAX];
+    strcpy(filename_a, test_result_filename(result_a));
+    int r = strcmp(filename_a, test_result_filename(result_b));
+    if (r)
+        return r;
+    return result_a < result_b ? -1 : result_a > result_b;
+}
+
+static void write_junit(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        return;
+    }
+
+    const struct TestResult **order = malloc(test_results_n * sizeof(*order));
+    if (!order && test_results_n > 0)
+    {
+        perror("malloc order failed");
+        exit(2);
+    }
+    int failures = 0, skipped = 0;
+    long duration = 0;
+    for (size_t i = 0; i < test_results_n; i++)
+    {
+        order[i] = &test_results[i];
+        failures += test_results[i].command == 'F' || test_results[i].command == 'U';
+        skipped += test_results[i].command == 'K' || test_results[i].command == 'T' || test_results[i].command == 'A';
+        duration += test_results[i].duration;
+    }
+    qsort(order, test_results_n, sizeof(*order), compare_test_results_by_file);
+
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(f, "<testsuites tests=\"%zu\" failures=\"%d\" skipped=\"%d\" time=\"%.3f\">\n",
+            test_results_n, failures, skipped, duration / 1000.0);
+    for (size_t i = 0, j; i < test_results_n; i = j)
+    {
+        char filename[FILENAME_MAX];
+        strcpy(filename, test_result_filename(order[i]));
+        failures = skipped = 0;
+        duration = 0;
+        for (j = i; j < test_results_n && !strcmp(filename, test_result_filename(order[j])); j++)
+        {
+            failures += order[j]->command == 'F' || order[j]->command == 'U';
+            skipped += order[j]->command == 'K' || order[j]->command == 'T' || order[j]->command == 'A';
+            duration += order[j]->duration;
+        }
+
+        fprintf(f, "  <testsuite name=\"");
+        fprint_xml_string(f, filename);
+        fprintf(f, "\" tests=\"%zu\" failures=\"%d\" skipped=\"%d\" time=\"%.3f\">\n",
+                j - i, failures, skipped, duration / 1000.0);
+        for (size_t k = i; k < j; k++)
+        {
+            const struct TestResult *result = order[k];
+            fprintf(f, "    <testcase classname=\"");
+            fprint_xml_string(f, filename);
+            fprintf(f, "\" name=\"");
+            fprint_xml_string(f, result->name);
+            fprintf(f, "\" file=\"");
+            fprint_xml_string(f, filename);
+            fprintf(f, "\" line=\"%ld\" time=\"%.3f\">\n", filename_line_line(result->filename_line), result->duration / 1000.0);
+            if (result->command == 'F' || result->command == 'U')
+            {
+                fprintf(f, "      <failure message=\"");
+                fprint_xml_string(f, result->result);
+                fprintf(f, "\">");
+                fprint_xml_string(f, result->filename_line);
+                fprintf(f, "</failure>\n");
+            }
+            else if (result->command != 'P')
+            {
+                fprintf(f, "      <skipped message=\"");
+                fprint_xml_string(f, result->result);
+                fprintf(f, "\"/>\n");
+            }
+            if (result->output && result->output[0])
+            {
+                fprintf(f, "      <system-out>");
+                fprint_xml_string(f, result->output);
+                fprintf(f, "</system-out>\n");
+            }
+            fprintf(f, "    </testcase>\n");
+        }
+        fprintf(f, "  </testsuite>\n");
+    }
+    fprintf(f, "</testsuites>\n");
+
+    if (fclose(f) != 0)
+        perror(path);
+    free(order);
+}
+
+// Prints the tests whose result was reported with 'command'.
+static void print_test_results(char command, const char *color)
+{
+    int listed = 0, n = 0;
+    for (size_t i = 0; i < test_results_n; i++)
+        n += test_results[i].command == command;
+    for (size_t i = 0; i < test_results_n; i++)
+    {
+        const struct TestResult *result = &test_results[i];
+        if (result->command != command)
+            continue;
+        if (listed >= MAX_SUMMARY_TESTS_TO_LIST)
+        {
+            fprintf(stdout, "  - %sand %d more...\e[0m\n", color, n - MAX_SUMMARY_TESTS_TO_LIST);
+            break;
+        }
+        fprintf(stdout, "  - %s", color);
+        fprint_buffer(stdout, result->filename_line, strlen(result->filename_line));
+        fprintf(stdout, "\e[0m - %s.\n", result->name);
+        listed++;
+    }
+}
+
+static size_t intern_rng_tag(const char *name)
+{
+    for (size_t i = 0; i < rng_tags_n; i++)
+    {
+        if (!strcmp(rng_tags[i], name))
+            return i;
+    }
+    if ((rng_tags = realloc(rng_tags, (rng_tags_n + 1) * sizeof(*rng_tags))) == NULL)
+    {
+        perror("realloc rng_tags failed");
+        exit(2);
+    }
+    rng_tags[rng_tags_n] = copy_string(name, strlen(name));
+    return rng_tags_n++;
+}
+
+// Handles a 'G' command: writes the draw to the trace and counts it
+// against the runner's current test.
+static void trace_rng(struct Runner *runner, const char *soc, const char *eol)
+{
+    char tag[64], source[16];
+    long lo, hi, value;
+    int n;
+    if (sscanf(soc, "%63s %ld %ld %ld %15s %n", tag, &lo, &hi, &value, source, &n) != 5)
+        return;
+
+    fprintf(rng_trace_file, "%s\t%s\t%ld\t%ld\t%ld\t%s\t", runner->test_name, tag, lo, hi, value, source);
+    const char *script = soc + n;
+    const char *caller = memchr(script, ' ', eol - script);
+    if (caller)
+    {
+        fprint_buffer(rng_trace_file, script, caller - script);
+        fputc('\t', rng_trace_file);
+        fprint_buffer(rng_trace_file, caller + 1, eol - caller - 1);
+    }
+    else
+    {
+        fprint_buffer(rng_trace_file, script, eol - script);
+    }
+
+    if (runner->test_index < 0 || runner->test_index >= ntests)
+        return;
+    struct Test *test = &tests[runner->test_index];
+    size_t tag_i = intern_rng_tag(tag);
+    struct RngTagCount *count = NULL;
+    for (size_t i = 0; i < test->rng_tag_counts_n; i++)
+    {
+        if (test->rng_tag_counts[i].tag == tag_i)
+            count = &test->rng_tag_counts[i];
+    }
+    if (!count)
+    {
+        if ((test->rng_tag_counts = realloc(test->rng_tag_counts, (test->rng_tag_counts_n + 1) * sizeof(*test->rng_tag_counts))) == NULL)
+        {
+            perror("realloc rng_tag_counts failed");
+            exit(2);
+        }
+        count = &test->rng_tag_counts[test->rng_tag_counts_n++];
+        *count = (struct RngTagCount) { .tag = tag_i };
+    }
+    for (int i = 0; i < RNG_SOURCE_COUNT; i++)
+    {
+        if (!strcmp(source, rng_source_names[i]))
+            count->draws[i]++;
+    }
+}
+
+// Appends the tags each test drew, and the totals for each tag, to the
+// trace.
+static void write_rng_summary(void)
+{
+    fprintf(rng_trace_file, "\n# test tags\n# forced\ttrial\tdefault\ttag\tfile\ttest\n");
+    long (*totals)[RNG_SOURCE_COUNT + 1] = calloc(rng_tags_n, sizeof(*totals));
+    if (!totals && rng_tags_n > 0)
+    {
+        perror("calloc totals failed");
+        exit(2);
+    }
+    for (size_t i = 0; i < ntests; i++)
+    {
+        for (size_t j = 0; j < tests[i].rng_tag_counts_n; j++)
+        {
+            const struct RngTagCount *count = &tests[i].rng_tag_counts[j];
+            fprintf(rng_trace_file, "%ld\t%ld\t%ld\t%s\t%s\t%s\n",
+                    count->draws[RNG_SOURCE_FORCED], count->draws[RNG_SOURCE_TRIAL], count->draws[RNG_SOURCE_DEFAULT],
+                    rng_tags[count->tag], tests[i].filename, tests[i].name);
+            for (int k = 0; k < RNG_SOURCE_COUNT; k++)
+                totals[count->tag][k] += count->draws[k];
+            totals[count->tag][RNG_SOURCE_COUNT]++;
+        }
+    }
+
+    fprintf(rng_trace_file, "\n# tag\n# forced\ttrial\tdefault\ttests\ttag\n");
+    for (size_t i = 0; i < rng_tags_n; i++)
+    {
+        fprintf(rng_trace_file, "%ld\t%ld\t%ld\t%ld\t%s\n",
+                totals[i][RNG_SOURCE_FORCED], totals[i][RNG_SOURCE_TRIAL], totals[i][RNG_SOURCE_DEFAULT],
+                totals[i][RNG_SOURCE_COUNT], rng_tags[i]);
+    }
+    free(totals);
+}
+
+static void append_output(struct Runner *runner, const char *s, size_t n)
+{
+    if (runner->output_buffer_size + n >= runner->output_buffer_capacity)
+    {
+        runner->output_buffer_capacity *= 2;
+        if (runner->output_buffer_capacity < runner->output_buffer_size + n)
+            runner->output_buffer_capacity = runner->output_buffer_size + n;
+        runner->output_buffer = realloc(runner->output_buffer, runner->output_buffer_capacity);
+        if (!runner->output_buffer)
+        {
+            perror("realloc output_buffer failed");
+            exit(2);
+        }
+    }
+    memcpy(runner->output_buffer + runner->output_buffer_size, s, n);
+    runner->output_buffer_size += n;
+}
+
+// Milliseconds since the runner's current test started.
+static long elapsed_ms(const struct Runner *runner)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - runner->test_start.tv_sec) * 1000
+         + (now.tv_nsec - runner->test_start.tv_nsec) / 1000000;
+}
+
+static void add_trial_ratio(struct Test *test, const char *s)
+{
+    char *end;
+    long line = strtol(s, &end, 10);
+    long parameter = strtol(end, &end, 10);
+    long trials = strtol(end, &end, 10);
+    long observed = strtol(end, &end, 10);
+    long expected = strtol(end, NULL, 10);
+    if (trials > test->trials)
+        test->trials = trials;
+    if (!test->sharded || parameter < 0)
+        return;
+
+    if (parameter >= test->ratios_n)
+    {
+        if ((test->ratios = realloc(test->ratios, (parameter + 1) * sizeof(*test->ratios))) == NULL)
+        {
+            perror("realloc ratios failed");
+            exit(2);
+        }
+        memset(test->ratios + test->ratios_n, 0, (parameter + 1 - test->ratios_n) * sizeof(*test->ratios));
+        test->ratios_n = parameter + 1;
+    }
+    test->ratios[parameter].line = line;
+    test->ratios[parameter].observed += observed;
+    test->ratios[parameter].expected = expected;
+}
+
+// Merges the result of one shard of a sharded test into the test.
+// Returns false (after printing the shard's result as progress) until
+// every shard has reported, and then replaces the result in '*soc' and
+// '*eol' with the merged result.
+static bool merge_trial_shard(int i, struct Runner *runner, char **soc, char **eol)
+{
+    static char merged[256];
+    struct Test *test = &tests[runner->test_index];
+    char command = (*soc)[1];
+
+    if (command != 'P' && !test->shard_result)
+    {
+        test->shard_command = command;
+        test->shard_result = copy_string(*soc + 2, *eol - *soc - 2);
+    }
+
+    if (++test->shards_reported < nrunners)
+    {
+        test->shard_cost += elapsed_ms(runner);
+        fprintf(stdout, "[%0*d] %s (shard %d/%d): ", runners_digits, i, runner->test_name, runner->trial_shard + 1, nrunners);
+        fwrite(*soc + 2, 1, *eol - *soc - 2, stdout);
+        fprint_buffer(stdout, runner->output_buffer, runner->output_buffer_size);
+        set_string(&runner->test_name, &runner->test_name_capacity, "WAITING...");
+        runner->output_buffer_size = 0;
+        runner->test_index = -1;
+        return false;
+    }
+
+    set_string(&runner->test_name, &runner->test_name_capacity, "%s", test->name);
+    if (test->shard_result)
+    {
+        snprintf(merged, sizeof(merged), ":%c%s", test->shard_command, test->shard_result);
+    }
+    else
+    {
+        snprintf(merged, sizeof(merged), ":P\e[32mPASS\e[0m\n");
+        for (size_t j = 0; j < test->ratios_n; j++)
+        {
+            const struct TrialRatio *ratio = &test->ratios[j];
+            if (labs(ratio->observed - ratio->expected) > Q_4_12_TOLERANCE)
+            {
+                char message[FILENAME_MAX + 128];
+                int n = snprintf(message, sizeof(message), "%s:%ld: Expected %.3f passes/successes, observed %.3f\n",
+                                 test->filename, ratio->line, ratio->expected / 4096.0, ratio->observed / 4096.0);
+                append_output(runner, message, min(n, sizeof(message) - 1));
+                set_string(&runner->filename_line, &runner->filename_line_capacity, "%s:%ld", test->filename, ratio->line);
+                snprintf(merged, sizeof(merged), ":F\e[31mFAIL\e[0m\n");
+                // The shards all passed, so mgba-rom-test will exit with 0.
+                if (runner->exit_code == 0)
+                    runner->exit_code = 1;
+                break;
+            }
+        }
+    }
+    *soc = merged;
+    *eol = merged + strlen(merged);
+    return true;
+}
+
+static void handle_read(int i, struct Runner *runner)
+{
+    char *sol = runner->input_buffer;
+    char *eol;
+    size_t consumed = 0;
+    size_t remaining = runner->input_buffer_size;
+    while ((eol = memchr(sol, '\n', remaining)))
+    {
+        eol++;
+        size_t n = eol - sol;
+        char *soc;
+        if (runner->input_buffer_size >= strlen("GBA: ")
+         && !strncmp(sol, "GBA: ", strlen("GBA: ")))
+        {
+            soc = sol + strlen("GBA: ");
+            goto buffer_output;
+        }
+        else if (runner->input_buffer_size >= strlen("GBA Debug: ")
+              && !strncmp(sol, "GBA Debug: ", strlen("GBA Debug: ")))
+        {
+            soc = sol + strlen("GBA Debug: ");
+            if (soc[0] == ':')
+            {
+                if (soc[1] != '\0' && strchr("PKUTAF", soc[1])
+                 && 0 <= runner->test_index && runner->test_index < ntests
+                 && tests[runner->test_index].sharded
+                 && !merge_trial_shard(i, runner, &soc, &eol))
+                {
+                    goto next_line;
+                }
+
+                switch (soc[1])
+                {
+                case 'N':
+                    soc += 2;
+                    set_string(&runner->test_name, &runner->test_name_capacity, "%.*s", (int)(eol - soc - 1), soc);
+                    break;
+                case 'L':
+                    soc += 2;
+                    set_string(&runner->filename_line, &runner->filename_line_capacity, "%.*s", (int)(eol - soc - 1), soc);
+                    break;
+                case 'S':
+                    soc += 2;
+                    runner->test_index = strtol(soc, NULL, 10);
+                    if (0 <= runner->test_index && runner->test_index < ntests)
+                        tests[runner->test_index].started = true;
+                    clock_gettime(CLOCK_MONOTONIC, &runner->test_start);
+                    break;
+
+                case 'M':
+                    soc += 2;
+                    if (0 <= runner->test_index && runner->test_index < ntests)
+                    {
+                        struct Test *test = &tests[runner->test_index];
+                        char *end;
+                        // Sharded tests report once per shard.
+                        test->frames += strtol(soc, &end, 10);
+                        test->vblanks += strtol(end, &end, 10);
+                        test->cycles += strtoll(end, NULL, 10) * CYCLES_PER_TICK;
+                        test->profiled = true;
+                    }
+                    break;
+
+                case 'G':
+                    if (rng_trace_file)
+                        trace_rng(runner, soc + 2, eol);
+                    break;
+
+                case 'Q':
+                    soc += 2;
+                    if (0 <= runner->test_index && runner->test_index < ntests)
+                        add_trial_ratio(&tests[runner->test_index], soc);
+                    break;
+
+                case 'P':
+                    runner->passes++;
+                    goto add_to_results;
+                case 'K':
+                    runner->knownFails++;
+                    goto add_to_results;
+                case 'U':
+                    runner->knownFailsPassing++;
+                    goto add_to_results;
+                case 'T':
+                    runner->todos++;
+                    goto add_to_results;
+                case 'A':
+                    runner->assumptionFails++;
+                    goto add_to_results;
+                case 'F':
+                    runner->fails++;
+add_to_results:
+                    runner->results++;
+                    long duration = 0;
+                    if (0 <= runner->test_index && runner->test_index < ntests)
+                    {
+                        long cost = elapsed_ms(runner) + tests[runner->test_index].shard_cost;
+                        tests[runner->test_index].measured_cost = cost > 0 ? cost : 1;
+                        duration = tests[runner->test_index].measured_cost;
+                    }
+                    runner->test_index = -1;
+                    char command = soc[1];
+                    soc += 2;
+                    fprintf(stdout, "[%0*d] %s: ", runners_digits, i, runner->test_name);
+                    fwrite(soc, 1, eol - soc, stdout);
+                    fprint_buffer(stdout, runner->output_buffer, runner->output_buffer_size);
+                    add_test_result(i, runner, command, soc, eol - soc - 1, duration);
+                    set_string(&runner->test_name, &runner->test_name_capacity, "WAITING...");
+                    runner->output_buffer_size = 0;
+                    break;
+
+                default:
+                    goto buffer_output;
+                }
+            }
+            else
+            {
+buffer_output:
+                append_output(runner, soc, eol - soc);
+            }
+        }
+        else
+        {
+            fwrite(sol, 1, eol - sol, stdout);
+        }
+next_line:
+        sol += n;
+        consumed += n;
+        remaining -= n;
+    }
+
+    memcpy(runner->input_buffer, sol, remaining);
+    runner->input_buffer_size -= consumed;
+
+    if (runner->input_buffer_size == runner->input_buffer_capacity)
+    {
+        runner->input_buffer_capacity *= 2;
+        runner->input_buffer = realloc(runner->input_buffer, runner->input_buffer_capacity);
+        if (!runner->input_buffer)
+        {
+            perror("realloc input_buffer failed");
+            exit(2);
+        }
+    }
+}
+
+static void unlink_roms(void)
+{
+    for (int i = 0; i < nrunners; i++)
+    {
+        if (runners[i].rom_path[0])
+        {
+            if (unlink(runners[i].rom_path) == -1)
+            {
+                int fd;
+                if ((fd = open(runners[i].rom_path, O_RDONLY)) != -1)
+                    perror("unlink rom_path failed");
+            }
+        }
+    }
+}
+
+static void exit2(int _)
+{
+    exit(2);
+}
+
+static const Elf32_Sym *find_symbol(const void *elf, const char *name)
+{
+    const Elf32_Sym *symtab;
+    size_t symtab_n;
+    const char *strtab;
+    if (!find_symtab(elf, &symtab, &symtab_n, &strtab))
+        return NULL;
+
+    for (int i = 0; i < symtab_n; i++)
+    {
+        if (symtab[i].st_name != 0 && strcmp(strtab + symtab[i].st_name, name) == 0)
+            return &symtab[i];
+    }
+    return NULL;
+}
+
+// Returns a pointer to the contents of 'address' in the ELF file, or
+// NULL if it is not in a section with contents.
+static void *elf_address(void *elf, uint32_t address)
+{
+    const Elf32_Ehdr *ehdr = (Elf32_Ehdr *)elf;
+    const Elf32_Shdr *shdrs = (Elf32_Shdr *)(elf + ehdr->e_shoff);
+    for (int i = 0; i < ehdr->e_shnum; i++)
+    {
+        if (shdrs[i].sh_type != SHT_PROGBITS || !(shdrs[i].sh_flags & SHF_ALLOC))
+            continue;
+        if (shdrs[i].sh_addr <= address && address < shdrs[i].sh_addr + shdrs[i].sh_size)
+            return elf + shdrs[i].sh_offset + (address - shdrs[i].sh_addr);
+    }
+    return NULL;
+}
+
+static uint32_t read_u32(const void *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static void find_rom_variables(void)
+{
+    const Elf32_Sym *sym;
+    if ((sym = find_symbol(elf, "gTestRunnerN")))
+        rom_runner_n = elf_address(elf, sym->st_value);
+    if ((sym = find_symbol(elf, "gTestRunnerI")))
+        rom_runner_i = elf_address(elf, sym->st_value);
+    if ((sym = find_symbol(elf, "gTestRunnerArgv")))
+        rom_argv = elf_address(elf, sym->st_value);
+    if ((sym = find_symbol(elf, "gTestRunnerSchedule")))
+    {
+        rom_schedule = elf_address(elf, sym->st_value);
+        rom_schedule_size = sym->st_size;
+    }
+    if ((sym = find_symbol(elf, "gTestRunnerTrialShard")))
+        rom_trial_shard = elf_address(elf, sym->st_value);
+    if ((sym = find_symbol(elf, "gTestRunnerTrialShards")))
+        rom_trial_shards = elf_address(elf, sym->st_value);
+    if ((sym = find_symbol(elf, "gTestRunnerTraceRng")))
+        rom_trace_rng = elf_address(elf, sym->st_value);
+    if (!rom_runner_n || !rom_runner_i)
+    {
+        fprintf(stderr, "gTestRunnerN or gTestRunnerI not found\n");
+        exit(2);
+    }
+}
+
+static void build_test_table(void *elf)
+{
+    const Elf32_Sym *start_tests = find_symbol(elf, "__start_tests");
+    const Elf32_Sym *stop_tests = find_symbol(elf, "__stop_tests");
+    if (!start_tests || !stop_tests)
+        return;
+    const char *test = elf_address(elf, start_tests->st_value);
+    if (!test)
+        return;
+    const Elf32_Sym *battle_runner = find_symbol(elf, "gBattleTestRunner");
+    const Elf32_Sym *function_runner = find_symbol(elf, "gFunctionTestRunner");
+    const Elf32_Sym *assumptions_runner = find_symbol(elf, "gAssumptionsRunner");
+
+    size_t n = (stop_tests->st_value - start_tests->st_value) / TEST_SIZE;
+    if ((tests = calloc(n, sizeof(*tests))) == NULL)
+    {
+        perror("calloc tests failed");
+        exit(2);
+    }
+    for (ntests = 0; ntests < n; ntests++, test += TEST_SIZE)
+    {
+        const char *name = elf_address(elf, read_u32(test + TEST_NAME_OFFSET));
+        const char *filename = elf_address(elf, read_u32(test + TEST_FILENAME_OFFSET));
+        uint32_t runner = read_u32(test + TEST_RUNNER_OFFSET);
+        tests[ntests].name = name ? name : "";
+        tests[ntests].filename = filename ? filename : "";
+        if (battle_runner && runner == battle_runner->st_value)
+        {
+            const uint8_t *data = elf_address(elf, read_u32(test + TEST_DATA_OFFSET));
+            if (data && *data < ARRAY_COUNT(battle_test_kinds))
+                tests[ntests].kind = battle_test_kinds[*data];
+            else
+                tests[ntests].kind = "BATTLE_TEST";
+        }
+        else if (function_runner && runner == function_runner->st_value)
+        {
+            tests[ntests].kind = "TEST";
+        }
+        else if (assumptions_runner && runner == assumptions_runner->st_value)
+        {
+            tests[ntests].kind = "ASSUMPTIONS";
+        }
+        else
+        {
+            const struct Symbol *symbol = lookup_address(runner);
+            tests[ntests].kind = symbol ? symbol->name : "UNKNOWN";
+        }
+        tests[ntests].cost = -1;
+        tests[ntests].measured_cost = -1;
+    }
+}
+
+static int compare_test_keys(const void *a, const void *b)
+{
+    const struct Test *ta = *(const struct Test **)a, *tb = *(const struct Test **)b;
+    int c = strcmp(ta->filename, tb->filename);
+    return c != 0 ? c : strcmp(ta->name, tb->name);
+}
+
+// Reads lines of the form "<cost>\t<filename>\t<name>" and sets the
+// cost of the matching tests. Returns the number of matches.
+static size_t read_costs(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+
+    struct Test **sorted_tests = malloc(ntests * sizeof(*sorted_tests));
+    if (!sorted_tests)
+    {
+        perror("malloc sorted_tests failed");
+        exit(2);
+    }
+    for (size_t i = 0; i < ntests; i++)
+        sorted_tests[i] = &tests[i];
+    qsort(sorted_tests, ntests, sizeof(*sorted_tests), compare_test_keys);
+
+    size_t matches = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_size;
+    while ((line_size = getline(&line, &line_capacity, f)) != -1)
+    {
+        if (line_size > 0 && line[line_size - 1] == '\n')
+            line[line_size - 1] = '\0';
+        char *filename = strchr(line, '\t');
+        if (!filename)
+            continue;
+        *filename++ = '\0';
+        char *name = strchr(filename, '\t');
+        if (!name)
+            continue;
+        *name++ = '\0';
+
+        struct Test key = { .name = name, .filename = filename };
+        struct Test *key_ = &key;
+        struct Test **test = bsearch(&key_, sorted_tests, ntests, sizeof(*sorted_tests), compare_test_keys);
+        if (!test)
+            continue;
+        // Tests with the same name in the same file share a cost.
+        while (test > sorted_tests && compare_test_keys(test - 1, &key_) == 0)
+            test--;
+        for (; test < sorted_tests + ntests && compare_test_keys(test, &key_) == 0; test++)
+        {
+            char *end;
+            (*test)->cost = strtol(line, &end, 10);
+            if (*end == ',')
+                (*test)->trials = strtol(end + 1, NULL, 10);
+            matches++;
+        }
+    }
+
+    free(line);
+    free(sorted_tests);
+    fclose(f);
+    return matches;
+}
+
+static void write_costs(const char *path)
+{
+    char tmp_path[FILENAME_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "w");
+    if (!f)
+    {
+        perror("fopen costs failed");
+        return;
+    }
+    for (size_t i = 0; i < ntests; i++)
+    {
+        long cost = tests[i].measured_cost >= 0 ? tests[i].measured_cost : tests[i].cost;
+        if (cost >= 0 && tests[i].trials > 1)
+            fprintf(f, "%ld,%d\t%s\t%s\n", cost, tests[i].trials, tests[i].filename, tests[i].name);
+        else if (cost >= 0)
+            fprintf(f, "%ld\t%s\t%s\n", cost, tests[i].filename, tests[i].name);
+    }
+    if (fclose(f) != 0 || rename(tmp_path, path) == -1)
+        perror("write costs failed");
+}
+
+struct ProfileTotal
+{
+    const char *key;
+    size_t tests;
+    long cost;
+    long frames;
+    long vblanks;
+    long long cycles;
+};
+
+static int compare_profiled_tests(const void *a, const void *b)
+{
+    const struct Test *test_a = &tests[*(const size_t *)a];
+    const struct Test *test_b = &tests[*(const size_t *)b];
+    if (test_a->cycles != test_b->cycles)
+        return test_a->cycles < test_b->cycles ? 1 : -1;
+    int r = strcmp(test_a->filename, test_b->filename);
+    return r ? r : strcmp(test_a->name, test_b->name);
+}
+
+static int compare_profile_totals(const void *a, const void *b)
+{
+    const struct ProfileTotal *total_a = a;
+    const struct ProfileTotal *total_b = b;
+    if (total_a->cycles != total_b->cycles)
+        return total_a->cycles < total_b->cycles ? 1 : -1;
+    return strcmp(total_a->key, total_b->key);
+}
+
+// Adds 'test' to the total for 'key'. A linear search is fine because
+// there are only a few hundred files and a handful of kinds.
+static void add_profile_total(struct ProfileTotal **totals, size_t *totals_n, const char *key, const struct Test *test)
+{
+    struct ProfileTotal *total = NULL;
+    for (size_t i = *totals_n; i > 0; i--)
+    {
+        if (!strcmp((*totals)[i - 1].key, key))
+        {
+            total = &(*totals)[i - 1];
+            break;
+        }
+    }
+    if (!total)
+    {
+        if ((*totals = realloc(*totals, (*totals_n + 1) * sizeof(**totals))) == NULL)
+        {
+            perror("realloc totals failed");
+            exit(2);
+        }
+        total = &(*totals)[(*totals_n)++];
+        *total = (struct ProfileTotal) { .key = key };
+    }
+    total->tests++;
+    total->cost += test->measured_cost > 0 ? test->measured_cost : 0;
+    total->frames += test->frames;
+    total->vblanks += test->vblanks;
+    total->cycles += test->cycles;
+}
+
+static void fprint_profile_totals(FILE *f, const char *title, struct ProfileTotal *totals, size_t totals_n)
+{
+    qsort(totals, totals_n, sizeof(*totals), compare_profile_totals);
+    fprintf(f, "\n# %s\n# cycles\tframes\tvblanks\tms\ttests\tcycles/test\t%s\n", title, title);
+    for (size_t i = 0; i < totals_n; i++)
+    {
+        fprintf(f, "%lld\t%ld\t%ld\t%ld\t%zu\t%lld\t%s\n",
+                totals[i].cycles, totals[i].frames, totals[i].vblanks,
+                totals[i].cost, totals[i].tests,
+                totals[i].cycles / (long long)totals[i].tests, totals[i].key);
+    }
+}
+
+static void write_profile(const char *path)
+{
+    size_t *order;
+    size_t order_n = 0;
+    if ((order = malloc(ntests * sizeof(*order))) == NULL)
+    {
+        perror("malloc order failed");
+        exit(2);
+    }
+    for (size_t i = 0; i < ntests; i++)
+    {
+        if (tests[i].profiled)
+            order[order_n++] = i;
+    }
+    qsort(order, order_n, sizeof(*order), compare_profiled_tests);
+
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        free(order);
+        return;
+    }
+
+    struct ProfileTotal *files = NULL, *kinds = NULL;
+    size_t files_n = 0, kinds_n = 0;
+    fprintf(f, "# test\n# cycles\tframes\tvblanks\tms\tkind\tfile\ttest\n");
+    for (size_t i = 0; i < order_n; i++)
+    {
+        const struct Test *test = &tests[order[i]];
+        fprintf(f, "%lld\t%ld\t%ld\t%ld\t%s\t%s\t%s\n",
+                test->cycles, test->frames, test->vblanks,
+                test->measured_cost > 0 ? test->measured_cost : 0,
+                test->kind, test->filename, test->name);
+        add_profile_total(&files, &files_n, test->filename, test);
+        add_profile_total(&kinds, &kinds_n, test->kind, test);
+    }
+    fprint_profile_totals(f, "file", files, files_n);
+    fprint_profile_totals(f, "kind", kinds, kinds_n);
+
+    if (fclose(f) != 0)
+        perror(path);
+    free(files);
+    free(kinds);
+    free(order);
+}
+
+static bool prefix_match(const char *pattern, const char *string)
+{
+    return strncmp(pattern, string, strlen(pattern)) == 0;
+}
+
+static int compare_test_costs_desc(const void *a, const void *b)
+{
+    const struct Test *ta = &tests[*(const size_t *)a], *tb = &tests[*(const size_t *)b];
+    if (ta->schedule_cost != tb->schedule_cost)
+        return ta->schedule_cost < tb->schedule_cost ? 1 : -1;
+    return *(const size_t *)a < *(const size_t *)b ? -1 : 1;
+}
+
+// Returns the tests which should be run, sorted by descending cost, in
+// 'order'. Tests without a measured cost are assumed to cost the
+// average, or 1 if there are no measured costs. Assumptions are run by
+// every runner so they are not included.
+static size_t collect_tests(size_t **order, size_t *costs_n)
+{
+    *order = NULL;
+    *costs_n = 0;
+    if (!rom_schedule || !rom_argv)
+        return 0;
+
+    if ((*order = malloc(ntests * sizeof(**order))) == NULL)
+    {
+        perror("malloc order failed");
+        exit(2);
+    }
+    size_t norder = 0;
+    long total_cost = 0;
+    for (size_t i = 0; i < ntests && i < rom_schedule_size; i++)
+    {
+        if (strncmp(tests[i].name, "ASSUMPTIONS: ", strlen("ASSUMPTIONS: ")) == 0)
+            continue;
+        if (tests[i].skip)
+            continue;
+        if (!prefix_match(rom_argv, tests[i].name))
+            continue;
+        if (tests[i].cost >= 0)
+        {
+            total_cost += tests[i].cost;
+            (*costs_n)++;
+        }
+        (*order)[norder++] = i;
+    }
+    long default_cost = *costs_n > 0 ? total_cost / *costs_n : 1;
+    for (size_t i = 0; i < norder; i++)
+    {
+        struct Test *test = &tests[(*order)[i]];
+        test->schedule_cost = test->cost >= 0 ? test->cost : default_cost;
+        test->sharded = nrunners > 1
+                     && rom_trial_shard && rom_trial_shards
+                     && test->trials >= nrunners;
+    }
+    qsort(*order, norder, sizeof(**order), compare_test_costs_desc);
+    return norder;
+}
+
+// Assigns the longest tests first, each to the runner with the least
+// total cost so far (LPT), and patches the result into the ROM's
+// gTestRunnerSchedule.
+static void schedule_tests(void)
+{
+    size_t *order = NULL, costs_n;
+    size_t norder = collect_tests(&order, &costs_n);
+    if (costs_n == 0)
+    {
+        free(order);
+        return;
+    }
+
+    // Min heap of runners by total cost.
+    long runner_costs[MAX_PROCESSES] = {0};
+    uint8_t heap[MAX_PROCESSES];
+    for (int i = 0; i < nrunners; i++)
+        heap[i] = i;
+    for (size_t i = 0; i < norder; i++)
+    {
+        // Every runner runs its shard of the trials. Adding the same
+        // cost to every runner keeps the heap ordered.
+        if (tests[order[i]].sharded)
+        {
+            rom_schedule[order[i]] = TEST_RUNNER_SHARDED;
+            for (int j = 0; j < nrunners; j++)
+                runner_costs[j] += tests[order[i]].schedule_cost / nrunners;
+            continue;
+        }
+
+        int runner = heap[0];
+        rom_schedule[order[i]] = runner;
+        runner_costs[runner] += tests[order[i]].schedule_cost;
+
+        int j = 0;
+        while (2 * j + 1 < nrunners)
+        {
+            int child = 2 * j + 1;
+            if (child + 1 < nrunners && runner_costs[heap[child + 1]] < runner_costs[heap[child]])
+                child++;
+            if (runner_costs[heap[child]] >= runner_costs[runner])
+                break;
+            heap[j] = heap[child];
+            j = child;
+        }
+        heap[j] = runner;
+    }
+    free(order);
+}
+
+static long queued_cost(size_t test)
+{
+    if (tests[test].sharded)
+        return tests[test].schedule_cost / nrunners;
+    return tests[test].schedule_cost;
+}
+
+// Builds the queue for -w. Returns false if some tests could not be
+// dispatched through gTestRunnerSchedule.
+static bool init_queue(void)
+{
+    if (!rom_schedule || ntests > rom_schedule_size)
+    {
+        fprintf(stderr, "too many tests for -w, falling back to a static schedule\n");
+        return false;
+    }
+
+    size_t costs_n, *order;
+    size_t norder = collect_tests(&order, &costs_n);
+
+    // Sharded tests are queued once for each shard.
+    size_t nqueue = 0;
+    for (size_t i = 0; i < norder; i++)
+        nqueue += tests[order[i]].sharded ? nrunners : 1;
+    if ((queue = malloc(nqueue * sizeof(*queue))) == NULL && nqueue > 0)
+    {
+        perror("malloc queue failed");
+        exit(2);
+    }
+    for (size_t i = 0; i < norder; i++)
+    {
+        for (int j = 0; j < (tests[order[i]].sharded ? nrunners : 1); j++)
+            queue[queue_tail++] = order[i];
+    }
+    free(order);
+
+    for (size_t i = queue_head; i < queue_tail; i++)
+        queue_cost += queued_cost(queue[i]);
+    return true;
+}
+
+// Moves the next batch of tests from the queue to the runner. Batches
+// cost about 1/(2 * nrunners) of the remaining queue, so the early
+// batches amortize the cost of starting mgba-rom-test while the last
+// tests are handed out one at a time to whichever runner is idle.
+// gTestRunnerTrialShard applies to the whole ROM, so each shard of a
+// sharded test is a batch by itself.
+static bool next_batch(struct Runner *runner)
+{
+    if (queue_head == queue_tail)
+        return false;
+
+    if (tests[queue[queue_head]].sharded)
+    {
+        size_t test = queue[queue_head++];
+        if (runner->batch_capacity == 0)
+        {
+            runner->batch_capacity = 64;
+            if ((runner->batch = malloc(runner->batch_capacity * sizeof(*runner->batch))) == NULL)
+            {
+                perror("malloc batch failed");
+                exit(2);
+            }
+        }
+        runner->batch[0] = test;
+        runner->batch_size = 1;
+        runner->trial_shard = tests[test].shards_dispatched++;
+        queue_cost -= queued_cost(test);
+        return true;
+    }
+
+    long target_cost = queue_cost / (2 * nrunners);
+    long batch_cost = 0;
+    runner->batch_size = 0;
+    while (queue_head < queue_tail && !tests[queue[queue_head]].sharded
+        && (runner->batch_size == 0 || batch_cost < target_cost))
+    {
+        if (runner->batch_size == runner->batch_capacity)
+        {
+            runner->batch_capacity = runner->batch_capacity ? runner->batch_capacity * 2 : 64;
+            runner->batch = realloc(runner->batch, runner->batch_capacity * sizeof(*runner->batch));
+            if (!runner->batch)
+            {
+                perror("realloc batch failed");
+                exit(2);
+            }
+        }
+        size_t test = queue[queue_head++];
+        runner->batch[runner->batch_size++] = test;
+        batch_cost += tests[test].schedule_cost;
+        queue_cost -= tests[test].schedule_cost;
+    }
+    return true;
+}
+
+// Schedules only the runner's batch on runner 'i'.
+static void patch_batch(int i)
+{
+    memset(rom_schedule, (i + 1) % nrunners, ntests);
+    for (size_t j = 0; j < runners[i].batch_size; j++)
+    {
+        size_t test = runners[i].batch[j];
+        rom_schedule[test] = tests[test].sharded ? TEST_RUNNER_SHARDED : i;
+    }
+    if (rom_trial_shard)
+        *rom_trial_shard = runners[i].trial_shard;
+}
+
+// Objects whose changes affect every test. Hydra does not follow
+// references through them, otherwise every test would depend on
+// everything the runner depends on.
+static const char *const runner_objects[] =
+{
+    "/test/test_runner.o",
+    "/test/test_runner_args.o",
+};
+
+static bool is_runner_object(const char *path)
+{
+    size_t path_n = strlen(path);
+    for (int i = 0; i < ARRAY_COUNT(runner_objects); i++)
+    {
+        size_t suffix_n = strlen(runner_objects[i]);
+        if (path_n >= suffix_n && strcmp(path + path_n - suffix_n, runner_objects[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void collect_object(const char *path, const struct stat *st)
+{
+    if (nobjects == objects_capacity)
+    {
+        objects_capacity = objects_capacity ? objects_capacity * 2 : 1024;
+        if ((objects = realloc(objects, objects_capacity * sizeof(*objects))) == NULL)
+        {
+            perror("realloc objects failed");
+            exit(2);
+        }
+    }
+    struct Object *object = &objects[nobjects++];
+    memset(object, 0, sizeof(*object));
+    if ((object->path = strdup(path)) == NULL)
+    {
+        perror("strdup path failed");
+        exit(2);
+    }
+    object->size = st->st_size;
+}
+
+static void collect_objects(const char *dir_path)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir)
+    {
+        perror("opendir failed");
+        exit(2);
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+        char path[FILENAME_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        struct stat st;
+        if (lstat(path, &st) == -1)
+            continue;
+        size_t path_n = strlen(path);
+        if (S_ISDIR(st.st_mode))
+            collect_objects(path);
+        else if (S_ISREG(st.st_mode) && path_n >= 2 && strcmp(path + path_n - 2, ".o") == 0)
+            collect_object(path, &st);
+    }
+    closedir(dir);
+}
+
+static int compare_object_paths(const void *a, const void *b)
+{
+    return strcmp(((const struct Object *)a)->path, ((const struct Object *)b)->path);
+}
+
+static struct Object *find_object(const char *path)
+{
+    struct Object key = { .path = (char *)path };
+    return bsearch(&key, objects, nobjects, sizeof(*objects), compare_object_paths);
+}
+
+struct ObjectSymbol
+{
+    const char *name;
+    size_t object;
+};
+
+static int compare_object_symbols(const void *a, const void *b)
+{
+    return strcmp(((const struct ObjectSymbol *)a)->name, ((const struct ObjectSymbol *)b)->name);
+}
+
+static void push_object_symbol(struct ObjectSymbol **symbols, size_t *symbols_n, size_t *symbols_c, const char *name, size_t object)
+{
+    if (*symbols_n == *symbols_c)
+    {
+        *symbols_c = *symbols_c ? *symbols_c * 2 : 4096;
+        if ((*symbols = realloc(*symbols, *symbols_c * sizeof(**symbols))) == NULL)
+        {
+            perror("realloc symbols failed");
+            exit(2);
+        }
+    }
+    (*symbols)[(*symbols_n)++] = (struct ObjectSymbol) { name, object };
+}
+
+static void push_referrer(struct Object *object, size_t referrer)
+{
+    if (object->referrers_n == object->referrers_c)
+    {
+        object->referrers_c = object->referrers_c ? object->referrers_c * 2 : 8;
+        if ((object->referrers = realloc(object->referrers, object->referrers_c * sizeof(*object->referrers))) == NULL)
+        {
+            perror("realloc referrers failed");
+            exit(2);
+        }
+    }
+    object->referrers[object->referrers_n++] = referrer;
+}
+
+// FNV-1a.
+static uint64_t hash_bytes(const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+// Reads the hash of each object from the last run in which every test
+// passed, and marks the objects which have changed since. Returns false
+// if there is no such run.
+static bool read_object_hashes(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+
+    for (size_t i = 0; i < nobjects; i++)
+        objects[i].changed = true;
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_size;
+    while ((line_size = getline(&line, &line_capacity, f)) != -1)
+    {
+        if (line_size > 0 && line[line_size - 1] == '\n')
+            line[line_size - 1] = '\0';
+        char *object_path = strchr(line, '\t');
+        if (!object_path)
+            continue;
+        *object_path++ = '\0';
+        struct Object *object = find_object(object_path);
+        if (object && object->hash == strtoull(line, NULL, 16))
+            object->changed = false;
+    }
+
+    free(line);
+    fclose(f);
+    return true;
+}
+
+static void write_object_hashes(const char *path)
+{
+    char tmp_path[FILENAME_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "w");
+    if (!f)
+    {
+        perror("fopen object hashes failed");
+        return;
+    }
+    for (size_t i = 0; i < nobjects; i++)
+        fprintf(f, "%016llx\t%s\n", (unsigned long long)objects[i].hash, objects[i].path);
+    if (fclose(f) != 0 || rename(tmp_path, path) == -1)
+        perror("write object hashes failed");
+}
+
+// Skips the tests in files whose objects do not transitively reference
+// (through undefined symbols) any object which has changed since the
+// last run in which every test passed.
+static void select_incremental_tests(const char *obj_dir)
+{
+    collect_objects(obj_dir);
+    qsort(objects, nobjects, sizeof(*objects), compare_object_paths);
+
+    struct ObjectSymbol *definitions = NULL, *references = NULL;
+    size_t definitions_n = 0, definitions_c = 0, references_n = 0, references_c = 0;
+    void **mappings = calloc(nobjects, sizeof(*mappings));
+    if (!mappings)
+    {
+        perror("calloc mappings failed");
+        exit(2);
+    }
+    for (size_t i = 0; i < nobjects; i++)
+    {
+        int fd;
+        if ((fd = open(objects[i].path, O_RDONLY)) == -1)
+        {
+            perror("open object failed");
+            exit(2);
+        }
+        void *object = mmap(NULL, objects[i].size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (object == MAP_FAILED)
+        {
+            perror("mmap object failed");
+            exit(2);
+        }
+        mappings[i] = object;
+        objects[i].hash = hash_bytes(object, objects[i].size);
+
+        const Elf32_Sym *symtab;
+        size_t symtab_n;
+        const char *strtab;
+        if (objects[i].size < sizeof(Elf32_Ehdr) || memcmp(object, ELFMAG, 4) != 0)
+            continue;
+        if (!find_symtab(object, &symtab, &symtab_n, &strtab))
+            continue;
+        for (size_t j = 0; j < symtab_n; j++)
+        {
+            int bind = ELF32_ST_BIND(symtab[j].st_info);
+            if (symtab[j].st_name == 0 || (bind != STB_GLOBAL && bind != STB_WEAK))
+                continue;
+            if (symtab[j].st_shndx == SHN_UNDEF)
+                push_object_symbol(&references, &references_n, &references_c, strtab + symtab[j].st_name, i);
+            else
+                push_object_symbol(&definitions, &definitions_n, &definitions_c, strtab + symtab[j].st_name, i);
+        }
+    }
+
+    qsort(definitions, definitions_n, sizeof(*definitions), compare_object_symbols);
+    for (size_t i = 0; i < references_n; i++)
+    {
+        struct ObjectSymbol *definition = bsearch(&references[i], definitions, definitions_n, sizeof(*definitions), compare_object_symbols);
+        if (definition && definition->object != references[i].object)
+            push_referrer(&objects[definition->object], references[i].object);
+    }
+
+    for (size_t i = 0; i < nobjects; i++)
+        munmap(mappings[i], objects[i].size);
+    free(mappings);
+    free(definitions);
+    free(references);
+
+    if (!read_object_hashes(object_hashes_path))
+        return;
+
+    // Walk from the changed objects to the objects which reference them.
+    size_t *stack = malloc(nobjects * sizeof(*stack));
+    size_t stack_n = 0;
+    if (!stack)
+    {
+        perror("malloc stack failed");
+        exit(2);
+    }
+    for (size_t i = 0; i < nobjects; i++)
+    {
+        if (objects[i].changed)
+        {
+            objects[i].affected = true;
+            stack[stack_n++] = i;
+        }
+    }
+    while (stack_n > 0)
+    {
+        struct Object *object = &objects[stack[--stack_n]];
+        if (!object->changed && is_runner_object(object->path))
+            continue;
+        for (size_t i = 0; i < object->referrers_n; i++)
+        {
+            struct Object *referrer = &objects[object->referrers[i]];
+            if (!referrer->affected)
+            {
+                referrer->affected = true;
+                stack[stack_n++] = object->referrers[i];
+            }
+        }
+    }
+    free(stack);
+
+    bool runner_changed = false;
+    for (size_t i = 0; i < nobjects; i++)
+        runner_changed |= objects[i].changed && is_runner_object(objects[i].path);
+    if (runner_changed)
+        return;
+
+    for (size_t i = 0; i < ntests && i < rom_schedule_size; i++)
+    {
+        char object_path[FILENAME_MAX];
+        size_t filename_n = strlen(tests[i].filename);
+        if (filename_n < 2 || strcmp(tests[i].filename + filename_n - 2, ".c") != 0)
+            continue;
+        snprintf(object_path, sizeof(object_path), "%s/%.*s.o", obj_dir, (int)(filename_n - 2), tests[i].filename);
+        struct Object *object = find_object(object_path);
+        if (object && !object->affected)
+        {
+            tests[i].skip = true;
+            rom_schedule[i] = TEST_RUNNER_SKIP;
+        }
+    }
+}
+
+// Waits for the runner's mgba-rom-test to exit. With -w any tests in
+// its batch which it never started are put back on the queue.
+static void reap_runner(struct Runner *runner)
+{
+    int wstatus;
+    if (waitpid(runner->pid, &wstatus, 0) == -1)
+    {
+        perror("waitpid runner failed");
+        exit(2);
+    }
+    if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) > runner->exit_code)
+        runner->exit_code = WEXITSTATUS(wstatus);
+#ifdef __APPLE__
+    // objcopy has converted the ROM to a binary, so it must be written
+    // again from scratch.
+    if (unlink(runner->rom_path) == -1)
+        perror("unlink rom_path failed");
+    runner->rom_written = false;
+#endif
+    if (runner->output_buffer_size > 0)
+    {
+        fwrite(runner->output_buffer, 1, runner->output_buffer_size, stdout);
+        runner->output_buffer_size = 0;
+    }
+    runner->input_buffer_size = 0;
+
+    // If none of the batch started then mgba-rom-test is probably
+    // failing to start at all, so do not retry it.
+    bool progress = false;
+    for (size_t i = 0; i < runner->batch_size; i++)
+        progress |= tests[runner->batch[i]].started;
+    for (size_t i = runner->batch_size; progress && i-- > 0; )
+    {
+        size_t test = runner->batch[i];
+        if (!tests[test].started && !tests[test].sharded)
+        {
+            queue[--queue_head] = test;
+            queue_cost += tests[test].schedule_cost;
+        }
+    }
+    runner->batch_size = 0;
+}
+
+static void start_runner(int i)
+{
+    if (!runners[i].rom_path[0])
+        sprintf(runners[i].rom_path, "/tmp/mgba-rom-test-hydra-%05d-%02d", parent_pid, i);
+
+    int pipefds[2];
+    if (pipe(pipefds) == -1)
+    {
+        perror("pipe failed");
+        exit(2);
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork mgba-rom-test failed");
+        exit(2);
+    } else if (pid == 0) {
+        #ifndef __APPLE__
+        if (prctl(PR_SET_PDEATHSIG, SIGTERM) == -1)
+        {
+            perror("prctl failed");
+            _exit(2);
+        }
+        #endif
+        if (getppid() != parent_pid) // Parent died.
+        {
+            _exit(2);
+        }
+        if (close(pipefds[0]) == -1)
+        {
+            perror("close pipefds[0] failed");
+            _exit(2);
+        }
+        if (dup2(pipefds[1], STDOUT_FILENO) == -1)
+        {
+            perror("dup2 stdout failed");
+            _exit(2);
+        }
+        if (close(pipefds[1]) == -1)
+        {
+            perror("close pipefds[1] failed");
+            _exit(2);
+        }
+        const char *rom_path = runners[i].rom_path;
+        int tmpfd;
+        if (runners[i].rom_written)
+        {
+            // This runner's previous mgba-rom-test has exited, so its ROM
+            // can be reused and only the schedule needs to be updated.
+            if ((tmpfd = open(rom_path, O_WRONLY)) == -1)
+            {
+                perror("open tmpfd failed");
+                _exit(2);
+            }
+            patch_batch(i);
+            if (pwrite(tmpfd, rom_schedule, ntests, rom_schedule - (uint8_t *)elf) == -1
+             || (rom_trial_shard && pwrite(tmpfd, rom_trial_shard, 1, rom_trial_shard - (uint8_t *)elf) == -1))
+            {
+                perror("pwrite tmpfd failed");
+                _exit(2);
+            }
+        }
+        else
+        {
+            if ((tmpfd = open(rom_path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) == -1)
+            {
+                perror("open tmpfd failed");
+                _exit(2);
+            }
+            *rom_runner_n = nrunners;
+            *rom_runner_i = i;
+            if (rom_trial_shard && rom_trial_shards)
+            {
+                *rom_trial_shard = runners[i].trial_shard;
+                *rom_trial_shards = nrunners;
+            }
+            if (dynamic_dispatch)
+                patch_batch(i);
+            if ((write(tmpfd, elf, elf_size)) == -1)
+            {
+                perror("write tmpfd failed");
+                _exit(2);
             }
         }
-        else
+        if (close(tmpfd) == -1)
         {
-            fwrite(sol, 1, eol - sol, stdout);
+            perror("close tmpfd failed");
+            _exit(2);
         }
-        sol += n;
-        consumed += n;
-        remaining -= n;
-    }
-
-    memcpy(runner->input_buffer, sol, remaining);
-    runner->input_buffer_size -= consumed;
-
-    if (runner->input_buffer_size == runner->input_buffer_capacity)
-    {
-        runner->input_buffer_capacity *= 2;
-        runner->input_buffer = realloc(runner->input_buffer, runner->input_buffer_capacity);
-        if (!runner->input_buffer)
+#ifdef __APPLE__
+        pid_t objcopypid = fork();
+        if (objcopypid == -1)
         {
-            perror("realloc input_buffer failed");
-            exit(2);
+            perror("fork objcopy failed");
+            _exit(2);
         }
-    }
-}
-
-static void unlink_roms(void)
-{
-    for (int i = 0; i < nrunners; i++)
-    {
-        if (runners[i].rom_path[0])
+        else if (objcopypid == 0)
         {
-            if (unlink(runners[i].rom_path) == -1)
+            if (execlp(objcopy, objcopy, "-O", "binary", rom_path, rom_path, NULL) == -1)
             {
-                int fd;
-                if ((fd = open(runners[i].rom_path, O_RDONLY)) != -1)
-                    perror("unlink rom_path failed");
+                perror("execlp objcopy failed");
+                _exit(2);
             }
         }
+        else
+        {
+            int wstatus;
+            if (waitpid(objcopypid, &wstatus, 0) == -1)
+            {
+                perror("waitpid objcopy failed");
+                _exit(2);
+            }
+            if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+            {
+                fprintf(stderr, "objcopy exited with an error\n");
+                _exit(2);
+            }
+        }
+#endif
+        // stdbuf is required because otherwise mgba never flushes
+        // stdout.
+        if (execlp("stdbuf", "stdbuf", "-oL", mgba_rom_test, "-l15", "-ClogLevel.gba.dma=16", "-Rr0", rom_path, NULL) == -1)
+        {
+            perror("execl stdbuf mgba-rom-test failed");
+            _exit(2);
+        }
+    } else {
+        runners[i].pid = pid;
+        runners[i].test_index = -1;
+        set_string(&runners[i].test_name, &runners[i].test_name_capacity, "WAITING...");
+        runners[i].rom_written = true;
+        runners[i].outfd = pipefds[0];
+        if (close(pipefds[1]) == -1)
+        {
+            perror("close pipefds[1] failed");
+            exit(2);
+        }
     }
 }
 
-static void exit2(int _)
-{
-    exit(2);
-}
-
-static int compare_addresses(const void *a, const void *b)
-{
-    const struct Symbol *sa = a, *sb = b;
-    if (sa->address < sb->address)
-        return -1;
-    else if (sa->address == sb->address)
-        return 0;
-    else
-        return 1;
-}
-
-static void build_symbol_table(void *elf)
+int main(int argc, char *argv[])
 {
-    if (memcmp(elf, ELFMAG, 4) != 0)
-        goto error;
-
-    size_t symbol_table_symbols_c = 1024;
-    symbol_table.symbols = malloc(symbol_table_symbols_c * sizeof(*symbol_table.symbols));
-    if (symbol_table.symbols == NULL)
-        goto error;
-
-    const Elf32_Ehdr *ehdr = (Elf32_Ehdr *)elf;
-    const Elf32_Shdr *shdrs = (Elf32_Shdr *)(elf + ehdr->e_shoff);
-
-    if (ehdr->e_shstrndx == SHN_UNDEF)
-        goto error;
-    const Elf32_Shdr *shdr_shstr = &shdrs[ehdr->e_shstrndx];
-    const char *shstr = (const char *)(elf + shdr_shstr->sh_offset);
-    const Elf32_Shdr *shdr_symtab = NULL;
-    const Elf32_Shdr *shdr_strtab = NULL;
-    for (int i = 0; i < ehdr->e_shnum; i++)
-    {
-        const char *sh_name = shstr + shdrs[i].sh_name;
-        if (strcmp(sh_name, ".symtab") == 0)
-            shdr_symtab = &shdrs[i];
-        else if (strcmp(sh_name, ".strtab") == 0)
-            shdr_strtab = &shdrs[i];
-    }
-    if (!shdr_symtab)
-        goto error;
-    if (!shdr_strtab)
-        goto error;
-
-    const Elf32_Sym *symtab = (Elf32_Sym *)(elf + shdr_symtab->sh_offset);
-    const char *strtab = (const char *)(elf + shdr_strtab->sh_offset);
-    for (int i = 0; i < shdr_symtab->sh_size / shdr_symtab->sh_entsize; i++)
+    const char *costs_path = NULL;
+    const char *obj_dir = NULL;
+    const char *profile_path = NULL;
+    const char *json_path = NULL;
+    const char *junit_path = NULL;
+    const char *rng_trace_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "+c:g:i:j:p:wx:")) != -1)
     {
-        if (symtab[i].st_name == 0) continue;
-        if (symtab[i].st_shndx > ehdr->e_shnum) continue;
-        if (symtab[i].st_value < 0x2000000 || symtab[i].st_size == 0) continue;
-        struct Symbol symbol =
-        {
-            .name = strtab + symtab[i].st_name,
-            .address = symtab[i].st_value,
-            .size = symtab[i].st_size,
-        };
-        if (symbol_table.symbols_n == symbol_table_symbols_c)
+        switch (opt)
         {
-            symbol_table_symbols_c *= 2;
-            void *symbols = realloc(symbol_table.symbols, symbol_table_symbols_c * sizeof(*symbol_table.symbols));
-            if (symbols == NULL)
-                goto error;
-            symbol_table.symbols = symbols;
+        case 'c':
+            costs_path = optarg;
+            break;
+        case 'g':
+            rng_trace_path = optarg;
+            break;
+        case 'i':
+            obj_dir = optarg;
+            break;
+        case 'j':
+            json_path = optarg;
+            break;
+        case 'p':
+            profile_path = optarg;
+            break;
+        case 'x':
+            junit_path = optarg;
+            break;
+        case 'w':
+            dynamic_dispatch = true;
+            break;
+        default:
+            exit(2);
         }
-        symbol_table.symbols[symbol_table.symbols_n++] = symbol;
     }
 
-    qsort(symbol_table.symbols, symbol_table.symbols_n, sizeof(*symbol_table.symbols), compare_addresses);
-    return;
-
-error:
-    free(symbol_table.symbols);
-    symbol_table.symbols = NULL;
-    symbol_table.symbols_n = 0;
-}
-
-int main(int argc, char *argv[])
-{
-    if (argc < 4)
+    if (argc - optind < 3)
     {
-        fprintf(stderr, "usage %s mgba-rom-test objcopy rom\n", argv[0]);
+        fprintf(stderr, "usage %s [-c costs] [-g rng_trace] [-i obj_dir] [-j json] [-p profile] [-w] [-x junit] mgba-rom-test objcopy rom\n", argv[0]);
         exit(2);
     }
+    mgba_rom_test = argv[optind + 0];
+    objcopy = argv[optind + 1];
+    const char *rom = argv[optind + 2];
 
     bool tty = isatty(STDOUT_FILENO);
     if (!tty)
@@ -453,7 +2281,7 @@ int main(int argc, char *argv[])
     }
 
     int elffd;
-    if ((elffd = open(argv[3], O_RDONLY)) == -1)
+    if ((elffd = open(rom, O_RDONLY)) == -1)
     {
         perror("open elffd failed");
         exit(2);
@@ -466,14 +2294,16 @@ int main(int argc, char *argv[])
         exit(2);
     }
 
-    void *elf;
-    if ((elf = mmap(NULL, elfst.st_size, PROT_READ, MAP_PRIVATE, elffd, 0)) == MAP_FAILED)
+    elf_size = elfst.st_size;
+    // The schedule is patched into this private (copy-on-write) mapping.
+    if ((elf = mmap(NULL, elfst.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, elffd, 0)) == MAP_FAILED)
     {
         perror("mmap elffd failed");
         exit(2);
     }
 
-    build_symbol_table(elf);
+    find_rom_variables();
+    build_test_table(elf);
 
     nrunners = 1;
     const char *makeflags = getenv("MAKEFLAGS");
@@ -507,13 +2337,49 @@ int main(int argc, char *argv[])
         perror("calloc runners failed");
         exit(2);
     }
+    if (costs_path)
+        read_costs(costs_path);
+    capture_output = json_path || junit_path;
+    if (json_path && (json_file = fopen(json_path, "w")) == NULL)
+    {
+        perror(json_path);
+        exit(2);
+    }
+    if (rng_trace_path)
+    {
+        if (!rom_trace_rng)
+        {
+            fprintf(stderr, "gTestRunnerTraceRng not found\n");
+            exit(2);
+        }
+        if ((rng_trace_file = fopen(rng_trace_path, "w")) == NULL)
+        {
+            perror(rng_trace_path);
+            exit(2);
+        }
+        fprintf(rng_trace_file, "# draw\n# test\ttag\tlo\thi\tvalue\tsource\tscript\tcaller\n");
+        fflush(rng_trace_file);
+        *rom_trace_rng = true;
+    }
+    if (obj_dir)
+    {
+        snprintf(object_hashes_path, sizeof(object_hashes_path), "%s/test_object_hashes.tsv", obj_dir);
+        select_incremental_tests(obj_dir);
+    }
+    if (dynamic_dispatch && (nrunners == 1 || !init_queue()))
+        dynamic_dispatch = false;
+    if (!dynamic_dispatch && nrunners > 1)
+        schedule_tests();
     for (int i = 0; i < nrunners; i++)
     {
         runners[i].input_buffer_capacity = 4096;
         runners[i].input_buffer = malloc(runners[i].input_buffer_capacity);
         runners[i].output_buffer_capacity = 4096;
         runners[i].output_buffer = malloc(runners[i].output_buffer_capacity);
-        strcpy(runners[i].test_name, "WAITING...");
+        set_string(&runners[i].test_name, &runners[i].test_name_capacity, "WAITING...");
+        set_string(&runners[i].filename_line, &runners[i].filename_line_capacity, "");
+        runners[i].test_index = -1;
+        runners[i].trial_shard = i;
         if (tty)
             fprintf(stdout, "[%0*d] %s\n", runners_digits, i, runners[i].test_name);
     }
@@ -523,141 +2389,17 @@ int main(int argc, char *argv[])
     signal(SIGTERM, exit2);
 
     // Start test runners.
-    pid_t parent_pid = getpid();
+    parent_pid = getpid();
     for (int i = 0; i < nrunners; i++)
     {
-        int pipefds[2];
-        if (pipe(pipefds) == -1)
-        {
-            perror("pipe failed");
-            exit(2);
-        }
-        pid_t pid = fork();
-        if (pid == -1) {
-            perror("fork mgba-rom-test failed");
-            exit(2);
-        } else if (pid == 0) {
-            #ifndef __APPLE__
-            if (prctl(PR_SET_PDEATHSIG, SIGTERM) == -1)
-            {
-                perror("prctl failed");
-                _exit(2);
-            }
-            #endif
-            if (getppid() != parent_pid) // Parent died.
-            {
-                _exit(2);
-            }
-            if (close(pipefds[0]) == -1)
-            {
-                perror("close pipefds[0] failed");
-                _exit(2);
-            }
-            if (dup2(pipefds[1], STDOUT_FILENO) == -1)
-            {
-                perror("dup2 stdout failed");
-                _exit(2);
-            }
-            if (close(pipefds[1]) == -1)
-            {
-                perror("close pipefds[1] failed");
-                _exit(2);
-            }
-            char rom_path[FILENAME_MAX];
-            sprintf(rom_path, "/tmp/mgba-rom-test-hydra-%05d", getpid());
-            int tmpfd;
-            if ((tmpfd = open(rom_path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) == -1)
-            {
-                perror("open tmpfd failed");
-                _exit(2);
-            }
-            if ((write(tmpfd, elf, elfst.st_size)) == -1)
-            {
-                perror("write tmpfd failed");
-                _exit(2);
-            }
-            pid_t patchelfpid = fork();
-            if (patchelfpid == -1)
-            {
-                perror("fork patchelf failed");
-                _exit(2);
-            }
-            else if (patchelfpid == 0)
-            {
-                char n_arg[5], i_arg[5];
-                snprintf(n_arg, sizeof(n_arg), "\\x%02x", nrunners);
-                snprintf(i_arg, sizeof(i_arg), "\\x%02x", i);
-                if (execlp("tools/patchelf/patchelf", "tools/patchelf/patchelf", rom_path, "gTestRunnerN", n_arg, "gTestRunnerI", i_arg, NULL) == -1)
-                {
-                    perror("execlp patchelf failed");
-                    _exit(2);
-                }
-            }
-            else
-            {
-                int wstatus;
-                if (waitpid(patchelfpid, &wstatus, 0) == -1)
-                {
-                    perror("waitpid patchelfpid failed");
-                    _exit(2);
-                }
-                if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
-                {
-                    fprintf(stderr, "patchelf exited with an error\n");
-                    _exit(2);
-                }
-            }
-#ifdef __APPLE__
-            pid_t objcopypid = fork();
-            if (objcopypid == -1)
-            {
-                perror("fork objcopy failed");
-                _exit(2);
-            }
-            else if (objcopypid == 0)
-            {
-                if (execlp(argv[2], argv[2], "-O", "binary", rom_path, rom_path, NULL) == -1)
-                {
-                    perror("execlp objcopy failed");
-                    _exit(2);
-                }
-            }
-            else
-            {
-                int wstatus;
-                if (waitpid(objcopypid, &wstatus, 0) == -1)
-                {
-                    perror("waitpid objcopy failed");
-                    _exit(2);
-                }
-                if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
-                {
-                    fprintf(stderr, "objcopy exited with an error\n");
-                    _exit(2);
-                }
-            }
-#endif
-            // stdbuf is required because otherwise mgba never flushes
-            // stdout.
-            if (execlp("stdbuf", "stdbuf", "-oL", argv[1], "-l15", "-ClogLevel.gba.dma=16", "-Rr0", rom_path, NULL) == -1)
-            {
-                perror("execl stdbuf mgba-rom-test failed");
-                _exit(2);
-            }
-        } else {
-            runners[i].pid = pid;
-            sprintf(runners[i].rom_path, "/tmp/mgba-rom-test-hydra-%05d", runners[i].pid);
-            runners[i].outfd = pipefds[0];
-            if (close(pipefds[1]) == -1)
-            {
-                perror("close pipefds[1] failed");
-                exit(2);
-            }
-        }
+        if (dynamic_dispatch && !next_batch(&runners[i]))
+            runners[i].outfd = -1;
+        else
+            start_runner(i);
     }
 
     // Process test runner output.
-    int openfds = nrunners;
+    int openfds = 0;
     struct pollfd *pollfds = calloc(nrunners, sizeof(*pollfds));
     if (!pollfds)
     {
@@ -668,6 +2410,8 @@ int main(int argc, char *argv[])
     {
         pollfds[i].fd = runners[i].outfd;
         pollfds[i].events = POLLIN;
+        if (runners[i].outfd >= 0)
+            openfds++;
     }
     while (openfds > 0)
     {
@@ -716,7 +2460,16 @@ int main(int argc, char *argv[])
                     exit(2);
                 }
                 runners[i].outfd = pollfds[i].fd = -pollfds[i].fd;
-                openfds--;
+                reap_runner(&runners[i]);
+                if (dynamic_dispatch && next_batch(&runners[i]))
+                {
+                    start_runner(i);
+                    pollfds[i].fd = runners[i].outfd;
+                }
+                else
+                {
+                    openfds--;
+                }
             }
         }
 
@@ -732,6 +2485,27 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Sharded tests whose runners exited before every shard reported
+    // fail, because their trials cannot be checked.
+    for (size_t i = 0; i < ntests; i++)
+    {
+        struct Test *test = &tests[i];
+        if (!test->sharded || test->shards_reported == 0 || test->shards_reported == nrunners)
+            continue;
+        struct Runner *runner = &runners[0];
+        set_string(&runner->test_name, &runner->test_name_capacity, "%s", test->name);
+        set_string(&runner->filename_line, &runner->filename_line_capacity, "%s", test->filename);
+        runner->output_buffer_size = 0;
+        char result[64];
+        snprintf(result, sizeof(result), "MISSING_SHARDS (%d/%d)", test->shards_reported, nrunners);
+        fprintf(stdout, "[%0*d] %s: \e[31m%s\e[0m\n", runners_digits, 0, test->name, result);
+        add_test_result(0, runner, 'F', result, strlen(result), test->shard_cost);
+        runner->fails++;
+        runner->results++;
+        if (runner->exit_code == 0)
+            runner->exit_code = 1;
+    }
+
     // Reap test runners and collate exit codes.
     int exit_code = 0;
     int passes = 0;
@@ -742,61 +2516,45 @@ int main(int argc, char *argv[])
     int fails = 0;
     int results = 0;
 
-    char failed_TestNames[MAX_SUMMARY_TESTS_TO_LIST * MAX_PROCESSES][MAX_TEST_LIST_BUFFER_LENGTH];
-    char failed_TestFilenameLine[MAX_SUMMARY_TESTS_TO_LIST * MAX_PROCESSES][MAX_TEST_LIST_BUFFER_LENGTH];
-
-    char knownFailingPassed_TestNames[MAX_SUMMARY_TESTS_TO_LIST * MAX_PROCESSES][MAX_TEST_LIST_BUFFER_LENGTH];
-    char knownFailingPassed_FilenameLine[MAX_SUMMARY_TESTS_TO_LIST * MAX_PROCESSES][MAX_TEST_LIST_BUFFER_LENGTH];
-
-    char assumeFailed_TestNames[MAX_SUMMARY_TESTS_TO_LIST * MAX_PROCESSES][MAX_TEST_LIST_BUFFER_LENGTH];
-    char assumeFailed_FilenameLine[MAX_SUMMARY_TESTS_TO_LIST * MAX_PROCESSES][MAX_TEST_LIST_BUFFER_LENGTH];
-
     for (int i = 0; i < nrunners; i++)
     {
-        int wstatus;
-        if (waitpid(runners[i].pid, &wstatus, 0) == -1)
-        {
-            perror("waitpid runners[i] failed");
-            exit(2);
-        }
-        if (runners[i].output_buffer_size > 0)
-            fwrite(runners[i].output_buffer, 1, runners[i].output_buffer_size, stdout);
-        if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) > exit_code)
-            exit_code = WEXITSTATUS(wstatus);
+        if (runners[i].exit_code > exit_code)
+            exit_code = runners[i].exit_code;
         passes += runners[i].passes;
         knownFails += runners[i].knownFails;
-        for (int j = 0; j < runners[i].knownFailsPassing; j++)
-        {
-            if (j < MAX_SUMMARY_TESTS_TO_LIST)
-            {
-                strcpy(knownFailingPassed_TestNames[knownFailsPassing], runners[i].knownFailingPassed_TestNames[j]);
-                strcpy(knownFailingPassed_FilenameLine[knownFailsPassing], runners[i].knownFailingPassed_FilenameLine[j]);
-            }
-            knownFailsPassing++;
-        }
+        knownFailsPassing += runners[i].knownFailsPassing;
         todos += runners[i].todos;
-        for (int j = 0; j < runners[i].assumptionFails; j++)
-        {
-            if (j < MAX_SUMMARY_TESTS_TO_LIST)
-            {
-                strcpy(assumeFailed_TestNames[assumptionFails], runners[i].assumeFailed_TestNames[j]);
-                strcpy(assumeFailed_FilenameLine[assumptionFails], runners[i].assumeFailed_FilenameLine[j]);
-            }
-            assumptionFails++;
-        }
-        for (int j = 0; j < runners[i].fails; j++)
-        {
-            if (j < MAX_SUMMARY_TESTS_TO_LIST)
-            {
-                strcpy(failed_TestNames[fails], runners[i].failed_TestNames[j]);
-                strcpy(failed_TestFilenameLine[fails], runners[i].failed_TestFilenameLine[j]);
-            }
-            fails++;
-        }
+        assumptionFails += runners[i].assumptionFails;
+        fails += runners[i].fails;
         results += runners[i].results;
     }
 
-    if (results == 0)
+    if (costs_path)
+        write_costs(costs_path);
+    if (profile_path)
+        write_profile(profile_path);
+    if (json_file && fclose(json_file) != 0)
+        perror(json_path);
+    if (rng_trace_file)
+    {
+        write_rng_summary();
+        if (fclose(rng_trace_file) != 0)
+            perror(rng_trace_path);
+    }
+    if (junit_path)
+        write_junit(junit_path);
+    if (obj_dir && exit_code == 0 && rom_argv && rom_argv[0] == '\0')
+        write_object_hashes(object_hashes_path);
+
+    int skips = 0;
+    for (size_t i = 0; i < ntests; i++)
+        skips += tests[i].skip;
+
+    if (results == 0 && skips > 0)
+    {
+        fprintf(stdout, "\nNo tests depend on anything which changed since the last passing run (%d skipped).\n", skips);
+    }
+    else if (results == 0)
     {
         fprintf(stdout, "\nNo tests found.\n");
     }
@@ -805,49 +2563,19 @@ int main(int argc, char *argv[])
         if (fails > 0)
         {
             fprintf(stdout, "\n  \e[31mFAILED\e[0m tests:\n");
-            for (int i = 0; i < fails; i++)
-            {
-                if (i >= MAX_SUMMARY_TESTS_TO_LIST)
-                {
-                    fprintf(stdout, "  - \e[31mand %d more...\e[0m\n", fails - MAX_SUMMARY_TESTS_TO_LIST);
-                    break;
-                }
-                fprintf(stdout, "  - \e[31m");
-                fprint_buffer(stdout, failed_TestFilenameLine[i], strlen(failed_TestFilenameLine[i]));
-                fprintf(stdout, "\e[0m - %s.\n", failed_TestNames[i]);
-            }
+            print_test_results('F', "\e[31m");
         }
 
         if (assumptionFails > 0)
         {
             fprintf(stdout, "\n  Tests with \e[33mASSUMPTIONS_FAILED\e[0m:\n");
-            for (int i = 0; i < assumptionFails; i++)
-            {
-                if (i >= MAX_SUMMARY_TESTS_TO_LIST)
-                {
-                    fprintf(stdout, "  - \e[33mand %d more...\e[0m\n", assumptionFails - MAX_SUMMARY_TESTS_TO_LIST);
-                    break;
-                }
-                fprintf(stdout, "  - \e[33m");
-                fprint_buffer(stdout, assumeFailed_FilenameLine[i], strlen(assumeFailed_FilenameLine[i]));
-                fprintf(stdout, "\e[0m - %s.\n", assumeFailed_TestNames[i]);
-            }
+            print_test_results('A', "\e[33m");
         }
 
         if (knownFailsPassing > 0)
         {
             fprintf(stdout, "\n  \e[33mKNOWN_FAILING\e[0m tests \e[32mPASSING\e[0m:\n");
-            for (int i = 0; i < knownFailsPassing; i++)
-            {
-                if (i >= MAX_SUMMARY_TESTS_TO_LIST)
-                {
-                    fprintf(stdout, "  - \e[32mand %d more...\e[0m\n", knownFailsPassing - MAX_SUMMARY_TESTS_TO_LIST);
-                    break;
-                }
-                fprintf(stdout, "  - \e[32m");
-                fprint_buffer(stdout, knownFailingPassed_FilenameLine[i], strlen(knownFailingPassed_FilenameLine[i]));
-                fprintf(stdout, "\e[0m - %s.\n", knownFailingPassed_TestNames[i]);
-            }
+            print_test_results('U', "\e[32m");
         }
 
         fprintf(stdout, "\n");
@@ -861,6 +2589,8 @@ int main(int argc, char *argv[])
             fprintf(stdout, "- Tests \e[33mTO_DO\e[0m:           %d\n", todos);
         if (knownFailsPassing > 0)
             fprintf(stdout, "- \e[32mKNOWN_FAILING_PASSING\e[0m: %d   \e[33mPlease remove KNOWN_FAILING if these tests intentionally PASS\e[0m\n", knownFailsPassing);
+        if (skips > 0)
+            fprintf(stdout, "- Tests \e[36mUNCHANGED\e[0m:       %d   Skipped because nothing they depend on changed\n", skips);
         fprintf(stdout, "- Tests \e[32mPASSED\e[0m:          %d\n", passes);
         fprintf(stdout, "- Tests \e[34mTOTAL\e[0m:           %d\n", results);
     }
@@ -28,23 +28,30 @@
 #include "midi.h"
 #include "tables.h"
 
-int g_agbTrack;
-
-static std::string s_lastOpName;
-static int s_blockNum;
-static bool s_keepLastOpName;
-static int s_lastNote;
-static int s_lastVelocity;
-static bool s_noteChanged;
-static bool s_velocityChanged;
-static bool s_inPattern;
-static int s_extendedCommand;
-static int s_memaccOp;
-static int s_memaccParam1;
-static int s_memaccParam2;
+thread_local int g_agbTrack;
+
+static thread_local std::string s_lastOpName;
+static thread_local int s_blockNum;
+static thread_local bool s_keepLastOpName;
+static thread_local int s_lastNote;
+static thread_local int s_lastVelocity;
+static thread_local bool s_noteChanged;
+static thread_local bool s_velocityChanged;
+static thread_local bool s_inPattern;
+static thread_local int s_extendedCommand;
+static thread_local int s_memaccOp;
+static thread_local int s_memaccParam1;
+static thread_local int s_memaccParam2;
 
 void PrintAgbHeader()
 {
+    // A batch converts many files on each thread, so start afresh.
+    s_blockNum = 0;
+    s_extendedCommand = 0;
+    s_memaccOp = 0;
+    s_memaccParam1 = 0;
+    s_memaccParam2 = 0;
+
     std::fprintf(g_outputFile, "\t.include \"MPlayDef.s\"\n\n");
     std::fprintf(g_outputFile, "\t.equ\t%s_grp, voicegroup%03u\n", g_asmLabel.c_str(), g_voiceGroup);
     std::fprintf(g_outputFile, "\t.equ\t%s_pri, %u\n", g_asmLabel.c_str(), g_priority);
@@ -21,6 +21,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstdarg>
+#include "main.h"
 
 // Reports an error diagnostic and terminates the program.
 [[noreturn]] void RaiseError(const char* format, ...)
@@ -30,7 +31,10 @@
     std::va_list args;
     va_start(args, format);
     std::vsnprintf(buffer, bufferSize, format, args);
-    std::fprintf(stderr, "error: %s\n", buffer);
+    if (g_inputFilename.empty())
+        std::fprintf(stderr, "error: %s\n", buffer);
+    else
+        std::fprintf(stderr, "error: %s: %s\n", g_inputFilename.c_str(), buffer);
     va_end(args);
     std::exit(1);
 }
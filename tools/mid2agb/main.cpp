@@ -25,30 +25,37 @@
 #include <cassert>
 #include <string>
 #include <set>
+#include <vector>
+#include <atomic>
+#include <thread>
 #include "main.h"
 #include "error.h"
 #include "midi.h"
 #include "agb.h"
 
-FILE* g_inputFile = nullptr;
-FILE* g_outputFile = nullptr;
+thread_local std::string g_inputFilename;
+thread_local std::vector<unsigned char> g_inputData;
+thread_local FILE* g_outputFile = nullptr;
 
-std::string g_asmLabel;
-int g_masterVolume = 127;
-int g_voiceGroup = 0;
-int g_priority = 0;
-int g_reverb = -1;
-int g_clocksPerBeat = 1;
-bool g_exactGateTime = false;
-bool g_compressionEnabled = true;
+thread_local std::string g_asmLabel;
+thread_local int g_masterVolume;
+thread_local int g_voiceGroup;
+thread_local int g_priority;
+thread_local int g_reverb;
+thread_local int g_clocksPerBeat;
+thread_local bool g_exactGateTime;
+thread_local bool g_compressionEnabled;
 
 [[noreturn]] static void PrintUsage()
 {
     std::printf(
         "Usage: MID2AGB name [options]\n"
+        "       MID2AGB -batch cfg_file output_dir [-threads count]\n"
         "\n"
         "    input_file  filename(.mid) of MIDI file\n"
         "   output_file  filename(.s) for AGB file (default:input_file)\n"
+        "      cfg_file  list of \"name.mid: [options]\" lines, e.g. midi.cfg\n"
+        "    output_dir  directory for the name.s files\n"
         "\n"
         "options  -L???  label for assembler (default:output_file)\n"
         "         -V???  master volume (default:127)\n"
@@ -127,11 +134,20 @@ static const char *GetArgument(int argc, char **argv, int& index)
     }
 }
 
-int main(int argc, char** argv)
+static void ResetOptions()
 {
-    std::string inputFilename;
-    std::string outputFilename;
+    g_asmLabel.clear();
+    g_masterVolume = 127;
+    g_voiceGroup = 0;
+    g_priority = 0;
+    g_reverb = -1;
+    g_clocksPerBeat = 1;
+    g_exactGateTime = false;
+    g_compressionEnabled = true;
+}
 
+static void ParseArguments(int argc, char** argv, std::string& inputFilename, std::string& outputFilename)
+{
     for (int i = 1; i < argc; i++)
     {
         const char *option = argv[i];
@@ -195,6 +211,74 @@ int main(int argc, char** argv)
                 PrintUsage();
         }
     }
+}
+
+static void ReadInputFile(const std::string& filename)
+{
+    FILE *file = std::fopen(filename.c_str(), "rb");
+
+    if (file == nullptr)
+        RaiseError("failed to open \"%s\" for reading", filename.c_str());
+
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::rewind(file);
+
+    if (size < 0)
+        RaiseError("failed to read \"%s\"", filename.c_str());
+
+    g_inputData.resize(size);
+
+    if (size != 0 && std::fread(g_inputData.data(), size, 1, file) != 1)
+        RaiseError("failed to read \"%s\"", filename.c_str());
+
+    std::fclose(file);
+}
+
+static bool FilesEqual(const std::string& path1, const std::string& path2)
+{
+    FILE *file1 = std::fopen(path1.c_str(), "rb");
+    FILE *file2 = std::fopen(path2.c_str(), "rb");
+    bool equal = false;
+
+    if (file1 != nullptr && file2 != nullptr)
+    {
+        char buffer1[65536], buffer2[65536];
+
+        for (;;)
+        {
+            std::size_t size1 = std::fread(buffer1, 1, sizeof(buffer1), file1);
+            std::size_t size2 = std::fread(buffer2, 1, sizeof(buffer2), file2);
+
+            if (size1 != size2 || std::memcmp(buffer1, buffer2, size1) != 0)
+                break;
+
+            if (size1 < sizeof(buffer1))
+            {
+                equal = true;
+                break;
+            }
+        }
+    }
+
+    if (file1 != nullptr)
+        std::fclose(file1);
+    if (file2 != nullptr)
+        std::fclose(file2);
+
+    return equal;
+}
+
+// Converts the MIDI file named by the arguments. If onlyIfChanged is set, the
+// output is written to a temporary file first, and only replaces the old
+// output if it is different.
+static void ConvertMidi(int argc, char** argv, bool onlyIfChanged)
+{
+    std::string inputFilename;
+    std::string outputFilename;
+
+    ResetOptions();
+    ParseArguments(argc, argv, inputFilename, outputFilename);
 
     if (inputFilename.empty())
         PrintUsage();
@@ -211,23 +295,142 @@ int main(int argc, char** argv)
     if (g_asmLabel.empty())
         g_asmLabel = BaseName(outputFilename);
 
-    g_inputFile = std::fopen(inputFilename.c_str(), "rb");
+    g_inputFilename = inputFilename;
+    ReadInputFile(inputFilename);
 
-    if (g_inputFile == nullptr)
-        RaiseError("failed to open \"%s\" for reading", inputFilename.c_str());
+    std::string writeFilename = onlyIfChanged ? outputFilename + ".tmp" : outputFilename;
 
-    g_outputFile = std::fopen(outputFilename.c_str(), "w");
+    g_outputFile = std::fopen(writeFilename.c_str(), "w");
 
     if (g_outputFile == nullptr)
-        RaiseError("failed to open \"%s\" for writing", outputFilename.c_str());
+        RaiseError("failed to open \"%s\" for writing", writeFilename.c_str());
 
     ReadMidiFileHeader();
     PrintAgbHeader();
     ReadMidiTracks();
     PrintAgbFooter();
 
-    std::fclose(g_inputFile);
-    std::fclose(g_outputFile);
+    if (std::fclose(g_outputFile) != 0)
+        RaiseError("failed to write \"%s\"", writeFilename.c_str());
+
+    g_outputFile = nullptr;
+
+    if (onlyIfChanged)
+    {
+        if (FilesEqual(writeFilename, outputFilename))
+        {
+            std::remove(writeFilename.c_str());
+        }
+        else
+        {
+#ifdef _WIN32
+            std::remove(outputFilename.c_str());
+#endif
+            if (std::rename(writeFilename.c_str(), outputFilename.c_str()) != 0)
+                RaiseError("failed to write \"%s\"", outputFilename.c_str());
+        }
+    }
+
+    g_inputFilename.clear();
+}
+
+// Converts every MIDI file listed in a midi.cfg-style file, each with the
+// options which follow its name. The MIDI files are next to the list. Outputs
+// which have not changed are left alone, so that they are not reassembled.
+static void HandleBatch(int argc, char** argv)
+{
+    if (argc < 4)
+        PrintUsage();
+
+    std::string cfgFilename = argv[2];
+    std::string outputDir = argv[3];
+    int threadCount = 0;
+
+    for (int i = 4; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threadCount = std::stoi(argv[++i]);
+        else
+            PrintUsage();
+    }
+
+    if (threadCount < 1)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount < 1)
+        threadCount = 1;
+
+    std::size_t slashPos = cfgFilename.find_last_of("/\\");
+    std::string inputDir = slashPos == std::string::npos ? "." : cfgFilename.substr(0, slashPos);
+
+    FILE *cfgFile = std::fopen(cfgFilename.c_str(), "r");
+
+    if (cfgFile == nullptr)
+        RaiseError("failed to open \"%s\" for reading", cfgFilename.c_str());
+
+    std::vector<std::vector<std::string>> jobs;
+    char line[1024];
+
+    while (std::fgets(line, sizeof(line), cfgFile) != nullptr)
+    {
+        std::vector<std::string> words;
+
+        for (char *word = std::strtok(line, " \t\r\n"); word != nullptr; word = std::strtok(nullptr, " \t\r\n"))
+            words.push_back(word);
+
+        if (words.empty())
+            continue;
+
+        // As in audio_rules.mk, the extension of the name is optional.
+        std::string name = words[0];
+        if (name.back() == ':')
+            name.pop_back();
+        name = StripExtension(name);
+
+        std::vector<std::string> args;
+        args.push_back(argv[0]);
+        args.push_back(inputDir + "/" + name + ".mid");
+        args.push_back(outputDir + "/" + name + ".s");
+        args.insert(args.end(), words.begin() + 1, words.end());
+        jobs.push_back(args);
+    }
+
+    std::fclose(cfgFile);
+
+    std::atomic<std::size_t> nextJob(0);
+
+    auto worker = [&]()
+    {
+        std::size_t i;
+
+        while ((i = nextJob++) < jobs.size())
+        {
+            std::vector<char*> jobArgv;
+
+            for (std::string& arg : jobs[i])
+                jobArgv.push_back(&arg[0]);
+
+            ConvertMidi(jobArgv.size(), jobArgv.data(), true);
+        }
+    };
+
+    // The main thread is a worker too.
+    std::vector<std::thread> threads;
+
+    for (int i = 1; i < threadCount && i < (int)jobs.size(); i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "-batch") == 0)
+        HandleBatch(argc, argv);
+    else
+        ConvertMidi(argc, argv, false);
 
     return 0;
 }
@@ -23,17 +23,19 @@
 
 #include <cstdio>
 #include <string>
+#include <vector>
 
-extern FILE* g_inputFile;
-extern FILE* g_outputFile;
+extern thread_local std::string g_inputFilename;
+extern thread_local std::vector<unsigned char> g_inputData;
+extern thread_local FILE* g_outputFile;
 
-extern std::string g_asmLabel;
-extern int g_masterVolume;
-extern int g_voiceGroup;
-extern int g_priority;
-extern int g_reverb;
-extern int g_clocksPerBeat;
-extern bool g_exactGateTime;
-extern bool g_compressionEnabled;
+extern thread_local std::string g_asmLabel;
+extern thread_local int g_masterVolume;
+extern thread_local int g_voiceGroup;
+extern thread_local int g_priority;
+extern thread_local int g_reverb;
+extern thread_local int g_clocksPerBeat;
+extern thread_local bool g_exactGateTime;
+extern thread_local bool g_compressionEnabled;
 
 #endif // MAIN_H
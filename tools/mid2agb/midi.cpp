@@ -19,11 +19,11 @@
 // THE SOFTWARE.
 
 #include <cstdio>
+#include <cstring>
 #include <cassert>
 #include <string>
 #include <vector>
 #include <algorithm>
-#include <memory>
 #include "midi.h"
 #include "main.h"
 #include "error.h"
@@ -38,39 +38,61 @@ enum class MidiEventCategory
     Invalid,
 };
 
-MidiFormat g_midiFormat;
-std::int_fast32_t g_midiTrackCount;
-std::int16_t g_midiTimeDiv;
+thread_local MidiFormat g_midiFormat;
+thread_local std::int_fast32_t g_midiTrackCount;
+thread_local std::int16_t g_midiTimeDiv;
 
-int g_midiChan;
-std::int32_t g_initialWait;
+thread_local int g_midiChan;
+thread_local std::int32_t g_initialWait;
 
-static long s_trackDataStart;
-static std::vector<Event> s_seqEvents;
-static std::vector<Event> s_trackEvents;
-static std::int32_t s_absoluteTime;
-static int s_blockCount = 0;
-static int s_minNote;
-static int s_maxNote;
-static int s_runningStatus;
+static thread_local std::size_t s_inputPos;
+static thread_local long s_trackDataStart;
+static thread_local std::vector<Event> s_seqEvents;
+static thread_local std::vector<Event> s_trackEvents;
+static thread_local std::int32_t s_absoluteTime;
+static thread_local int s_blockCount;
+static thread_local int s_minNote;
+static thread_local int s_maxNote;
+static thread_local int s_runningStatus;
+
+// The events of the track being converted, and scratch space for the passes
+// which insert events. Both are reused so that their memory is too.
+static thread_local std::vector<Event> s_events;
+static thread_local std::vector<Event> s_scratchEvents;
 
 void Seek(long offset)
 {
-    if (std::fseek(g_inputFile, offset, SEEK_SET) != 0)
-        RaiseError("failed to seek to %l", offset);
+    if (offset < 0)
+        RaiseError("failed to seek to %ld", offset);
+
+    s_inputPos = offset;
 }
 
 void Skip(long offset)
 {
-    if (std::fseek(g_inputFile, offset, SEEK_CUR) != 0)
-        RaiseError("failed to skip %l bytes", offset);
+    if (offset < 0 && static_cast<std::size_t>(-offset) > s_inputPos)
+        RaiseError("failed to skip %ld bytes", offset);
+
+    s_inputPos += offset;
+}
+
+bool ReadBytes(void *buffer, std::size_t size)
+{
+    if (s_inputPos > g_inputData.size() || g_inputData.size() - s_inputPos < size)
+        return false;
+
+    if (size != 0)
+        std::memcpy(buffer, &g_inputData[s_inputPos], size);
+
+    s_inputPos += size;
+    return true;
 }
 
 std::string ReadSignature()
 {
     char signature[4];
 
-    if (std::fread(signature, 4, 1, g_inputFile) != 1)
+    if (!ReadBytes(signature, 4))
         RaiseError("failed to read signature");
 
     return std::string(signature, 4);
@@ -78,12 +100,10 @@ std::string ReadSignature()
 
 std::uint32_t ReadInt8()
 {
-    int c = std::fgetc(g_inputFile);
-
-    if (c < 0)
+    if (s_inputPos >= g_inputData.size())
         RaiseError("unexpected EOF");
 
-    return c;
+    return g_inputData[s_inputPos++];
 }
 
 std::uint32_t ReadInt16()
@@ -130,6 +150,10 @@ std::uint32_t ReadVLQ()
 
 void ReadMidiFileHeader()
 {
+    // A batch converts many files on each thread, so start afresh.
+    s_seqEvents.clear();
+    s_blockCount = 0;
+
     Seek(0);
 
     if (ReadSignature() != "MThd")
@@ -162,7 +186,7 @@ long ReadMidiTrackHeader(long offset)
 
     long size = ReadInt32();
 
-    s_trackDataStart = std::ftell(g_inputFile);
+    s_trackDataStart = s_inputPos;
 
     return size + 8;
 }
@@ -186,7 +210,7 @@ void DetermineEventCategory(MidiEventCategory& category, int& typeChan, int& siz
     if (typeChan < 0x80)
     {
         // If data byte was found, use the running status.
-        ungetc(typeChan, g_inputFile);
+        s_inputPos--;
         typeChan = s_runningStatus;
     }
 
@@ -238,7 +262,7 @@ std::string ReadEventText()
 
     if (length <= 2)
     {
-        if (fread(buffer, length, 1, g_inputFile) != 1)
+        if (!ReadBytes(buffer, length))
             RaiseError("failed to read event text");
     }
     else
@@ -435,7 +459,7 @@ void FindNoteEnd(Event& event)
 {
     // Save the current file position and running status
     // which get modified by CheckNoteEnd.
-    long startPos = ftell(g_inputFile);
+    long startPos = s_inputPos;
     int savedRunningStatus = s_runningStatus;
 
     event.param2 = 0;
@@ -597,9 +621,9 @@ bool EventCompare(const Event& event1, const Event& event2)
     return false;
 }
 
-std::unique_ptr<std::vector<Event>> MergeEvents()
+void MergeEvents(std::vector<Event>& events)
 {
-    std::unique_ptr<std::vector<Event>> events(new std::vector<Event>());
+    events.clear();
 
     unsigned trackEventPos = 0;
     unsigned seqEventPos = 0;
@@ -608,24 +632,22 @@ std::unique_ptr<std::vector<Event>> MergeEvents()
         && s_seqEvents[seqEventPos].type != EventType::EndOfTrack)
     {
         if (EventCompare(s_trackEvents[trackEventPos], s_seqEvents[seqEventPos]))
-            events->push_back(s_trackEvents[trackEventPos++]);
+            events.push_back(s_trackEvents[trackEventPos++]);
         else
-            events->push_back(s_seqEvents[seqEventPos++]);
+            events.push_back(s_seqEvents[seqEventPos++]);
     }
 
     while (s_trackEvents[trackEventPos].type != EventType::EndOfTrack)
-        events->push_back(s_trackEvents[trackEventPos++]);
+        events.push_back(s_trackEvents[trackEventPos++]);
 
     while (s_seqEvents[seqEventPos].type != EventType::EndOfTrack)
-        events->push_back(s_seqEvents[seqEventPos++]);
+        events.push_back(s_seqEvents[seqEventPos++]);
 
     // Push the EndOfTrack event with the larger time.
     if (EventCompare(s_trackEvents[trackEventPos], s_seqEvents[seqEventPos]))
-        events->push_back(s_seqEvents[seqEventPos]);
+        events.push_back(s_seqEvents[seqEventPos]);
     else
-        events->push_back(s_trackEvents[trackEventPos]);
-
-    return events;
+        events.push_back(s_trackEvents[trackEventPos]);
 }
 
 void ConvertTimes(std::vector<Event>& events)
@@ -651,9 +673,9 @@ void ConvertTimes(std::vector<Event>& events)
     }
 }
 
-std::unique_ptr<std::vector<Event>> InsertTimingEvents(std::vector<Event>& inEvents)
+void InsertTimingEvents(const std::vector<Event>& inEvents, std::vector<Event>& outEvents)
 {
-    std::unique_ptr<std::vector<Event>> outEvents(new std::vector<Event>());
+    outEvents.clear();
 
     Event timingEvent = {};
     timingEvent.time = 0;
@@ -664,7 +686,7 @@ std::unique_ptr<std::vector<Event>> InsertTimingEvents(std::vector<Event>& inEve
     {
         while (EventCompare(timingEvent, event))
         {
-            outEvents->push_back(timingEvent);
+            outEvents.push_back(timingEvent);
             timingEvent.time += timingEvent.param2;
         }
 
@@ -674,21 +696,19 @@ std::unique_ptr<std::vector<Event>> InsertTimingEvents(std::vector<Event>& inEve
             {
                 Event originalTimingEvent = event;
                 originalTimingEvent.type = EventType::OriginalTimeSignature;
-                outEvents->push_back(originalTimingEvent);
+                outEvents.push_back(originalTimingEvent);
             }
             timingEvent.param2 = event.param2;
             timingEvent.time = event.time + timingEvent.param2;
         }
 
-        outEvents->push_back(event);
+        outEvents.push_back(event);
     }
-
-    return outEvents;
 }
 
-std::unique_ptr<std::vector<Event>> SplitTime(std::vector<Event>& inEvents)
+void SplitTime(const std::vector<Event>& inEvents, std::vector<Event>& outEvents)
 {
-    std::unique_ptr<std::vector<Event>> outEvents(new std::vector<Event>());
+    outEvents.clear();
 
     std::int32_t time = 0;
 
@@ -707,7 +727,7 @@ std::unique_ptr<std::vector<Event>> SplitTime(std::vector<Event>& inEvents)
                 Event timeSplitEvent = {};
                 timeSplitEvent.time = time;
                 timeSplitEvent.type = EventType::TimeSplit;
-                outEvents->push_back(timeSplitEvent);
+                outEvents.push_back(timeSplitEvent);
             }
         }
 
@@ -718,20 +738,18 @@ std::unique_ptr<std::vector<Event>> SplitTime(std::vector<Event>& inEvents)
             Event timeSplitEvent = {};
             timeSplitEvent.time = time + lutValue;
             timeSplitEvent.type = EventType::TimeSplit;
-            outEvents->push_back(timeSplitEvent);
+            outEvents.push_back(timeSplitEvent);
         }
 
         time = event.time;
 
-        outEvents->push_back(event);
+        outEvents.push_back(event);
     }
-
-    return outEvents;
 }
 
-std::unique_ptr<std::vector<Event>> CreateTies(std::vector<Event>& inEvents)
+void CreateTies(const std::vector<Event>& inEvents, std::vector<Event>& outEvents)
 {
-    std::unique_ptr<std::vector<Event>> outEvents(new std::vector<Event>());
+    outEvents.clear();
 
     for (const Event& event : inEvents)
     {
@@ -739,21 +757,19 @@ std::unique_ptr<std::vector<Event>> CreateTies(std::vector<Event>& inEvents)
         {
             Event tieEvent = event;
             tieEvent.param2 = -1;
-            outEvents->push_back(tieEvent);
+            outEvents.push_back(tieEvent);
 
             Event eotEvent = {};
             eotEvent.time = event.time + event.param2;
             eotEvent.type = EventType::EndOfTie;
             eotEvent.note = event.note;
-            outEvents->push_back(eotEvent);
+            outEvents.push_back(eotEvent);
         }
         else
         {
-            outEvents->push_back(event);
+            outEvents.push_back(event);
         }
     }
-
-    return outEvents;
 }
 
 void CalculateWaits(std::vector<Event>& events)
@@ -936,7 +952,7 @@ void ReadMidiTracks()
                 printf("Track%d = Midi-Ch.%d\n", g_agbTrack, g_midiChan + 1);
 #endif
 
-                std::unique_ptr<std::vector<Event>> events(MergeEvents());
+                MergeEvents(s_events);
 
                 // We don't need TEMPO in anything but track 1.
                 if (g_agbTrack == 1)
@@ -945,17 +961,18 @@ void ReadMidiTracks()
                     s_seqEvents.erase(it, s_seqEvents.end());
                 }
 
-                ConvertTimes(*events);
-                events = InsertTimingEvents(*events);
-                events = CreateTies(*events);
-                std::stable_sort(events->begin(), events->end(), EventCompare);
-                events = SplitTime(*events);
-                CalculateWaits(*events);
+                ConvertTimes(s_events);
+                InsertTimingEvents(s_events, s_scratchEvents);
+                CreateTies(s_scratchEvents, s_events);
+                std::stable_sort(s_events.begin(), s_events.end(), EventCompare);
+                SplitTime(s_events, s_scratchEvents);
+                s_events.swap(s_scratchEvents);
+                CalculateWaits(s_events);
 
                 if (g_compressionEnabled)
-                    Compress(*events);
+                    Compress(s_events);
 
-                PrintAgbTrack(*events);
+                PrintAgbTrack(s_events);
 
                 g_agbTrack++;
             }
@@ -18,6 +18,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdarg>
 #include <stdexcept>
@@ -41,7 +42,8 @@ AsmFile::AsmFile(std::string filename, bool isStdin, bool doEnum) : m_filename(f
     RemoveComments();
 }
 
-AsmFile::AsmFile(AsmFile&& other) : m_filename(std::move(other.m_filename))
+AsmFile::AsmFile(AsmFile&& other) : m_filename(std::move(other.m_filename)),
+    m_lineMarkers(std::move(other.m_lineMarkers)), m_newlines(std::move(other.m_newlines))
 {
     m_buffer = other.m_buffer;
     m_doEnum = other.m_doEnum;
@@ -125,19 +127,18 @@ void AsmFile::RemoveComments()
 
 // Checks if we're at a particular directive and if so, consumes it.
 // Returns whether the directive was found.
-bool AsmFile::CheckForDirective(std::string name)
+bool AsmFile::CheckForDirective(const char* name)
 {
     long i;
-    long length = static_cast<long>(name.length());
 
-    for (i = 0; i < length && m_pos + i < m_size; i++)
+    for (i = 0; name[i] != 0 && m_pos + i < m_size; i++)
         if (name[i] != m_buffer[m_pos + i])
             return false;
 
-    if (i < length)
+    if (name[i] != 0)
         return false;
 
-    m_pos += length;
+    m_pos += i;
 
     return true;
 }
@@ -688,21 +689,34 @@ int AsmFile::SkipWhitespaceAndEol()
     return newlines;
 }
 
-// returns the last line indicator and its corresponding file name without modifying the token index
-int AsmFile::FindLastLineNumber(std::string& filename)
+// Records where every '#' and newline is, so that finding the line
+// indicator before an enum does not have to scan back through the file.
+void AsmFile::IndexLineMarkers()
 {
-    long pos = m_pos;
-    long linebreaks = 0;
-    while (m_buffer[pos] != '#' && pos >= 0)
+    for (long pos = 0; pos < m_size; pos++)
     {
-        if (m_buffer[pos] == '\n')
-            linebreaks++;
-        pos--;
+        if (m_buffer[pos] == '#')
+            m_lineMarkers.push_back(pos);
+        else if (m_buffer[pos] == '\n')
+            m_newlines.push_back(pos);
     }
+}
+
+// returns the last line indicator and its corresponding file name without modifying the token index
+int AsmFile::FindLastLineNumber(std::string& filename)
+{
+    if (m_lineMarkers.empty() && m_newlines.empty())
+        IndexLineMarkers();
 
-    if (pos < 0)
+    auto marker = std::upper_bound(m_lineMarkers.begin(), m_lineMarkers.end(), m_pos);
+
+    if (marker == m_lineMarkers.begin())
         RaiseError("line indicator for header file not found before `enum`");
 
+    long pos = *--marker;
+    long linebreaks = std::upper_bound(m_newlines.begin(), m_newlines.end(), m_pos)
+                    - std::upper_bound(m_newlines.begin(), m_newlines.end(), pos);
+
     pos++;
     while (m_buffer[pos] == ' ' || m_buffer[pos] == '\t')
         pos++;
@@ -24,6 +24,7 @@
 #include <cstdarg>
 #include <cstdint>
 #include <string>
+#include <vector>
 #include "preproc.h"
 
 enum class Directive
@@ -60,11 +61,13 @@ private:
     long m_lineNum;
     long m_lineStart;
     std::string m_filename;
+    std::vector<long> m_lineMarkers;
+    std::vector<long> m_newlines;
 
     bool ConsumeComma();
     int ReadPadLength();
     void RemoveComments();
-    bool CheckForDirective(std::string name);
+    bool CheckForDirective(const char* name);
     void SkipWhitespace();
     void ExpectEmptyRestOfLine();
     void ReportDiagnostic(const char* type, const char* format, std::va_list args);
@@ -72,6 +75,7 @@ private:
     void RaiseWarning(const char* format, ...);
     void VerifyStringLength(int length);
     int SkipWhitespaceAndEol();
+    void IndexLineMarkers();
     int FindLastLineNumber(std::string& filename);
     std::string ReadIdentifier();
     long ReadInteger(std::string filename, long line);
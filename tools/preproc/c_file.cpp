@@ -25,6 +25,7 @@
 #include <memory>
 #include <cstring>
 #include <cerrno>
+#include <vector>
 #include "preproc.h"
 #include "c_file.h"
 #include "char_util.h"
@@ -32,7 +33,11 @@
 #include "string_parser.h"
 #include "io.h"
 
-CFile::CFile(const char * filenameCStr, bool isStdin)
+// Output is held back until the end of each top-level declaration, so that
+// an INCBIN declaration can be rewritten once the INCBIN has been seen.
+static const std::size_t kOutputFlushSize = 1 << 16;
+
+CFile::CFile(const char * filenameCStr, bool isStdin, bool incbinAsm)
 {
     if (isStdin)
         m_filename = std::string{"<stdin>/"}.append(filenameCStr);
@@ -44,15 +49,21 @@ CFile::CFile(const char * filenameCStr, bool isStdin)
     m_pos = 0;
     m_lineNum = 1;
     m_isStdin = isStdin;
+    m_incbinAsm = incbinAsm;
+    m_statementStart = 0;
+    m_braceDepth = 0;
 }
 
-CFile::CFile(CFile&& other) : m_filename(std::move(other.m_filename))
+CFile::CFile(CFile&& other) : m_filename(std::move(other.m_filename)), m_output(std::move(other.m_output))
 {
     m_buffer = other.m_buffer;
     m_pos = other.m_pos;
     m_size = other.m_size;
     m_lineNum = other.m_lineNum;
     m_isStdin = other.m_isStdin;
+    m_incbinAsm = other.m_incbinAsm;
+    m_statementStart = other.m_statementStart;
+    m_braceDepth = other.m_braceDepth;
 
     other.m_buffer = NULL;
 }
@@ -72,21 +83,21 @@ void CFile::Preproc()
         {
             if (m_buffer[m_pos] == stringChar)
             {
-                std::putchar(stringChar);
+                m_output += stringChar;
                 m_pos++;
                 stringChar = 0;
             }
             else if (m_buffer[m_pos] == '\\' && m_buffer[m_pos + 1] == stringChar)
             {
-                std::putchar('\\');
-                std::putchar(stringChar);
+                m_output += '\\';
+                m_output += stringChar;
                 m_pos += 2;
             }
             else
             {
                 if (m_buffer[m_pos] == '\n')
                     m_lineNum++;
-                std::putchar(m_buffer[m_pos]);
+                m_output += m_buffer[m_pos];
                 m_pos++;
             }
         }
@@ -100,7 +111,7 @@ void CFile::Preproc()
 
             char c = m_buffer[m_pos++];
 
-            std::putchar(c);
+            m_output += c;
 
             if (c == '\n')
                 m_lineNum++;
@@ -108,8 +119,30 @@ void CFile::Preproc()
                 stringChar = '"';
             else if (c == '\'')
                 stringChar = '\'';
+            else if (c == '{')
+                m_braceDepth++;
+            else if (c == '}' && --m_braceDepth == 0)
+                EndStatement();
+            else if (c == ';' && m_braceDepth == 0)
+                EndStatement();
         }
     }
+
+    FlushOutput();
+}
+
+void CFile::EndStatement()
+{
+    m_statementStart = m_output.size();
+    if (m_statementStart >= kOutputFlushSize)
+        FlushOutput();
+}
+
+void CFile::FlushOutput()
+{
+    std::fwrite(m_output.data(), 1, m_output.size(), stdout);
+    m_output.clear();
+    m_statementStart = 0;
 }
 
 bool CFile::ConsumeHorizontalWhitespace()
@@ -129,7 +162,7 @@ bool CFile::ConsumeNewline()
     {
         m_pos += 2;
         m_lineNum++;
-        std::putchar('\n');
+        m_output += '\n';
         return true;
     }
 
@@ -137,7 +170,7 @@ bool CFile::ConsumeNewline()
     {
         m_pos++;
         m_lineNum++;
-        std::putchar('\n');
+        m_output += '\n';
         return true;
     }
 
@@ -180,7 +213,7 @@ void CFile::TryConvertString()
 
     SkipWhitespace();
 
-    std::printf("{ ");
+    m_output += "{ ";
 
     while (1)
     {
@@ -201,8 +234,12 @@ void CFile::TryConvertString()
                 RaiseError(e.what());
             }
 
+            static const char hexDigits[] = "0123456789ABCDEF";
             for (int i = 0; i < length; i++)
-                printf("0x%02X, ", s[i]);
+            {
+                char hex[] = { '0', 'x', hexDigits[s[i] >> 4], hexDigits[s[i] & 0xF], ',', ' ' };
+                m_output.append(hex, sizeof(hex));
+            }
         }
         else if (m_buffer[m_pos] == ')')
         {
@@ -221,9 +258,9 @@ void CFile::TryConvertString()
     }
 
     if (noTerminator)
-        std::printf(" }");
+        m_output += " }";
     else
-        std::printf("0xFF }");
+        m_output += "0xFF }";
 }
 
 bool CFile::CheckIdentifier(const std::string& ident)
@@ -237,43 +274,20 @@ bool CFile::CheckIdentifier(const std::string& ident)
     return (i == ident.length());
 }
 
-std::unique_ptr<unsigned char[]> CFile::ReadWholeFile(const std::string& path, int& size)
-{
-    FILE* fp = std::fopen(path.c_str(), "rb");
-
-    if (fp == nullptr)
-        RaiseError("Failed to open \"%s\" for reading.\n", path.c_str());
-
-    std::fseek(fp, 0, SEEK_END);
-
-    size = std::ftell(fp);
-
-    std::unique_ptr<unsigned char[]> buffer = std::unique_ptr<unsigned char[]>(new unsigned char[size]);
-
-    std::rewind(fp);
-
-    if (std::fread(buffer.get(), size, 1, fp) != 1)
-        RaiseError("Failed to read \"%s\".\n", path.c_str());
-
-    std::fclose(fp);
-
-    return buffer;
-}
-
-int ExtractData(const std::unique_ptr<unsigned char[]>& buffer, int offset, int size)
+static std::uint32_t ExtractData(const unsigned char* buffer, int size)
 {
     switch (size)
     {
     case 1:
-        return buffer[offset];
+        return buffer[0];
     case 2:
-        return (buffer[offset + 1] << 8)
-            | buffer[offset];
+        return (buffer[1] << 8)
+            | buffer[0];
     case 4:
-        return (buffer[offset + 3] << 24)
-            | (buffer[offset + 2] << 16)
-            | (buffer[offset + 1] << 8)
-            | buffer[offset];
+        return ((std::uint32_t)buffer[3] << 24)
+            | (buffer[2] << 16)
+            | (buffer[1] << 8)
+            | buffer[0];
     default:
         FATAL_ERROR("Invalid size passed to ExtractData.\n");
     }
@@ -281,7 +295,7 @@ int ExtractData(const std::unique_ptr<unsigned char[]>& buffer, int offset, int
 
 void CFile::TryConvertIncbin()
 {
-    std::string idents[8] = { "INCBIN_S8", "INCBIN_U8", "INCBIN_S16", "INCBIN_U16", "INCBIN_S32", "INCBIN_U32", "DUMMY", "INCBIN_COMP"};
+    static const std::string idents[8] = { "INCBIN_S8", "INCBIN_U8", "INCBIN_S16", "INCBIN_U16", "INCBIN_S32", "INCBIN_U32", "DUMMY", "INCBIN_COMP"};
     int incbinType = -1;
 
     for (int i = 0; i < 8; i++)
@@ -317,7 +331,9 @@ void CFile::TryConvertIncbin()
 
     m_pos++;
 
-    std::printf("{");
+    std::vector<std::string> paths;
+    std::vector<std::string> newlines;
+    std::size_t newlinesStart = m_output.size();
 
     while (true)
     {
@@ -357,25 +373,12 @@ void CFile::TryConvertIncbin()
 
         m_pos++;
 
-        int fileSize;
-        std::unique_ptr<unsigned char[]> buffer = ReadWholeFile(path, fileSize);
-
-        if ((fileSize % size) != 0)
-            RaiseError("Size %d doesn't evenly divide file size %d.\n", size, fileSize);
-
-        int count = fileSize / size;
-        int offset = 0;
-
-        for (int i = 0; i < count; i++)
-        {
-            int data = ExtractData(buffer, offset, size);
-            offset += size;
-
-            if (isSigned)
-                std::printf("%d,", data);
-            else
-                std::printf("%uu,", data);
-        }
+        // SkipWhitespace copies newlines to the output to keep the line
+        // numbers right; hold them back so that they can be put between
+        // the right elements once the data has been output.
+        paths.push_back(path);
+        newlines.push_back(m_output.substr(newlinesStart));
+        m_output.resize(newlinesStart);
 
         SkipWhitespace();
 
@@ -390,7 +393,214 @@ void CFile::TryConvertIncbin()
 
     m_pos++;
 
-    std::printf("}");
+    std::string trailingNewlines = m_output.substr(newlinesStart);
+    m_output.resize(newlinesStart);
+
+    if (m_incbinAsm && TryOutputIncbinAsm(paths, size))
+    {
+        for (const std::string& lines : newlines)
+            m_output += lines;
+        m_output += trailingNewlines;
+        return;
+    }
+
+    m_output += '{';
+
+    for (std::size_t i = 0; i < paths.size(); i++)
+    {
+        m_output += newlines[i];
+        OutputIncbinData(paths[i], size, isSigned);
+    }
+
+    m_output += trailingNewlines;
+    m_output += '}';
+}
+
+// Outputs the contents of a file as the elements of an array initializer.
+void CFile::OutputIncbinData(const std::string& path, int size, bool isSigned)
+{
+    MappedFile file(path.c_str());
+
+    if (!file.IsOpen())
+        RaiseError("Failed to open \"%s\" for reading.\n", path.c_str());
+
+    if ((file.Size() % size) != 0)
+        RaiseError("Size %d doesn't evenly divide file size %d.\n", size, (int)file.Size());
+
+    const unsigned char* data = file.Data();
+    std::size_t count = file.Size() / size;
+
+    // Reserve enough for the typical element so that appending rarely reallocates.
+    m_output.reserve(m_output.size() + count * (size * 2 + 3));
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::uint32_t value = ExtractData(data + i * size, size);
+        char digits[16];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+
+        *--p = ',';
+        if (!isSigned)
+            *--p = 'u';
+
+        bool isNegative = isSigned && (std::int32_t)value < 0;
+        if (isNegative)
+            value = 0u - value;
+
+        do
+        {
+            *--p = '0' + value % 10;
+            value /= 10;
+        } while (value != 0);
+
+        if (isNegative)
+            *--p = '-';
+
+        m_output.append(p, end - p);
+    }
+}
+
+// Replaces a simple top-level declaration such as
+//   static const u32 sTiles[] = INCBIN_U32("graphics/tiles.4bpp");
+// with an extern declaration of the array and the assembler directives
+// which define it, so that the data never passes through cc1. Returns
+// false without outputting anything if the INCBIN is used in any other
+// way, e.g. in an array of arrays or in a declaration with attributes.
+bool CFile::TryOutputIncbinAsm(const std::vector<std::string>& paths, int size)
+{
+    if (m_braceDepth != 0)
+        return false;
+
+    long next = m_pos;
+    while (next < m_size && IsWhitespace(m_buffer[next]))
+        next++;
+    if (next >= m_size || m_buffer[next] != ';')
+        return false;
+
+    // Walk back over "NAME[] =".
+    const std::size_t start = m_statementStart;
+    std::size_t i = m_output.size();
+    const char* expected = "=][";
+
+    for (; *expected != 0; expected++)
+    {
+        while (i > start && IsWhitespace(m_output[i - 1]))
+            i--;
+        if (i == start || m_output[i - 1] != *expected)
+            return false;
+        i--;
+    }
+
+    while (i > start && IsWhitespace(m_output[i - 1]))
+        i--;
+
+    std::size_t nameEnd = i;
+
+    while (i > start && IsIdentifierChar(m_output[i - 1]))
+        i--;
+
+    if (i == nameEnd || IsAsciiDigit(m_output[i]))
+        return false;
+
+    std::string name = m_output.substr(i, nameEnd - i);
+    std::size_t declEnd = i;
+
+    // Skip the line markers and whitespace which precede the declaration.
+    std::size_t declStart = start;
+
+    while (declStart < declEnd)
+    {
+        if (IsWhitespace(m_output[declStart]))
+        {
+            declStart++;
+        }
+        else if (m_output[declStart] == '#')
+        {
+            while (declStart < declEnd && m_output[declStart] != '\n')
+                declStart++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    // Everything else must be plain identifiers, i.e. keywords and a type name.
+    std::vector<std::string> specifiers;
+    bool isStatic = false;
+    bool isConst = false;
+
+    for (std::size_t j = declStart; j < declEnd;)
+    {
+        if (IsWhitespace(m_output[j]))
+        {
+            j++;
+            continue;
+        }
+
+        std::size_t tokenStart = j;
+        while (j < declEnd && IsIdentifierChar(m_output[j]))
+            j++;
+
+        if (j == tokenStart || IsAsciiDigit(m_output[tokenStart]))
+            return false;
+
+        std::string token = m_output.substr(tokenStart, j - tokenStart);
+        if (token == "extern" || token == "typedef" || token == "__thread" || token == "_Thread_local")
+            return false;
+        if (token == "static")
+            isStatic = true;
+        else
+            specifiers.push_back(token);
+        if (token == "const")
+            isConst = true;
+    }
+
+    if (specifiers.empty())
+        return false;
+
+    long long totalSize = 0;
+
+    for (const std::string& path : paths)
+    {
+        MappedFile file(path.c_str());
+
+        if (!file.IsOpen())
+            RaiseError("Failed to open \"%s\" for reading.\n", path.c_str());
+
+        if ((file.Size() % size) != 0)
+            RaiseError("Size %d doesn't evenly divide file size %d.\n", size, (int)file.Size());
+
+        totalSize += file.Size();
+    }
+
+    std::string lines;
+    for (std::size_t j = declStart; j < m_output.size(); j++)
+        if (m_output[j] == '\n')
+            lines += '\n';
+
+    std::string decl = "extern";
+    for (const std::string& specifier : specifiers)
+        decl += " " + specifier;
+    decl += " " + name + "[" + std::to_string(totalSize / size) + "]; ";
+
+    decl += "__asm__(\".pushsection ";
+    decl += isConst ? ".rodata" : ".data";
+    decl += "\\n\\t.balign 4\\n";
+    if (!isStatic)
+        decl += "\\t.global " + name + "\\n";
+    decl += "\\t.type " + name + ", %object\\n";
+    decl += "\\t.size " + name + ", " + std::to_string(totalSize) + "\\n";
+    decl += name + ":\\n";
+    for (const std::string& path : paths)
+        decl += "\\t.incbin \\\"" + path + "\\\"\\n";
+    decl += "\\t.popsection\")";
+
+    m_output.resize(declStart);
+    m_output += decl;
+    m_output += lines;
+    return true;
 }
 
 // Reports a diagnostic message.
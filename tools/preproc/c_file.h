@@ -25,12 +25,13 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 #include "preproc.h"
 
 class CFile
 {
 public:
-    CFile(const char * filenameCStr, bool isStdin);
+    CFile(const char * filenameCStr, bool isStdin, bool incbinAsm);
     CFile(CFile&& other);
     CFile(const CFile&) = delete;
     ~CFile();
@@ -43,14 +44,21 @@ private:
     long m_lineNum;
     std::string m_filename;
     bool m_isStdin;
+    bool m_incbinAsm;
+    std::string m_output;
+    std::size_t m_statementStart;
+    int m_braceDepth;
 
     bool ConsumeHorizontalWhitespace();
     bool ConsumeNewline();
     void SkipWhitespace();
     void TryConvertString();
-    std::unique_ptr<unsigned char[]> ReadWholeFile(const std::string& path, int& size);
+    void EndStatement();
+    void FlushOutput();
     bool CheckIdentifier(const std::string& ident);
     void TryConvertIncbin();
+    void OutputIncbinData(const std::string& path, int size, bool isSigned);
+    bool TryOutputIncbinAsm(const std::vector<std::string>& paths, int size);
     void ReportDiagnostic(const char* type, const char* format, std::va_list args);
     void RaiseError(const char* format, ...);
     void RaiseWarning(const char* format, ...);
@@ -3,6 +3,12 @@
 #include <string>
 #include <cerrno>
 #include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 char *ReadFileToBuffer(const char *filename, bool isStdin, long *size)
 {
@@ -49,3 +55,55 @@ char *ReadFileToBuffer(const char *filename, bool isStdin, long *size)
     std::fclose(fp);
     return buffer;
 }
+
+MappedFile::MappedFile(const char *filename)
+    : m_isOpen(false), m_isMapped(false), m_data(NULL), m_size(0)
+{
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+    {
+        m_size = st.st_size;
+        m_isOpen = true;
+        if (m_size != 0)
+        {
+            void *data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                m_data = (const unsigned char *)data;
+                m_isMapped = true;
+            }
+        }
+    }
+    close(fd);
+    if (m_isMapped || !m_isOpen || m_size == 0)
+        return;
+    m_isOpen = false;
+#endif
+
+    // Fall back to reading the file where it cannot be mapped.
+    long size;
+    FILE *fp = std::fopen(filename, "rb");
+    if (fp == NULL)
+        return;
+    std::fclose(fp);
+    m_data = (const unsigned char *)ReadFileToBuffer(filename, false, &size);
+    m_size = size;
+    m_isOpen = true;
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (m_isMapped)
+    {
+        munmap((void *)m_data, m_size);
+        return;
+    }
+#endif
+    free((void *)m_data);
+}
@@ -3,6 +3,27 @@
 
 #define CHUNK_SIZE 4096
 
+#include <cstddef>
+
 char *ReadFileToBuffer(const char *filename, bool isStdin, long *size);
 
+// A read-only view of a whole file, mapped into memory where the platform
+// allows it so that large binaries are not copied.
+class MappedFile
+{
+public:
+    MappedFile(const char *filename);
+    MappedFile(const MappedFile&) = delete;
+    ~MappedFile();
+    bool IsOpen() const { return m_isOpen; }
+    const unsigned char *Data() const { return m_data; }
+    std::size_t Size() const { return m_size; }
+
+private:
+    bool m_isOpen;
+    bool m_isMapped;
+    const unsigned char *m_data;
+    std::size_t m_size;
+};
+
 #endif // IO_H_
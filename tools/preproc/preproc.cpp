@@ -32,17 +32,23 @@ Charmap* g_charmap;
 
 void PrintAsmBytes(unsigned char *s, int length)
 {
+    static const char hexDigits[] = "0123456789ABCDEF";
+
     if (length > 0)
     {
-        std::printf("\t.byte ");
+        std::string line("\t.byte ");
+        line.reserve(line.size() + length * 6);
         for (int i = 0; i < length; i++)
         {
-            std::printf("0x%02X", s[i]);
+            line += "0x";
+            line += hexDigits[s[i] >> 4];
+            line += hexDigits[s[i] & 0xF];
 
             if (i < length - 1)
-                std::printf(", ");
+                line += ", ";
         }
-        std::putchar('\n');
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), stdout);
     }
 }
 
@@ -113,9 +119,9 @@ void PreprocAsmFile(std::string filename, bool isStdin, bool doEnum)
     }
 }
 
-void PreprocCFile(const char * filename, bool isStdin)
+void PreprocCFile(const char * filename, bool isStdin, bool incbinAsm)
 {
-    CFile cFile(filename, isStdin);
+    CFile cFile(filename, isStdin, incbinAsm);
     cFile.Preproc();
 }
 
@@ -142,7 +148,7 @@ const char* GetFileExtension(const char* filename)
 
 static void UsageAndExit(const char *program)
 {
-    std::fprintf(stderr, "Usage: %s [-i] [-e] SRC_FILE CHARMAP_FILE\nwhere -i denotes if input is from stdin\n      -e enables enum handling\n", program);
+    std::fprintf(stderr, "Usage: %s [-i] [-e] [-b] SRC_FILE CHARMAP_FILE\nwhere -i denotes if input is from stdin\n      -e enables enum handling\n      -b outputs simple INCBIN arrays in C sources as .incbin directives\n", program);
     std::exit(EXIT_FAILURE);
 }
 
@@ -153,9 +159,10 @@ int main(int argc, char **argv)
     const char *charmap = NULL;
     bool isStdin = false;
     bool doEnum = false;
+    bool incbinAsm = false;
 
-    /* preproc [-i] [-e] SRC_FILE CHARMAP_FILE */
-    while ((opt = getopt(argc, argv, "ie")) != -1)
+    /* preproc [-i] [-e] [-b] SRC_FILE CHARMAP_FILE */
+    while ((opt = getopt(argc, argv, "ieb")) != -1)
     {
         switch (opt)
         {
@@ -165,6 +172,9 @@ int main(int argc, char **argv)
         case 'e':
             doEnum = true;
             break;
+        case 'b':
+            incbinAsm = true;
+            break;
         default:
             UsageAndExit(argv[0]);
             break;
@@ -177,6 +187,9 @@ int main(int argc, char **argv)
     source = argv[optind + 0];
     charmap = argv[optind + 1];
 
+    static char outputBuffer[1 << 16];
+    std::setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
     g_charmap = new Charmap(charmap);
 
     const char* extension = GetFileExtension(source);
@@ -192,7 +205,7 @@ int main(int argc, char **argv)
     {
         if (doEnum)
             FATAL_ERROR("-e is invalid for C sources\n");
-        PreprocCFile(source, isStdin);
+        PreprocCFile(source, isStdin, incbinAsm);
     }
     else
     {
@@ -12,7 +12,10 @@ static std::string s_elfPath;
 static std::string s_archiveFilePath;
 static std::string s_archiveObjectPath;
 
-static FILE *s_file;
+// The whole file is read up front, as the symbol and string tables are
+// visited in no particular order.
+static std::vector<unsigned char> s_data;
+static std::size_t s_pos;
 
 static std::uint32_t s_sectionHeaderOffset;
 static int s_sectionHeaderEntrySize;
@@ -34,24 +37,24 @@ struct Symbol
 
 static void Seek(long offset)
 {
-    if (std::fseek(s_file, s_elfFileOffset + offset, SEEK_SET) != 0)
+    if (offset < 0 || s_elfFileOffset + static_cast<std::size_t>(offset) > s_data.size())
         FATAL_ERROR("error: failed to seek to %ld in \"%s\"", offset, s_elfPath.c_str());
+    s_pos = s_elfFileOffset + offset;
 }
 
 static void Skip(long offset)
 {
-    if (std::fseek(s_file, offset, SEEK_CUR) != 0)
+    if (offset < 0 || s_pos + static_cast<std::size_t>(offset) > s_data.size())
         FATAL_ERROR("error: failed to skip %ld bytes in \"%s\"", offset, s_elfPath.c_str());
+    s_pos += offset;
 }
 
 static std::uint32_t ReadInt8()
 {
-    int c = std::fgetc(s_file);
-
-    if (c < 0)
+    if (s_pos >= s_data.size())
         FATAL_ERROR("error: unexpected EOF when reading ELF file \"%s\"\n", s_elfPath.c_str());
 
-    return c;
+    return s_data[s_pos++];
 }
 
 static std::uint32_t ReadInt16()
@@ -74,30 +77,53 @@ static std::uint32_t ReadInt32()
 
 static std::string ReadString()
 {
-    std::string s;
-    char c;
+    const void *end = s_pos < s_data.size() ? std::memchr(&s_data[s_pos], 0, s_data.size() - s_pos) : NULL;
 
-    while ((c = ReadInt8()) != 0)
-        s += c;
+    if (end == NULL)
+        FATAL_ERROR("error: unexpected EOF when reading ELF file \"%s\"\n", s_elfPath.c_str());
 
+    std::string s(reinterpret_cast<const char *>(&s_data[s_pos]), static_cast<const unsigned char *>(end) - &s_data[s_pos]);
+    s_pos += s.length() + 1;
     return s;
 }
 
+static void ReadFile()
+{
+    FILE *file = std::fopen(s_elfPath.c_str(), "rb");
+
+    if (file == NULL)
+        FATAL_ERROR("error: failed to open \"%s\" for reading\n", s_elfPath.c_str());
+
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::rewind(file);
+
+    if (size < 0)
+        FATAL_ERROR("error: failed to read \"%s\"\n", s_elfPath.c_str());
+
+    s_data.resize(size);
+
+    if (size != 0 && std::fread(s_data.data(), size, 1, file) != 1)
+        FATAL_ERROR("error: failed to read \"%s\"\n", s_elfPath.c_str());
+
+    std::fclose(file);
+    s_pos = 0;
+}
+
 static void VerifyElfIdent()
 {
     char expectedMagic[4] = { 0x7F, 'E', 'L', 'F' };
-    char magic[4];
 
-    if (std::fread(magic, 4, 1, s_file) != 1)
+    if (s_data.size() < 6)
         FATAL_ERROR("error: failed to read ELF magic from \"%s\"\n", s_elfPath.c_str());
 
-    if (std::memcmp(magic, expectedMagic, 4) != 0)
+    if (std::memcmp(s_data.data(), expectedMagic, 4) != 0)
         FATAL_ERROR("error: ELF magic did not match in \"%s\"\n", s_elfPath.c_str());
 
-    if (std::fgetc(s_file) != 1)
+    if (s_data[4] != 1)
         FATAL_ERROR("error: \"%s\" not 32-bit ELF\n", s_elfPath.c_str());
 
-    if (std::fgetc(s_file) != 1)
+    if (s_data[5] != 1)
         FATAL_ERROR("error: \"%s\" not little-endian ELF\n", s_elfPath.c_str());
 }
 
@@ -208,10 +234,7 @@ std::vector<std::pair<std::string, std::uint32_t>> GetCommonSymbols(std::string
         FATAL_ERROR("error: library common syms are unsupported (filename: \"%s\")\n", path.c_str());
 
     s_elfPath = sourcePath + "/" + path;
-    s_file = std::fopen(s_elfPath.c_str(), "rb");
-
-    if (s_file == NULL)
-        FATAL_ERROR("error: failed to open \"%s\" for reading\n", path.c_str());
+    ReadFile();
 
     return GetCommonSymbols_Shared();
 }
@@ -0,0 +1,162 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include "include_cache.h"
+#include "source_file.h"
+
+#if defined(__APPLE__)
+#define MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#elif defined(_WIN32)
+#define MTIME_NSEC(st) 0
+#else
+#define MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+static const char *const CACHE_HEADER = "scaninc cache 1";
+
+// Format:
+//   scaninc cache 1 <time saved>
+//   F <path> <mtime> <size>
+//   I <include>...
+//   B <incbin>...
+// with tabs between the fields.
+void IncludeCache::Load(const std::string& path)
+{
+    std::ifstream input(path);
+    std::string line;
+
+    if (!std::getline(input, line) || line.compare(0, std::strlen(CACHE_HEADER), CACHE_HEADER) != 0)
+        return;
+
+    m_savedTime = std::strtoll(line.c_str() + std::strlen(CACHE_HEADER), NULL, 10);
+
+    CachedFile *file = NULL;
+    while (std::getline(input, line))
+    {
+        if (line.size() < 2 || line[1] != '\t')
+            continue;
+
+        std::string value = line.substr(2);
+        if (line[0] == 'F')
+        {
+            std::istringstream fields(value);
+            std::string filePath;
+            std::unique_ptr<CachedFile> cached(new CachedFile());
+            if (!std::getline(fields, filePath, '\t') || !(fields >> cached->mtime >> cached->size))
+            {
+                file = NULL;
+                continue;
+            }
+            cached->exists = true;
+            cached->scanned = true;
+            file = cached.get();
+            m_files[filePath] = std::move(cached);
+        }
+        else if (line[0] == 'I' && file != NULL)
+        {
+            file->includes.insert(value);
+        }
+        else if (line[0] == 'B' && file != NULL)
+        {
+            file->incbins.insert(value);
+        }
+    }
+}
+
+void IncludeCache::Save(const std::string& path)
+{
+    std::string tmpPath = path + ".tmp";
+    std::ofstream output(tmpPath);
+
+    output << CACHE_HEADER << " " << (long long)std::time(NULL) << "\n";
+    for (const auto& entry : m_files)
+    {
+        const CachedFile& file = *entry.second;
+        if (!file.exists || !file.scanned)
+            continue;
+
+        output << "F\t" << entry.first << "\t" << file.mtime << " " << file.size << "\n";
+        for (const std::string& include : file.includes)
+            output << "I\t" << include << "\n";
+        for (const std::string& incbin : file.incbins)
+            output << "B\t" << incbin << "\n";
+    }
+
+    output.close();
+    if (!output || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        std::fprintf(stderr, "Failed to write \"%s\".\n", path.c_str());
+    }
+}
+
+bool IncludeCache::StatFile(const std::string& path, long long *mtime, long long *size)
+{
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0 || S_ISDIR(st.st_mode))
+        return false;
+
+    *mtime = (long long)st.st_mtime * 1000000000 + MTIME_NSEC(st);
+    *size = st.st_size;
+    return true;
+}
+
+const CachedFile& IncludeCache::Stat(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_files.find(path);
+        if (it != m_files.end() && it->second->statted)
+            return *it->second;
+    }
+
+    long long mtime = 0, size = 0;
+    bool exists = StatFile(path, &mtime, &size);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unique_ptr<CachedFile>& file = m_files[path];
+    if (!file)
+        file.reset(new CachedFile());
+    if (!file->statted)
+    {
+        // A file modified in the same second as the cache was saved could
+        // have been modified again since without its mtime changing.
+        if (!exists || file->mtime != mtime || file->size != size || mtime / 1000000000 >= m_savedTime)
+        {
+            file->scanned = false;
+            file->incbins.clear();
+            file->includes.clear();
+        }
+        file->statted = true;
+        file->exists = exists;
+        file->mtime = mtime;
+        file->size = size;
+    }
+    return *file;
+}
+
+const CachedFile& IncludeCache::Scan(const std::string& path)
+{
+    const CachedFile& cached = Stat(path);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (cached.scanned)
+            return cached;
+    }
+
+    SourceFile source(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CachedFile& file = *m_files[path];
+    if (!file.scanned)
+    {
+        file.incbins = source.GetIncbins();
+        file.includes = source.GetIncludes();
+        file.scanned = true;
+    }
+    return file;
+}
@@ -0,0 +1,42 @@
+#ifndef INCLUDE_CACHE_H
+#define INCLUDE_CACHE_H
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+struct CachedFile
+{
+    bool statted = false;
+    bool exists = false;
+    long long mtime = 0; // nanoseconds where the platform has them
+    long long size = 0;
+    bool scanned = false;
+    std::set<std::string> incbins;
+    std::set<std::string> includes;
+};
+
+// Remembers which paths exist and what each source file includes, so that
+// every header is only opened and parsed once however many sources include
+// it. Can be saved to and loaded from disk, in which case a file is only
+// parsed again if its modification time or size has changed. Safe to use
+// from several threads.
+class IncludeCache
+{
+public:
+    void Load(const std::string& path);
+    void Save(const std::string& path);
+    const CachedFile& Stat(const std::string& path);
+    const CachedFile& Scan(const std::string& path);
+    static bool StatFile(const std::string& path, long long *mtime, long long *size);
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::unique_ptr<CachedFile>> m_files;
+    std::time_t m_savedTime = 0;
+};
+
+#endif // INCLUDE_CACHE_H
@@ -18,6 +18,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <list>
@@ -25,107 +27,106 @@
 #include <set>
 #include <string>
 #include <iostream>
+#include <thread>
 #include <tuple>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
 #include "scaninc.h"
+#include "include_cache.h"
 #include "source_file.h"
 
-bool CanOpenFile(std::string path)
-{
-    FILE *fp = std::fopen(path.c_str(), "rb");
-
-    if (fp == NULL)
-        return false;
-
-    std::fclose(fp);
-    return true;
-}
-
-const char *const USAGE = "Usage: scaninc [-I INCLUDE_PATH] [-M DEPENDENCY_OUT_PATH] FILE_PATH\n";
+const char *const USAGE = "Usage: scaninc [-I INCLUDE_PATH] [-M DEPENDENCY_OUT_PATH] FILE_PATH\n"
+                          "       scaninc -b LIST_PATH [-j THREADS] [-c CACHE_PATH]\n";
 
-int main(int argc, char **argv)
+struct ScanJob
 {
-    std::queue<std::string> filesToProcess;
-    std::set<std::string> dependencies;
-    std::set<std::string> dependencies_includes;
-
     std::vector<std::string> includeDirs;
-
     bool makeformat = false;
     std::string make_outfile;
+    std::string initialPath;
+};
 
-    argc--;
-    argv++;
+ScanJob ParseArgs(const std::vector<std::string>& args)
+{
+    ScanJob job;
+    size_t i = 0;
 
-    while (argc > 1)
+    while (args.size() - i > 1)
     {
-        std::string arg(argv[0]);
+        std::string arg(args[i]);
         if (arg.substr(0, 2) == "-I")
         {
             std::string includeDir = arg.substr(2);
             if (includeDir.empty())
             {
-                argc--;
-                argv++;
-                includeDir = std::string(argv[0]);
+                i++;
+                includeDir = args[i];
             }
             if (!includeDir.empty() && includeDir.back() != '/')
             {
                 includeDir += '/';
             }
-            includeDirs.push_back(includeDir);
+            job.includeDirs.push_back(includeDir);
         }
         else if(arg.substr(0, 2) == "-M")
         {
-            makeformat = true;
-            argc--;
-            argv++;
-            make_outfile = std::string(argv[0]);
+            job.makeformat = true;
+            i++;
+            job.make_outfile = args[i];
         }
         else
         {
             FATAL_ERROR(USAGE);
         }
-        argc--;
-        argv++;
+        i++;
     }
 
-    if (argc != 1) {
+    if (args.size() - i != 1) {
         FATAL_ERROR(USAGE);
     }
 
-    std::string initialPath(argv[0]);
+    job.initialPath = args[i];
+    return job;
+}
+
+void ScanDependencies(IncludeCache& cache, const ScanJob& job, std::set<std::string>& dependencies, std::set<std::string>& dependencies_includes)
+{
+    std::queue<std::string> filesToProcess;
+    std::vector<std::string> includeDirs = job.includeDirs;
 
-    filesToProcess.push(initialPath);
+    filesToProcess.push(job.initialPath);
 
     while (!filesToProcess.empty())
     {
         std::string filePath = filesToProcess.front();
-        SourceFile file(filePath);
+        const CachedFile& file = cache.Scan(filePath);
+        SourceFileType fileType = GetFileType(filePath);
         filesToProcess.pop();
 
-        includeDirs.push_back(file.GetSrcDir());
-        for (auto incbin : file.GetIncbins())
+        includeDirs.push_back(GetDir(filePath));
+        for (auto incbin : file.incbins)
         {
             dependencies.insert(incbin);
         }
-        for (auto include : file.GetIncludes())
+        for (auto include : file.includes)
         {
             bool exists = false;
             std::string path("");
             for (auto includeDir : includeDirs)
             {
                 path = includeDir + include;
-                if (CanOpenFile(path))
+                if (cache.Stat(path).exists)
                 {
                     exists = true;
                     break;
                 }
             }
-            if (!exists && (file.FileType() == SourceFileType::Asm || file.FileType() == SourceFileType::Inc))
+            if (!exists && (fileType == SourceFileType::Asm || fileType == SourceFileType::Inc))
             {
                 path = include;
-                if (CanOpenFile(path))
+                if (cache.Stat(path).exists)
                     exists = true;
             }
             if (!exists)
@@ -140,46 +141,172 @@ int main(int argc, char **argv)
         }
         includeDirs.pop_back();
     }
+}
+
+std::string MakeRules(const ScanJob& job, const std::set<std::string>& dependencies, const std::set<std::string>& dependencies_includes)
+{
+    std::ostringstream output;
 
-    if(!makeformat)
+    // Print a make rule for the object file
+    size_t ext_pos = job.make_outfile.find_last_of(".");
+    auto object_file = job.make_outfile.substr(0, ext_pos + 1) + "o";
+    output << object_file.c_str() << ":";
+    for (const std::string &path : dependencies)
     {
-        for (const std::string &path : dependencies)
-        {
-            std::printf("%s\n", path.c_str());
-        }
-        std::cout << std::endl;
+        output << " " << path;
     }
-    else
+    output << '\n';
+
+    // Dependency list rule.
+    // Although these rules are identical, they need to be separate, else make will trigger the rule again after the file is created for the first time.
+    output << job.make_outfile.c_str() << ":";
+    for (const std::string &path : dependencies_includes)
     {
-        // Write out make rules to a file
-        std::ofstream output(make_outfile);
+        output << " " << path;
+    }
+    output << '\n';
 
-        // Print a make rule for the object file
-        size_t ext_pos = make_outfile.find_last_of(".");
-        auto object_file = make_outfile.substr(0, ext_pos + 1) + "o";
-        output << object_file.c_str() << ":";
-        for (const std::string &path : dependencies)
-        {
-            output << " " << path;
-        }
-        output << '\n';
+    // Dummy rules
+    // If a dependency is deleted, make will try to make it, instead of rescanning the dependencies before trying to do that.
+    for (const std::string &path : dependencies)
+    {
+        output << path << ":\n";
+    }
+
+    return output.str();
+}
+
+// Each line of the list is the arguments for one source, e.g.
+// "-I include -M build/foo.d src/foo.c", with "" for an empty argument.
+// Every header is parsed once for all of them, and not at all if it is
+// unchanged since the cache was saved. A dependency file is only
+// rewritten if its rules change or it is older than the files it lists, so
+// that make does not run scaninc again for it.
+void RunBatch(int argc, char **argv)
+{
+    std::string listPath;
+    std::string cachePath;
+    unsigned threadsCount = std::thread::hardware_concurrency();
 
-        // Dependency list rule.
-        // Although these rules are identical, they need to be separate, else make will trigger the rule again after the file is created for the first time.
-        output << make_outfile.c_str() << ":";
-        for (const std::string &path : dependencies_includes)
+    for (int i = 0; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+        if (i + 1 >= argc)
+            FATAL_ERROR(USAGE);
+        else if (arg == "-b")
+            listPath = argv[++i];
+        else if (arg == "-c")
+            cachePath = argv[++i];
+        else if (arg == "-j")
+            threadsCount = std::strtoul(argv[++i], NULL, 10);
+        else
+            FATAL_ERROR(USAGE);
+    }
+
+    if (threadsCount == 0)
+        threadsCount = 1;
+
+    std::ifstream list(listPath);
+    if (!list)
+        FATAL_ERROR("Failed to open \"%s\" for reading.\n", listPath.c_str());
+
+    std::vector<ScanJob> jobs;
+    std::string line;
+    while (std::getline(list, line))
+    {
+        std::istringstream words(line);
+        std::vector<std::string> args;
+        std::string word;
+        while (words >> word)
+            args.push_back(word == "\"\"" ? "" : word);
+        if (args.empty() || args[0][0] == '#')
+            continue;
+
+        jobs.push_back(ParseArgs(args));
+        if (!jobs.back().makeformat)
+            FATAL_ERROR("No -M for \"%s\" in \"%s\".\n", jobs.back().initialPath.c_str(), listPath.c_str());
+    }
+
+    IncludeCache cache;
+    if (!cachePath.empty())
+        cache.Load(cachePath);
+
+    std::atomic<size_t> nextJob(0);
+    auto worker = [&]()
+    {
+        size_t i;
+        while ((i = nextJob++) < jobs.size())
         {
-            output << " " << path;
+            const ScanJob& job = jobs[i];
+            std::set<std::string> dependencies;
+            std::set<std::string> dependencies_includes;
+            ScanDependencies(cache, job, dependencies, dependencies_includes);
+            std::string rules = MakeRules(job, dependencies, dependencies_includes);
+
+            long long newest = cache.Stat(job.initialPath).mtime;
+            for (const std::string &path : dependencies_includes)
+                newest = std::max(newest, cache.Stat(path).mtime);
+
+            long long mtime, size;
+            if (IncludeCache::StatFile(job.make_outfile, &mtime, &size) && mtime >= newest)
+            {
+                std::ifstream input(job.make_outfile);
+                std::stringstream contents;
+                contents << input.rdbuf();
+                if (contents.str() == rules)
+                    continue;
+            }
+
+            std::ofstream output(job.make_outfile);
+            output << rules;
+            output.close();
+            if (!output)
+                FATAL_ERROR("Failed to write \"%s\".\n", job.make_outfile.c_str());
         }
-        output << '\n';
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadsCount && i < jobs.size(); i++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    if (!cachePath.empty())
+        cache.Save(cachePath);
+}
 
-        // Dummy rules
-        // If a dependency is deleted, make will try to make it, instead of rescanning the dependencies before trying to do that.
+int main(int argc, char **argv)
+{
+    argc--;
+    argv++;
+
+    if (argc > 0 && std::string(argv[0]) == "-b")
+    {
+        RunBatch(argc, argv);
+        return 0;
+    }
+
+    ScanJob job = ParseArgs(std::vector<std::string>(argv, argv + argc));
+    IncludeCache cache;
+    std::set<std::string> dependencies;
+    std::set<std::string> dependencies_includes;
+
+    ScanDependencies(cache, job, dependencies, dependencies_includes);
+
+    if(!job.makeformat)
+    {
         for (const std::string &path : dependencies)
         {
-            output << path << ":\n";
+            std::printf("%s\n", path.c_str());
         }
-
+        std::cout << std::endl;
+    }
+    else
+    {
+        // Write out make rules to a file
+        std::ofstream output(job.make_outfile);
+        output << MakeRules(job, dependencies, dependencies_includes);
         output.flush();
         output.close();
     }
@@ -8,6 +8,8 @@
  * 3. Format that member in 'fprint_trainers'. */
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -1879,112 +1881,133 @@ static void fprint_trainers(const char *output_path, FILE *f, struct Parsed *par
 
 static void usage(FILE *file, char *argv0)
 {
-    fprintf(file, "Usage: %s -o <output> <source>\n", argv0);
+    fprintf(file, "Usage: %s [-j <threads>] -o <output> [-i <path>] <source> [-o <output> [-i <path>] <source>]...\n", argv0);
 }
 
-int main(int argc, char *argv[])
+static unsigned char *read_source(const char *source_path, int *source_buffer_n)
 {
-    int status = 1;
     FILE *source_file = NULL;
-    FILE *output_file = NULL;
     unsigned char *source_buffer = NULL;
-    struct Parsed parsed = {
-        .default_ivs = { 31, 31, 31, 31, 31, 31 },
-        .default_level = 100,
-    };
-
-    const char *source_path = NULL;
-    const char *output_path = NULL;
-    const char *real_source_path = NULL;
 
-    int opt;
-    while ((opt = getopt(argc, argv, "i:o:")) != -1)
-    {
-        switch (opt)
-        {
-        case 'i':
-            real_source_path = optarg;
-            break;
-        case 'o':
-            output_path = optarg;
-            break;
-        default:
-            fprintf(stderr, "unknown option '%c'\n", opt);
-            usage(stderr, argv[0]);
-            goto exit;
-        }
-    }
-
-    if (!output_path)
-    {
-        usage(stderr, argv[0]);
-        goto exit;
-    }
-
-    if (optind != argc - 1)
-    {
-        usage(stderr, argv[0]);
-        goto exit;
-    }
-    source_path = argv[optind++];
-
-    int source_buffer_n;
     if (strcmp(source_path, "-") == 0)
     {
         source_file = stdin;
-        source_path = "<stdin>";
 
         int source_buffer_c = 4096;
-        source_buffer_n = 0;
+        *source_buffer_n = 0;
         for (;;)
         {
-            if (!(source_buffer = realloc(source_buffer, source_buffer_c)))
+            unsigned char *source_buffer_ = realloc(source_buffer, source_buffer_c);
+            if (!source_buffer_)
             {
                 fprintf(stderr, "could not allocate %d bytes\n", source_buffer_c);
-                goto exit;
+                goto error;
             }
+            source_buffer = source_buffer_;
 
-            source_buffer_n += fread(&source_buffer[source_buffer_n], 1, source_buffer_c - source_buffer_n, source_file);
-            if (source_buffer_n < source_buffer_c)
+            *source_buffer_n += fread(&source_buffer[*source_buffer_n], 1, source_buffer_c - *source_buffer_n, source_file);
+            if (*source_buffer_n < source_buffer_c)
                 break;
 
-            source_buffer_c += source_buffer_n / 2; // 1.5x growth rate.
+            source_buffer_c += *source_buffer_n / 2; // 1.5x growth rate.
         }
+        return source_buffer;
     }
-    else
+
+    source_file = fopen(source_path, "r");
+    if (source_file == NULL)
     {
-        source_file = fopen(source_path, "r");
-        if (source_file == NULL)
-        {
-            fprintf(stderr, "could not open '%s' for reading\n", source_path);
-            goto exit;
-        }
+        fprintf(stderr, "could not open '%s' for reading\n", source_path);
+        goto error;
+    }
 
-        fseek(source_file, 0, SEEK_END);
-        long source_buffer_n_ = ftell(source_file);
-        if (source_buffer_n_ > INT_MAX)
-        {
-            fprintf(stderr, "could not read '%s': too big\n", source_path);
-            goto exit;
-        }
+    fseek(source_file, 0, SEEK_END);
+    long source_buffer_n_ = ftell(source_file);
+    if (source_buffer_n_ > INT_MAX)
+    {
+        fprintf(stderr, "could not read '%s': too big\n", source_path);
+        goto error;
+    }
 
-        source_buffer_n = source_buffer_n_;
+    *source_buffer_n = source_buffer_n_;
 
-        if (!(source_buffer = malloc(source_buffer_n)))
-        {
-            fprintf(stderr, "could not allocate %d bytes\n", source_buffer_n);
-            goto exit;
-        }
-        rewind(source_file);
-        if (fread(source_buffer, 1, source_buffer_n, source_file) < source_buffer_n)
+    if (!(source_buffer = malloc(*source_buffer_n)))
+    {
+        fprintf(stderr, "could not allocate %d bytes\n", *source_buffer_n);
+        goto error;
+    }
+    rewind(source_file);
+    if (fread(source_buffer, 1, *source_buffer_n, source_file) < *source_buffer_n)
+    {
+        fprintf(stderr, "could not read '%s'\n", source_path);
+        goto error;
+    }
+
+    fclose(source_file);
+    return source_buffer;
+
+error:
+    if (source_file && source_file != stdin) fclose(source_file);
+    free(source_buffer);
+    return NULL;
+}
+
+static bool files_equal(const char *path1, const char *path2)
+{
+    bool equal = false;
+    FILE *f1 = fopen(path1, "rb");
+    FILE *f2 = fopen(path2, "rb");
+
+    if (f1 && f2)
+    {
+        char buffer1[65536], buffer2[65536];
+        for (;;)
         {
-            fprintf(stderr, "could not read '%s'\n", source_path);
-            goto exit;
+            size_t n1 = fread(buffer1, 1, sizeof(buffer1), f1);
+            size_t n2 = fread(buffer2, 1, sizeof(buffer2), f2);
+            if (n1 != n2 || memcmp(buffer1, buffer2, n1) != 0)
+                break;
+            if (n1 < sizeof(buffer1))
+            {
+                equal = true;
+                break;
+            }
         }
     }
 
+    if (f1) fclose(f1);
+    if (f2) fclose(f2);
+    return equal;
+}
+
+struct Job
+{
+    const char *source_path;
+    const char *real_source_path;
+    const char *output_path;
+    bool ok;
+};
+
+/* The output is written to a temporary file first and only replaces
+ * the old output if it is different, so that whatever includes it is
+ * only rebuilt when a trainer actually changed. */
+static bool process(const char *source_path, const char *real_source_path, const char *output_path)
+{
+    bool ok = false;
+    FILE *output_file = NULL;
+    unsigned char *source_buffer = NULL;
+    char *tmp_path = NULL;
+    struct Parsed parsed = {
+        .default_ivs = { 31, 31, 31, 31, 31, 31 },
+        .default_level = 100,
+    };
+
+    int source_buffer_n;
+    if (!(source_buffer = read_source(source_path, &source_buffer_n)))
+        goto exit;
+
     struct Source source = {
-        .path = real_source_path ? real_source_path : source_path,
+        .path = real_source_path ? real_source_path : strcmp(source_path, "-") == 0 ? "<stdin>" : source_path,
         .buffer = source_buffer,
         .buffer_n = source_buffer_n,
     };
@@ -2001,26 +2024,168 @@ int main(int argc, char *argv[])
 
     if (strcmp(output_path, "-") == 0)
     {
-        source_file = stdout;
-        output_path = "<stdout>";
+        fprint_trainers("<stdout>", stdout, &parsed);
+        ok = true;
+        goto exit;
+    }
+
+    if (!(tmp_path = malloc(strlen(output_path) + sizeof(".tmp"))))
+    {
+        fprintf(stderr, "could not allocate memory\n");
+        goto exit;
+    }
+    sprintf(tmp_path, "%s.tmp", output_path);
+
+    output_file = fopen(tmp_path, "w");
+    if (output_file == NULL)
+    {
+        fprintf(stderr, "could not open '%s' for writing\n", tmp_path);
+        goto exit;
+    }
+    fprint_trainers(output_path, output_file, &parsed);
+    if (fclose(output_file) != 0)
+    {
+        output_file = NULL;
+        fprintf(stderr, "could not write '%s'\n", tmp_path);
+        goto exit;
+    }
+    output_file = NULL;
+
+    if (files_equal(tmp_path, output_path))
+    {
+        remove(tmp_path);
     }
     else
     {
-        output_file = fopen(output_path, "w");
-        if (output_file == NULL)
+#ifdef _WIN32
+        remove(output_path);
+#endif
+        if (rename(tmp_path, output_path) != 0)
         {
-            fprintf(stderr, "could not open '%s' for writing\n", output_path);
+            fprintf(stderr, "could not write '%s'\n", output_path);
+            remove(tmp_path);
             goto exit;
         }
     }
-    fprint_trainers(output_path, output_file, &parsed);
 
-    status = 0;
+    ok = true;
 
 exit:
-    if (output_file) fclose(output_file);
+    if (output_file)
+    {
+        fclose(output_file);
+        remove(tmp_path);
+    }
+    free(tmp_path);
     if (parsed.trainers) free(parsed.trainers);
-    if (source_buffer) free(source_buffer);
-    if (source_file) fclose(source_file);
+    free(source_buffer);
+    return ok;
+}
+
+static struct Job *jobs;
+static int jobs_n;
+static atomic_int next_job;
+
+static void *process_jobs(void *arg)
+{
+    int i;
+    while ((i = atomic_fetch_add(&next_job, 1)) < jobs_n)
+        jobs[i].ok = process(jobs[i].source_path, jobs[i].real_source_path, jobs[i].output_path);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int status = 1;
+    const char *output_path = NULL;
+    const char *real_source_path = NULL;
+    int threads_n = 0;
+    bool reads_stdin = false;
+
+    if (!(jobs = malloc(sizeof(*jobs) * argc)))
+    {
+        fprintf(stderr, "could not allocate memory\n");
+        goto exit;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            real_source_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threads_n = atoi(argv[++i]);
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            fprintf(stderr, "unknown option '%s'\n", argv[i]);
+            usage(stderr, argv[0]);
+            goto exit;
+        }
+        else
+        {
+            if (!output_path || (reads_stdin && strcmp(argv[i], "-") == 0))
+            {
+                usage(stderr, argv[0]);
+                goto exit;
+            }
+            reads_stdin |= strcmp(argv[i], "-") == 0;
+            jobs[jobs_n++] = (struct Job) {
+                .source_path = argv[i],
+                .real_source_path = real_source_path,
+                .output_path = output_path,
+            };
+            output_path = NULL;
+            real_source_path = NULL;
+        }
+    }
+
+    if (jobs_n == 0 || output_path || real_source_path)
+    {
+        usage(stderr, argv[0]);
+        goto exit;
+    }
+
+    if (threads_n <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads_n = cpus > 0 ? cpus : 1;
+    }
+    if (threads_n > jobs_n)
+        threads_n = jobs_n;
+
+    pthread_t *threads = malloc(sizeof(*threads) * threads_n);
+    if (!threads)
+    {
+        fprintf(stderr, "could not allocate memory\n");
+        goto exit;
+    }
+    int started_n = 0;
+    for (int i = 1; i < threads_n; i++)
+    {
+        if (pthread_create(&threads[started_n], NULL, process_jobs, NULL) != 0)
+            break;
+        started_n++;
+    }
+    process_jobs(NULL);
+    for (int i = 0; i < started_n; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    status = 0;
+    for (int i = 0; i < jobs_n; i++)
+    {
+        if (!jobs[i].ok)
+            status = 1;
+    }
+
+exit:
+    free(jobs);
     return status;
 }